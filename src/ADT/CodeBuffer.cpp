@@ -1,17 +1,127 @@
+
 #include "CodeBuffer.h"
 
+#include <atomic>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
 namespace wasmrt {
 namespace adt {
 namespace code_buffer {
 
-CodeBlob CodeBuffer::Allocate(size_t Size) {
+namespace {
+
+// Executable view of the code space, published for isGeneratedCode.
+std::atomic<const uint8_t *> CodeSpaceRX{nullptr};
+
+// Reserved once, committed by the kernel as chunks get written. Chunks of
+// destroyed buffers are handed out again.
+struct CodeSpace {
+    CodeSpace() {
+        auto Size = CodeBuffer::CodeSpaceSize;
+        int Fd = memfd_create("wasmrt-code", MFD_CLOEXEC);
+        if (Fd >= 0 && ftruncate(Fd, Size) == 0) {
+            void *W = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_NORESERVE, Fd, 0);
+            void *X = W == MAP_FAILED ? MAP_FAILED
+                    : mmap(nullptr, Size, PROT_READ | PROT_EXEC, MAP_SHARED | MAP_NORESERVE, Fd, 0);
+            if (X != MAP_FAILED) {
+                RW = static_cast<uint8_t *>(W);
+                RX = static_cast<const uint8_t *>(X);
+            } else if (W != MAP_FAILED) {
+                munmap(W, Size);
+            }
+        }
+        if (Fd >= 0)
+            close(Fd);
+        if (RW == nullptr) {
+            void *WX = mmap(nullptr, Size, PROT_READ | PROT_WRITE | PROT_EXEC,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (WX != MAP_FAILED)
+                RW = static_cast<uint8_t *>(WX), RX = RW;
+        }
+        CodeSpaceRX.store(RX, std::memory_order_release);
+    }
+
+    uint8_t                *RW{nullptr};
+    const uint8_t          *RX{nullptr};
+    size_t                 Used{0};
+    std::vector<size_t>    FreeChunks;     // offsets
+    std::mutex             Lock;
+};
+
+CodeSpace &getCodeSpace() {
+    static CodeSpace Space;
+    return Space;
+}
+
+} // namespace
 
+bool isGeneratedCode(const void *PC) {
+    auto *RX = CodeSpaceRX.load(std::memory_order_acquire);
+    auto *P = static_cast<const uint8_t *>(PC);
+    return RX != nullptr && P >= RX && P < RX + CodeBuffer::CodeSpaceSize;
+}
+
+CodeBuffer::~CodeBuffer() {
+    auto &Space = getCodeSpace();
+    std::lock_guard<std::mutex> Guard(Space.Lock);
+    for (auto &C : Chunks)
+        Space.FreeChunks.push_back(C.RW - Space.RW);
+}
+
+bool CodeBuffer::NewChunk() {
+    auto &Space = getCodeSpace();
+    std::lock_guard<std::mutex> Guard(Space.Lock);
+    if (Space.RW == nullptr)
+        return false;
+    size_t Offset;
+    if (!Space.FreeChunks.empty()) {
+        Offset = Space.FreeChunks.back();
+        Space.FreeChunks.pop_back();
+    } else if (Space.Used + ChunkSize <= CodeSpaceSize) {
+        Offset = Space.Used;
+        Space.Used += ChunkSize;
+    } else {
+        return false;
+    }
+    Chunks.push_back({Space.RW + Offset, Space.RX + Offset, 0});
+    return true;
+}
+
+CodeBlob CodeBuffer::Allocate(size_t Size) {
+    Size = (Size + BlobAlign - 1) & ~(BlobAlign - 1);
+    if (Size > ChunkSize)
+        return {0, this, nullptr, nullptr};
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto It = FreeBlobs.lower_bound(Size);
+    if (It != FreeBlobs.end() && It->first < 2 * Size) {
+        CodeBlob Blob{It->first, this, It->second.first, It->second.second};
+        FreeBlobs.erase(It);
+        return Blob;
+    }
+    if ((Chunks.empty() || ChunkSize - Chunks.back().Used < Size) && !NewChunk())
+        return {0, this, nullptr, nullptr};
+    auto &C = Chunks.back();
+    CodeBlob Blob{Size, this, C.RW + C.Used, C.RX + C.Used};
+    C.Used += Size;
+    return Blob;
 }
 
 void CodeBuffer::Free(CodeBlob Blob) {
-    
+    std::lock_guard<std::mutex> Guard(Lock);
+    FreeBlobs.emplace(Blob.Size, std::make_pair(Blob.Address, Blob.Entry));
+}
+
+CodeBlob CodeBuffer::Expand(CodeBlob Blob) {
+    auto New = Allocate(Blob.Size * 2);
+    if (New.Address == nullptr)
+        return New;
+    memcpy(New.Address, Blob.Address, Blob.Size);
+    Free(Blob);
+    return New;
 }
 
 } // namespace code_buffer
 } // namespace adt
-} // namespace wasmrt
\ No newline at end of file
+} // namespace wasmrt
@@ -1,6 +1,10 @@
 #pragma once
 
-using namespace wasmrt;
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
 
 namespace wasmrt {
 namespace adt {
@@ -8,20 +12,66 @@ namespace code_buffer {
 
 class CodeBuffer;
 struct CodeBlob {
-    inline void Free() { CB->Free(Address); }
+    inline void Free();
 
-    size_t Size;
-    CodeBuffer *CB;
-    uintptr_t  *Address;
-} 
+    size_t         Size;
+    CodeBuffer     *CB;
+    uint8_t        *Address;    // writable view, for the code generators
+    const uint8_t  *Entry;      // executable view of the same bytes
+};
 
+// Memory for generated code, never writable and executable through the same
+// mapping: chunks are a memfd mapped twice, read-write for emitting and
+// read-execute for running (a single RWX mapping where memfd is not
+// available). Blobs are 64-byte aligned so that aligned loop heads stay
+// aligned.
+//
+// Chunks of all buffers are carved from one process-wide code space, so any
+// two blobs are within rel32 of each other and calls between functions can
+// be direct whichever buffer they were emitted into. Allocate may be called
+// from several threads; a module's compile threads share one buffer.
 class CodeBuffer {
 public:
+    static constexpr size_t ChunkSize = 4 << 20;
+    static constexpr size_t BlobAlign = 64;
+    static constexpr size_t CodeSpaceSize = 1ull << 30;
+
+    CodeBuffer() = default;
+    ~CodeBuffer();
+
+    // Free, and the destructor for all of the buffer's chunks, hand the
+    // memory to the next allocation at once, with no grace period. The code
+    // must be quiescent by then: no thread executing or returning into it,
+    // and no FuncEntry, table or relocated call still pointing at it.
+    // Instances guarantee this for their module's code by holding it through
+    // Module::CodeOwner until they are destroyed.
+    //
+    // Allocate returns a blob without an Address when Size exceeds a chunk or
+    // the code space is used up; Expand then leaves Blob as it was.
     CodeBlob Allocate(size_t Size);
     void Free(CodeBlob Blob);
+    // A blob twice the size with the contents copied over; Blob is freed.
     CodeBlob Expand(CodeBlob Blob);
-}
+
+private:
+    struct Chunk {
+        uint8_t        *RW;
+        const uint8_t  *RX;
+        size_t         Used;
+    };
+
+    bool NewChunk();
+
+    std::mutex                                          Lock;
+    std::vector<Chunk>                                  Chunks;
+    std::multimap<size_t, std::pair<uint8_t *, const uint8_t *>>  FreeBlobs;  // by size
+};
+
+inline void CodeBlob::Free() { CB->Free(*this); }
+
+// Whether PC lies in the code space. Async-signal-safe, for fault handlers.
+bool isGeneratedCode(const void *PC);
 
 } // namespace code_buffer
 } // namespace adt
-} // namespace wasmrt
\ No newline at end of file
+} // namespace wasmrt
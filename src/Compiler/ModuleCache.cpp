@@ -0,0 +1,144 @@
+#include "Support/Hash.h"
+
+#include "ModuleCache.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace wasmrt {
+namespace compiler {
+
+void CachedModule::Link(runtime::Module &Instance) {
+    auto Config = runtime::getCodegenConfig(Instance);
+    auto Key = Config.getKey();
+    std::call_once(Compiled[Key], [this, &Config, Key] {
+        Code[Key] = std::make_unique<ModuleCompiler>(*M, Config, Options);
+        CompileFailure[Key] = Code[Key]->Compile();
+        Footprint += Code[Key]->getCodeSize();
+    });
+    if (CompileFailure[Key]) {
+        Instance.InitFailure = CompileFailure[Key];
+        return;
+    }
+    Code[Key]->Link(Instance);
+    Instance.CodeOwner = shared_from_this();
+}
+
+std::string CachedModule::describe(const runtime::trap::Trap &T) const {
+    std::string Msg = runtime::trap::getMessage(T.Kind);
+    FuncIdx Func = UINT32_MAX;
+    for (auto &C : Code) {
+        if (C != nullptr && T.PC != nullptr && (Func = C->getFuncAt(T.PC)) != UINT32_MAX)
+            break;
+    }
+    if (Func == UINT32_MAX)
+        return Msg;
+
+    char Buf[32];
+    snprintf(Buf, sizeof(Buf), " in function %u", Func);
+    Msg += Buf;
+    if (auto *Names = parser::module::getNameIndex(*M)) {
+        auto Name = Names->getFuncName(Func);
+        if (!Name.empty())
+            Msg.append(" (").append(Name).append(")");
+    }
+    return Msg;
+}
+
+ModuleCache &getModuleCache() {
+    static ModuleCache Cache;
+    return Cache;
+}
+
+static bool isSame(const parser::reader::SimpleBuffer &A, const parser::reader::SimpleBuffer &B) {
+    return A.Size == B.Size && memcmp(A.Buffer, B.Buffer, A.Size) == 0;
+}
+
+// Candidates are collected under the lock and compared outside of it, so a
+// large module does not hold up every other lookup.
+std::shared_ptr<CachedModule> ModuleCache::Find(uint64_t Hash, const parser::reader::SimpleBuffer &Bytes) {
+    std::vector<std::shared_ptr<CachedModule>> Candidates;
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        auto Range = Index.equal_range(Hash);
+        for (auto It = Range.first; It != Range.second; ++It)
+            Candidates.push_back(It->second->Module);
+    }
+    for (auto &C : Candidates) {
+        if (isSame(*C->Bytes, Bytes))
+            return C;
+    }
+    return nullptr;
+}
+
+support::result::Result<std::shared_ptr<CachedModule>>
+ModuleCache::Acquire(std::shared_ptr<parser::reader::SimpleBuffer> Bytes) {
+    auto Hash = support::hash::Hash64(Bytes->Buffer, Bytes->Size);
+    auto Found = Find(Hash, *Bytes);
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        auto Range = Index.equal_range(Hash);
+        auto It = Range.first;
+        // On a miss, a racing Acquire may have added the same bytes since.
+        while (It != Range.second && !(Found != nullptr ? It->second->Module == Found
+                                                        : isSame(*It->second->Module->Bytes, *Bytes)))
+            ++It;
+        if (It != Range.second) {
+            Found = It->second->Module;
+            LRU.splice(LRU.begin(), LRU, It->second);
+        } else {
+            // A miss, or a hit dropped from the cache since.
+            if (Found == nullptr)
+                Found = std::make_shared<CachedModule>(Bytes, Options);
+            LRU.push_front({Hash, Found});
+            Index.emplace(Hash, LRU.begin());
+        }
+        Evict();
+    }
+
+    // A malformed module stays cached like any other, so that submitting
+    // the same bytes again fails without parsing them again.
+    std::call_once(Found->Parsed, [&Found] {
+        Found->Footprint += Found->Bytes->Size;
+        auto M = parser::reader::ReadFromBuffer(*Found->Bytes);
+        if (!M) {
+            Found->ParseFailure = M.getFailure();
+            return;
+        }
+        Found->M = M.take();
+        Found->M->Source = Found->Bytes;
+    });
+    if (Found->ParseFailure)
+        return support::result::Failure(*Found->ParseFailure);
+    return std::move(Found);
+}
+
+void ModuleCache::setBudget(size_t NewBudget) {
+    std::lock_guard<std::mutex> Guard(Lock);
+    Budget = NewBudget;
+    Evict();
+}
+
+void ModuleCache::Evict() {
+    size_t Total = 0;
+    for (auto &E : LRU)
+        Total += E.Module->getFootprint();
+    for (auto It = LRU.end(); It != LRU.begin() && Total > Budget;) {
+        --It;
+        // Only the cache holds it; no instance can pick it up without the lock.
+        if (It->Module.use_count() != 1)
+            continue;
+        Total -= It->Module->getFootprint();
+        auto Range = Index.equal_range(It->Hash);
+        for (auto I = Range.first; I != Range.second; ++I) {
+            if (I->second == It) {
+                Index.erase(I);
+                break;
+            }
+        }
+        It = LRU.erase(It);
+    }
+}
+
+} // namespace compiler
+} // namespace wasmrt
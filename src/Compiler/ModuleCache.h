@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Parser/Module.h"
+#include "Parser/Reader.h"
+#include "Runtime/Module.h"
+#include "Runtime/Trap.h"
+#include "Support/Result.h"
+
+#include "ModuleCompiler.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <optional>
+#include <unordered_map>
+
+using namespace wasmrt;
+
+namespace wasmrt {
+namespace compiler {
+
+class ModuleCache;
+
+// A module as shared by all of its instances: the parsed module, including
+// its canonical signatures, and the generated code. Nothing in it changes
+// once built, except the call-site profiles, which are then per module as
+// well; instances on different threads may race on them and lose counts,
+// which only blurs the profile.
+class CachedModule : public std::enable_shared_from_this<CachedModule> {
+public:
+    CachedModule(std::shared_ptr<parser::reader::SimpleBuffer> Bytes, const CompileOptions &Options)
+        : Bytes(std::move(Bytes)), Options(Options) {}
+
+    inline parser::module::Module &getModule() { return *M; }
+
+    // Compiles the module on the first call for Instance's codegen config
+    // and points Instance's FuncEntries at the code. Instance keeps this
+    // module alive from then on, so the cache cannot evict code it runs.
+    // Code that cannot be compiled sets Instance's InitFailure instead, on
+    // every call for the config.
+    void Link(runtime::Module &Instance);
+
+    // Module bytes plus generated code.
+    inline size_t getFootprint() const { return Footprint.load(std::memory_order_relaxed); }
+
+    // The trap's message, with the function it happened in, named from the
+    // name section when there is one.
+    std::string describe(const runtime::trap::Trap &T) const;
+
+private:
+    friend class ModuleCache;
+
+    std::shared_ptr<parser::reader::SimpleBuffer>  Bytes;
+    CompileOptions                                 Options;
+    std::unique_ptr<parser::module::Module>        M;
+    std::optional<support::result::Failure>       ParseFailure;
+    std::once_flag                                 Parsed;
+    std::once_flag                                 Compiled[runtime::CodegenConfig::NumKeys];
+    std::unique_ptr<ModuleCompiler>                Code[runtime::CodegenConfig::NumKeys];
+    std::optional<support::result::Failure>       CompileFailure[runtime::CodegenConfig::NumKeys];
+    std::atomic<size_t>                            Footprint{0};
+};
+
+// Process-wide cache of modules keyed by a hash of their bytes, so that a
+// module loaded by many tenants is parsed and compiled once. Entries are
+// reference counted through the shared_ptr handed out; once the footprint
+// of all entries exceeds the budget, the least recently acquired ones that
+// no instance holds any more are dropped. Entries in use are never dropped,
+// so the budget can be exceeded while they are.
+class ModuleCache {
+public:
+    static constexpr size_t DefaultBudget = 1ull << 30;
+
+    explicit ModuleCache(size_t Budget = DefaultBudget, const CompileOptions &Options = {})
+        : Budget(Budget), Options(Options) {}
+
+    // The module read from Bytes, parsed on the first request for equal
+    // bytes, or why it could not be. Hashes only select candidates; the
+    // bytes are compared before anything is shared.
+    support::result::Result<std::shared_ptr<CachedModule>> Acquire(std::shared_ptr<parser::reader::SimpleBuffer> Bytes);
+
+    void setBudget(size_t NewBudget);
+
+private:
+    struct Entry {
+        uint64_t                       Hash;
+        std::shared_ptr<CachedModule>  Module;
+    };
+
+    std::shared_ptr<CachedModule> Find(uint64_t Hash, const parser::reader::SimpleBuffer &Bytes);
+    void Evict();   // with Lock held
+
+    std::mutex                                                  Lock;
+    size_t                                                      Budget;
+    CompileOptions                                              Options;
+    std::list<Entry>                                            LRU;     // most recent first
+    std::unordered_multimap<uint64_t, std::list<Entry>::iterator>  Index;
+};
+
+ModuleCache &getModuleCache();
+
+} // namespace compiler
+} // namespace wasmrt
@@ -0,0 +1,98 @@
+#include "Target/X86_64/TemplateInterpreter.h"
+
+#include "ModuleCompiler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace wasmrt {
+namespace compiler {
+
+ThreadPool &getDefaultPool() {
+    static ThreadPool Pool;
+    return Pool;
+}
+
+ModuleCompiler::ModuleCompiler(parser::module::Module &M, const runtime::CodegenConfig &Config,
+                               const CompileOptions &Options)
+    : M(M), Config(Config), Options(Options), NumImportedFuncs(M.NumImportedFuncs) {
+    if (this->Options.Pool == nullptr)
+        this->Options.Pool = &getDefaultPool();
+    for (uint32_t i = 0; i < M.CodeSec.size(); ++i)
+        Functions.emplace_back(std::make_unique<runtime::Function>(M, M.TypeSec[M.FuncSec[i]], M.CodeSec[i], Config));
+    Blobs.resize(M.CodeSec.size());
+    Relocs.resize(M.CodeSec.size());
+    Failures.resize(M.CodeSec.size());
+}
+
+void ModuleCompiler::CompileOne(uint32_t Idx, Worker &W) {
+    auto Blob = target::x86_64::CompileFunction(*Functions[Idx], W.ASM);
+    if (!Blob) {
+        Failures[Idx] = Blob.getFailure();
+        return;
+    }
+    Blobs[Idx] = *Blob;
+    Relocs[Idx] = W.ASM.getRelocs();
+}
+
+std::optional<support::result::Failure> ModuleCompiler::Compile() {
+    auto &Pool = *Options.Pool;
+    Workers.resize(Pool.getThreadCount());
+    for (auto &W : Workers)
+        W = std::make_unique<Worker>(CB);
+
+    std::vector<uint32_t> Order(M.CodeSec.size());
+    std::iota(Order.begin(), Order.end(), 0);
+    std::stable_sort(Order.begin(), Order.end(),
+                     [this](uint32_t A, uint32_t B) { return M.CodeSec[A].Size > M.CodeSec[B].Size; });
+    std::vector<ThreadPool::Task> Tasks;
+    Tasks.reserve(Order.size());
+    for (auto Idx : Order)
+        Tasks.emplace_back([this, Idx](uint32_t Worker) { CompileOne(Idx, *Workers[Worker]); });
+    Pool.Run(Tasks, Options.Priority);
+
+    for (auto &F : Failures) {
+        if (F)
+            return F;
+    }
+    PatchCalls();
+    return std::nullopt;
+}
+
+// All code space is within rel32 of itself, so every direct call can be
+// resolved in place.
+void ModuleCompiler::PatchCalls() {
+    for (uint32_t i = 0; i < Blobs.size(); ++i) {
+        auto &Blob = Blobs[i];
+        for (auto &R : Relocs[i]) {
+            auto *Callee = Blobs[R.Callee - NumImportedFuncs].Entry;
+            int32_t Disp = Callee - (Blob.Entry + R.Offset + 4);
+            memcpy(Blob.Address + R.Offset, &Disp, 4);
+        }
+    }
+}
+
+void ModuleCompiler::Link(runtime::Module &Instance) const {
+    for (uint32_t i = 0; i < Blobs.size(); ++i)
+        Instance.FuncEntries[NumImportedFuncs + i].Code = Blobs[i].Entry;
+}
+
+FuncIdx ModuleCompiler::getFuncAt(const void *PC) const {
+    auto *P = static_cast<const uint8_t *>(PC);
+    for (uint32_t i = 0; i < Blobs.size(); ++i) {
+        if (P >= Blobs[i].Entry && P < Blobs[i].Entry + Blobs[i].Size)
+            return NumImportedFuncs + i;
+    }
+    return UINT32_MAX;
+}
+
+size_t ModuleCompiler::getCodeSize() const {
+    size_t Size = 0;
+    for (auto &Blob : Blobs)
+        Size += Blob.Size;
+    return Size;
+}
+
+} // namespace compiler
+} // namespace wasmrt
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ADT/CodeBuffer.h"
+#include "Parser/Module.h"
+#include "Runtime/Function.h"
+#include "Runtime/Module.h"
+#include "Support/Result.h"
+#include "Target/X86_64/Assembler.h"
+
+#include "ThreadPool.h"
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::adt;
+
+namespace wasmrt {
+namespace compiler {
+
+struct CompileOptions {
+    ThreadPool       *Pool{nullptr};    // getDefaultPool() if null
+    CompilePriority  Priority{CompileNormal};
+};
+
+// Shared by all modules that do not bring their own pool, one thread per
+// hardware thread.
+ThreadPool &getDefaultPool();
+
+// Eager compilation of a whole module. Functions are compiled in parallel,
+// largest first so that the longest ones do not end up last; every worker
+// emits with its own Assembler, and only takes the module's CodeBuffer lock
+// to allocate the finished function, so the module's code packs into as few
+// chunks as its size needs. Once all functions have an address the direct
+// calls between them are patched.
+//
+// Generated code reaches instance state only through ContextReg and is
+// compiled from M and Config alone, so it serves every instance of the
+// module with the same codegen config. The code lives as long as the
+// ModuleCompiler.
+class ModuleCompiler {
+public:
+    ModuleCompiler(parser::module::Module &M, const runtime::CodegenConfig &Config,
+                   const CompileOptions &Options = {});
+
+    // Returns why the module cannot be compiled, if it cannot; the code must
+    // not be linked then.
+    std::optional<support::result::Failure> Compile();
+    // Points Instance's FuncEntries at the compiled code.
+    void Link(runtime::Module &Instance) const;
+
+    inline const void *getEntry(FuncIdx Idx) const {
+        return Blobs[Idx - NumImportedFuncs].Entry;
+    }
+
+    inline bool hasBoundsChecks() const { return Config.BoundsChecks; }
+    size_t getCodeSize() const;
+    // The function whose code contains PC, or UINT32_MAX. Only for
+    // reporting traps, so a plain scan.
+    FuncIdx getFuncAt(const void *PC) const;
+
+private:
+    struct Worker {
+        Worker(code_buffer::CodeBuffer &CB) : ASM(CB, InitCodeSize) {}
+
+        target::x86_64::Assembler ASM;
+    };
+
+    static constexpr size_t InitCodeSize = 64 * 1024;
+
+    void CompileOne(uint32_t Idx, Worker &W);
+    void PatchCalls();
+
+    parser::module::Module                            &M;
+    runtime::CodegenConfig                            Config;
+    CompileOptions                                    Options;
+    uint32_t                                          NumImportedFuncs;
+    std::vector<std::unique_ptr<runtime::Function>>   Functions;
+    code_buffer::CodeBuffer                           CB;
+    std::vector<std::unique_ptr<Worker>>              Workers;
+    std::vector<code_buffer::CodeBlob>                Blobs;
+    std::vector<std::vector<target::x86_64::CallReloc>>  Relocs;
+    std::vector<std::optional<support::result::Failure>>  Failures;   // by function, like Blobs
+};
+
+} // namespace compiler
+} // namespace wasmrt
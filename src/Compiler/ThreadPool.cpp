@@ -0,0 +1,106 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace wasmrt {
+namespace compiler {
+
+// Nice levels by CompilePriority.
+static constexpr int NiceLevels[] = {19, 10, 0};
+
+ThreadPool::ThreadPool(uint32_t Threads) : Threads(Threads) {
+    if (this->Threads == 0)
+        this->Threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> Guard(IdleLock);
+        Stop = true;
+    }
+    for (auto &G : Groups) {
+        G.Idle.notify_all();
+        for (auto &T : G.Workers)
+            T.join();
+    }
+}
+
+void ThreadPool::Run(std::vector<Task> &Tasks, CompilePriority Priority) {
+    if (Tasks.empty())
+        return;
+    auto &G = Groups[Priority];
+    std::call_once(G.Started, [this, &G, Priority] {
+        for (uint32_t i = 0; i < Threads; ++i)
+            G.Queues.emplace_back(std::make_unique<Queue>());
+        for (uint32_t i = 0; i < Threads; ++i)
+            G.Workers.emplace_back([this, Priority, i] { WorkerLoop(Priority, i); });
+    });
+
+    Batch B;
+    B.Left = Tasks.size();
+    // Counted before any entry is visible, so that Take, which decrements
+    // once it removed one, never drives Pending below zero. A worker that
+    // sees the count early finds nothing yet and looks again.
+    {
+        std::lock_guard<std::mutex> Guard(IdleLock);
+        G.Pending.fetch_add(Tasks.size());
+    }
+    auto First = G.NextQueue.fetch_add(Tasks.size(), std::memory_order_relaxed);
+    for (uint32_t i = 0; i < Tasks.size(); ++i) {
+        auto &Q = *G.Queues[(First + i) % G.Queues.size()];
+        std::lock_guard<std::mutex> Guard(Q.Lock);
+        Q.Entries.push_back({&Tasks[i], &B});
+    }
+    G.Idle.notify_all();
+
+    std::unique_lock<std::mutex> Lock(B.Lock);
+    B.Done.wait(Lock, [&B] { return B.Left.load() == 0; });
+}
+
+// The own queue first, then the others starting with the next one. Both
+// take from the front: within a batch, the largest task left.
+bool ThreadPool::Take(Group &G, uint32_t Worker, Entry &E) {
+    for (uint32_t i = 0; i < G.Queues.size(); ++i) {
+        auto &Q = *G.Queues[(Worker + i) % G.Queues.size()];
+        std::lock_guard<std::mutex> Guard(Q.Lock);
+        if (!Q.Entries.empty()) {
+            E = Q.Entries.front();
+            Q.Entries.pop_front();
+            G.Pending.fetch_sub(1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ThreadPool::WorkerLoop(CompilePriority Priority, uint32_t Worker) {
+    // New threads inherit the level of the one that started them; only
+    // lower it, never try to raise it.
+    pid_t Tid = syscall(SYS_gettid);
+    if (getpriority(PRIO_PROCESS, Tid) < NiceLevels[Priority])
+        setpriority(PRIO_PROCESS, Tid, NiceLevels[Priority]);
+
+    auto &G = Groups[Priority];
+    for (;;) {
+        Entry E;
+        if (Take(G, Worker, E)) {
+            (*E.Fn)(Worker);
+            // Under the lock, so Run cannot return and free the batch
+            // before this is done with it.
+            std::lock_guard<std::mutex> Guard(E.Owner->Lock);
+            if (--E.Owner->Left == 0)
+                E.Owner->Done.notify_all();
+            continue;
+        }
+        std::unique_lock<std::mutex> Lock(IdleLock);
+        G.Idle.wait(Lock, [this, &G] { return Stop || G.Pending.load() != 0; });
+        if (Stop)
+            return;
+    }
+}
+
+} // namespace compiler
+} // namespace wasmrt
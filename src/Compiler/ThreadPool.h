@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace wasmrt {
+namespace compiler {
+
+// How urgently a module's functions get compiled. Every priority has its own
+// compile threads, started on first use at the nice level of the priority,
+// so background compiles stay below serving threads and urgent ones do not.
+enum CompilePriority : uint8_t {
+    CompileBackground = 0,
+    CompileNormal,
+    CompileUrgent,
+    NumCompilePriorities
+};
+
+// Work-stealing pool for compile tasks. Every worker owns a queue; a batch is
+// dealt round-robin over the queues of its priority in the order given, and a
+// worker whose queue ran dry steals from the others of its priority, so one
+// slow function does not hold back the ones queued behind it.
+class ThreadPool {
+public:
+    using Task = std::function<void(uint32_t Worker)>;
+
+    // Threads per priority; 0 means one per hardware thread.
+    explicit ThreadPool(uint32_t Threads = 0);
+    ~ThreadPool();
+
+    inline uint32_t getThreadCount() const { return Threads; }
+
+    // Queues Tasks, most expensive first, and blocks until all of them ran.
+    // Worker is the index of the thread running the task among those of
+    // Priority, below getThreadCount(), for per-thread state.
+    void Run(std::vector<Task> &Tasks, CompilePriority Priority);
+
+private:
+    struct Batch {
+        std::atomic<uint32_t>    Left;
+        std::mutex               Lock;
+        std::condition_variable  Done;
+    };
+
+    struct Entry {
+        Task   *Fn;
+        Batch  *Owner;
+    };
+
+    struct Queue {
+        std::mutex         Lock;
+        std::deque<Entry>  Entries;
+    };
+
+    // The workers of one priority. A thread's nice level is only ever
+    // lowered, once, when it starts: raising it back needs CAP_SYS_NICE.
+    struct Group {
+        std::once_flag                       Started;
+        std::vector<std::unique_ptr<Queue>>  Queues;
+        std::vector<std::thread>             Workers;
+        std::atomic<uint32_t>                Pending{0};
+        std::atomic<uint32_t>                NextQueue{0};
+        std::condition_variable              Idle;
+    };
+
+    bool Take(Group &G, uint32_t Worker, Entry &E);
+    void WorkerLoop(CompilePriority Priority, uint32_t Worker);
+
+    uint32_t    Threads;
+    Group       Groups[NumCompilePriorities];
+    std::mutex  IdleLock;
+    bool        Stop{false};
+};
+
+} // namespace compiler
+} // namespace wasmrt
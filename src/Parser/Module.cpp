@@ -0,0 +1,45 @@
+#include "Module.h"
+
+namespace wasmrt {
+namespace parser {
+namespace module {
+
+uint32_t NamePool::probe(std::string_view Name, uint64_t Hash) const {
+    uint32_t Mask = Slots.size() - 1;
+    uint32_t I = Hash & Mask;
+    while (Slots[I] != 0) {
+        auto &E = Entries[Slots[I] - 1];
+        if (E.Hash == Hash && E.Str == Name)
+            break;
+        I = (I + 1) & Mask;
+    }
+    return I;
+}
+
+NameIdx NamePool::intern(std::string_view Name) {
+    // Kept at most half full.
+    if ((Entries.size() + 1) * 2 > Slots.size()) {
+        std::vector<uint32_t> Old(std::max<size_t>(16, Slots.size() * 2), 0);
+        Old.swap(Slots);
+        for (uint32_t i = 0; i < Entries.size(); ++i)
+            Slots[probe(Entries[i].Str, Entries[i].Hash)] = i + 1;
+    }
+    auto Hash = support::hash::Hash64(Name.data(), Name.size());
+    auto Slot = probe(Name, Hash);
+    if (Slots[Slot] == 0) {
+        Entries.push_back({Name, Hash});
+        Slots[Slot] = Entries.size();
+    }
+    return Slots[Slot] - 1;
+}
+
+NameIdx NamePool::find(std::string_view Name) const {
+    if (Slots.empty())
+        return NoName;
+    auto Slot = probe(Name, support::hash::Hash64(Name.data(), Name.size()));
+    return Slots[Slot] == 0 ? NoName : Slots[Slot] - 1;
+}
+
+} // namespace module
+} // namespace parser
+} // namespace wasmrt
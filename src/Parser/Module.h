@@ -1,9 +1,18 @@
 #pragma once
 
+#include "Support/Hash.h"
+
 #include "Bytecode.h"
+#include "NameIndex.h"
 #include "Type.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -11,6 +20,11 @@ using namespace wasmrt::parser::type;
 
 namespace wasmrt {
 namespace parser {
+
+namespace reader {
+struct SimpleBuffer;
+} // namespace reader
+
 namespace module {
 
 using Expr = wasmrt::parser::bytecode::Expr;
@@ -19,6 +33,7 @@ inline constexpr uint32_t MagicNumber    = 0x6D736100;
 inline constexpr uint32_t SupportVersion = 0x00000001;
 inline constexpr uint32_t PageSize 		 = 65536;      	// 64KB
 inline constexpr uint32_t MaxPageCount 	 = 65536; 	 	// 2^16
+inline constexpr uint64_t MaxPageCount64 = 1ull << 48;	// 2^64 / PageSize
 
 enum SectionID {
 	SecCustomID = 0,
@@ -32,7 +47,8 @@ enum SectionID {
 	SecStartID,
 	SecElemID,
 	SecCodeID,
-	SecDataID
+	SecDataID,
+	SecDataCountID
 };
 
 enum ImportTag {
@@ -49,24 +65,52 @@ enum ExportTag {
 	ExportTagGlobal = 3
 };
 
+// Borrows from the module bytes (see Module::Source).
 struct CustomSec {
-	CustomSec(std::string &&Name, uint8_t *Bytes)
-		: Name(std::move(Name)), Bytes(Bytes) {}
+	std::string_view  Name;
+	const uint8_t*	  Bytes;
+	uint32_t		  Size;
+};
 
-	CustomSec(CustomSec &&Other)
-		: Name(std::move(Other.Name)), Bytes(Other.Bytes) {
-		Other.Bytes = nullptr;
-	}
+using NameIdx = uint32_t;
+inline constexpr NameIdx NoName = UINT32_MAX;
 
-	~CustomSec() {
-		if (Bytes != nullptr)
-			delete[] Bytes;
-	}
+// Import and export names of one module, interned: equal names share one
+// entry, hashed once. Entries are views into the module bytes, which the
+// module borrows anyway (see Module::Source), so reading names copies
+// nothing. The open-addressed table doubles as the export index.
+class NamePool {
+public:
+	NameIdx intern(std::string_view Name);
+	NameIdx find(std::string_view Name) const;
+
+	inline std::string_view get(NameIdx Idx) const { return Entries[Idx].Str; }
+	inline uint64_t getHash(NameIdx Idx) const { return Entries[Idx].Hash; }
+	inline uint32_t size() const { return Entries.size(); }
+
+private:
+	struct Entry {
+		std::string_view  Str;
+		uint64_t          Hash;
+	};
+
+	// Slot holding Name or the empty slot where it would go.
+	uint32_t probe(std::string_view Name, uint64_t Hash) const;
 
-	std::string  Name;
-	uint8_t*	 Bytes;
+	std::vector<Entry>     Entries;
+	std::vector<uint32_t>  Slots;	// Entries index + 1, 0 when empty
 };
 
+// What imports are matched by: the hash of the name seeded with the hash of
+// the module name, so host registries can key on a single integer.
+inline uint64_t getImportHash(uint64_t ModuleHash, std::string_view Name) {
+	return support::hash::Hash64(Name.data(), Name.size(), ModuleHash);
+}
+
+inline uint64_t getImportHash(std::string_view ModuleName, std::string_view Name) {
+	return getImportHash(support::hash::Hash64(ModuleName.data(), ModuleName.size()), Name);
+}
+
 struct ImportDesc {
 	uint8_t  Tag;
 	union {
@@ -78,33 +122,73 @@ struct ImportDesc {
 };
 
 struct Import {
-	Import(Import &&Other)
-		: Module(std::move(Other.Module)),
-		  Name(std::move(Other.Name)), Desc(Desc) {}
+	NameIdx     Module;
+	NameIdx     Name;
+	uint64_t    Hash;	// getImportHash of both names
+	ImportDesc  Desc;
+};
+
+// A constant expression, folded while reading: either an immediate or the
+// value of an imported global plus an addend, which instantiation only has
+// to store. Arithmetic the reader cannot fold, such as a product of globals
+// or an immediate minus a global, is kept as a program in Module::ConstOps.
+enum ConstExprKind {
+	ConstImm     = 0,
+	ConstGlobal  = 1,
+	ConstProgram = 2
+};
+
+struct ConstExpr {
+	uint8_t   Kind;
+	ValType   Type;
+	uint64_t  Bits[2];	// the immediate (low word first), the global index and addend, or the first op and op count
+};
+
+// One step of a constant expression program, run on a value stack: push an
+// immediate or an imported global, or combine the top two values. All
+// values of a program have its integer type.
+enum ConstOpKind {
+	ConstOpImm    = 0,
+	ConstOpGlobal = 1,
+	ConstOpAdd    = 2,
+	ConstOpSub    = 3,
+	ConstOpMul    = 4
+};
 
-	std::string  Module;
-	std::string  Name;
-	ImportDesc   Desc;
+struct ConstOp {
+	uint8_t   Kind;
+	uint64_t  Arg;	// the immediate or the global index
 };
 
 struct Global {
 	GlobalType  Type;
-	Expr 		Init;
+	ConstExpr	Init;
+};
+
+struct ExportDesc {
+	uint8_t	  Tag;
+	uint32_t  Idx;
 };
 
 struct Export {
-	std::string	Name;
+	NameIdx		Name;
 	ExportDesc	Desc;
 };
 
-struct ExportDesc {
-	uint8_t	  Tag;
-	uint32_t  Idx;
+enum ElemMode {
+	ElemActive      = 0,
+	ElemPassive     = 1,
+	ElemDeclarative = 2	// only declares functions for ref.func
 };
 
+// Marks a ref.null entry in Elem::Init.
+inline constexpr FuncIdx NullElem = UINT32_MAX;
+
 struct Elem {
+	uint8_t               Mode;
+	ValType               Type;	// funcref or externref
 	TableIdx              Table;
-	Expr                  Offset;
+	ConstExpr             Offset;
 	std::vector<FuncIdx>  Init;
 };
 
@@ -115,7 +199,7 @@ struct Locals {
 
 struct Code {
 	uint64_t getLocalCount() const {
-		uint64_t Prev = 0, Cur;
+		uint64_t Prev = 0, Cur = 0;
 		uint64_t LocalLimit = (0x1 << (sizeof(uint32_t) << 3)) - 1;
 		for (auto &Locals : LocalGroup) {
 			Cur = Prev + Locals.Number;
@@ -128,12 +212,33 @@ struct Code {
 
 	std::vector<Locals>  LocalGroup;
 	Expr                 Expr;
+	uint32_t             CallIndirectSites{0};
+	uint32_t             Size{0};	// of the body in bytes, orders compilation
+};
+
+enum DataMode {
+	DataActive         = 0,	// memory 0, offset expr
+	DataPassive        = 1,	// only used through memory.init
+	DataActiveExplicit = 2	// memory index, offset expr
 };
 
+// Init borrows from the module bytes (see Module::Source) instead of owning
+// a copy, so a segment is copied once, straight into linear memory.
 struct Data {
+	uint8_t  			  Mode;
 	MemIdx  			  Mem;
-	Expr    			  Offset;
-	std::vector<uint8_t>  Init;
+	ConstExpr  			  Offset;
+	const uint8_t*		  Init;
+	uint32_t			  Size;
+};
+
+// Parameter and result types of a block. Single-value block types point into
+// static storage, type-index ones into the type section.
+struct BlockSignature {
+	const ValType*  Params;
+	uint32_t        NumParams;
+	const ValType*  Results;
+	uint32_t        NumResults;
 };
 
 struct Module {
@@ -142,17 +247,50 @@ struct Module {
 	FuncIdx   				StartSec;
 	std::vector<CustomSec> 	CustomSecs;
 	std::vector<FuncType>  	TypeSec;
+	std::vector<uint32_t>	TypeIds;	// first type index with the same signature
 	std::vector<Import>  	ImportSec;
+	uint32_t				NumImportedFuncs{0};	// imports take the first function indices
 	std::vector<TypeIdx>   	FuncSec;
+	std::vector<TypeIdx>	FuncTypes;	// type of every function, imports first
 	std::vector<TableType> 	TableSec;
 	std::vector<MemType>   	MemSec;
 	std::vector<Global>    	GlobalSec;
+	std::vector<ConstOp>	ConstOps;	// programs of all unfolded constant expressions
 	std::vector<Export>    	ExportSec;
+	NamePool				Names;
+	std::vector<uint32_t>	ExportOf;	// export by NameIdx, UINT32_MAX if none
 	std::vector<Elem>      	ElemSec;
 	std::vector<Code>    	CodeSec;
 	std::vector<Data>		DataSec;
+	std::optional<uint32_t>	DataCount;
+	// The "name" section, indexed on first use (see getNameIndex).
+	std::unique_ptr<LazyNameIndex> NameSec;
+	// Keeps the binary alive for everything borrowing from it.
+	std::shared_ptr<const reader::SimpleBuffer> Source;
 };
 
+inline const Export *findExport(const Module &M, std::string_view Name) {
+	auto Idx = M.Names.find(Name);
+	if (Idx == NoName || Idx >= M.ExportOf.size() || M.ExportOf[Idx] == UINT32_MAX)
+		return nullptr;
+	return &M.ExportSec[M.ExportOf[Idx]];
+}
+
+inline BlockSignature getBlockSignature(const Module &M, BlockType BT) {
+	static constexpr ValType Single[] = {ValTypeI32, ValTypeI64, ValTypeF32, ValTypeF64,
+										 ValTypeV128, ValTypeFuncRef, ValTypeExternRef};
+	if (isTypeIndex(BT)) {
+		auto &Type = M.TypeSec[BT];
+		return {Type.ParamTypes.data(), uint32_t(Type.ParamTypes.size()),
+				Type.ResultTypes.data(), uint32_t(Type.ResultTypes.size())};
+	}
+	if (BT == BlockTypeEmpty)
+		return {nullptr, 0, nullptr, 0};
+	// Single-value block types are the value type byte, sign extended.
+	auto *Result = std::find(std::begin(Single), std::end(Single), ValType(BT & 0x7F));
+	return {nullptr, 0, Result, 1};
+}
+
 } // namespace module
 } // namespace parser
 } // namespace wasmrt
\ No newline at end of file
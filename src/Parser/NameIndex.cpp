@@ -0,0 +1,190 @@
+#include "Module.h"
+#include "NameIndex.h"
+
+namespace wasmrt {
+namespace parser {
+namespace module {
+
+namespace {
+
+// Bounds-checked reads over the section; any failure sticks.
+struct Cursor {
+    const uint8_t *Begin, *P, *End;
+    bool Ok{true};
+
+    uint32_t offset() const { return P - Begin; }
+
+    uint8_t readByte() {
+        if (P == End) {
+            Ok = false;
+            return 0;
+        }
+        return *P++;
+    }
+
+    uint32_t readVarU32() {
+        uint32_t Result = 0;
+        for (uint32_t Shift = 0; Shift < 35; Shift += 7) {
+            auto Byte = readByte();
+            Result |= uint32_t(Byte & 0x7F) << Shift;
+            if ((Byte & 0x80) == 0)
+                return Result;
+        }
+        Ok = false;
+        return 0;
+    }
+
+    void skip(uint32_t N) {
+        if (uint32_t(End - P) < N) {
+            Ok = false;
+            P = End;
+        } else
+            P += N;
+    }
+
+    // Offset of the name, which is skipped.
+    uint32_t skipName() {
+        auto Off = offset();
+        skip(readVarU32());
+        return Off;
+    }
+
+    // Skips a name map, checking that indices increase.
+    void skipNameMap() {
+        auto N = readVarU32();
+        for (uint32_t i = 0, Prev = 0; i < N && Ok; ++i) {
+            auto Idx = readVarU32();
+            if (i > 0 && Idx <= Prev)
+                Ok = false;
+            Prev = Idx;
+            skipName();
+        }
+    }
+};
+
+bool ReadIndirectNameMap(Cursor &C, std::vector<uint32_t> &Maps, uint32_t NumFuncs) {
+    Maps.assign(NumFuncs, UINT32_MAX);
+    auto N = C.readVarU32();
+    for (uint32_t i = 0; i < N && C.Ok; ++i) {
+        auto Func = C.readVarU32();
+        if (Func >= NumFuncs || Maps[Func] != UINT32_MAX)
+            return false;
+        Maps[Func] = C.offset();
+        C.skipNameMap();
+    }
+    return C.Ok;
+}
+
+} // namespace
+
+NameIndex::NameIndex(const uint8_t *Bytes, uint32_t Size, uint32_t NumFuncs)
+    : Bytes(Bytes), Size(Size) {
+    if (!build(NumFuncs)) {
+        ModuleName = None;
+        FuncNames.clear();
+        LocalMaps.clear();
+        LabelMaps.clear();
+    }
+}
+
+bool NameIndex::build(uint32_t NumFuncs) {
+    Cursor C{Bytes, Bytes, Bytes + Size};
+    int PrevID = -1;
+    while (C.P != C.End) {
+        auto ID = C.readByte();
+        auto N = C.readVarU32();
+        if (!C.Ok || uint32_t(C.End - C.P) < N || int(ID) <= PrevID)
+            return false;
+        PrevID = ID;
+
+        Cursor Sub{Bytes, C.P, C.P + N};
+        C.skip(N);
+        switch (ID) {
+            case NameModuleID:
+                ModuleName = Sub.skipName();
+                break;
+            case NameFuncID: {
+                FuncNames.assign(NumFuncs, None);
+                auto Count = Sub.readVarU32();
+                for (uint32_t i = 0; i < Count && Sub.Ok; ++i) {
+                    auto Func = Sub.readVarU32();
+                    if (Func >= NumFuncs || FuncNames[Func] != None)
+                        return false;
+                    FuncNames[Func] = Sub.skipName();
+                }
+                break;
+            }
+            case NameLocalID:
+                if (!ReadIndirectNameMap(Sub, LocalMaps, NumFuncs))
+                    return false;
+                break;
+            case NameLabelID:
+                if (!ReadIndirectNameMap(Sub, LabelMaps, NumFuncs))
+                    return false;
+                break;
+            default:
+                // Other subsections (types, tables, ...) are not indexed.
+                continue;
+        }
+        if (!Sub.Ok || Sub.P != Sub.End)
+            return false;
+    }
+    return true;
+}
+
+std::string_view NameIndex::nameAt(uint32_t Off) const {
+    Cursor C{Bytes, Bytes + Off, Bytes + Size};
+    auto N = C.readVarU32();
+    return {reinterpret_cast<const char *>(C.P), N};
+}
+
+std::string_view NameIndex::findIn(const std::vector<uint32_t> &Maps, FuncIdx Func, uint32_t Idx) const {
+    if (Func >= Maps.size() || Maps[Func] == None)
+        return {};
+    Cursor C{Bytes, Bytes + Maps[Func], Bytes + Size};
+    auto N = C.readVarU32();
+    for (uint32_t i = 0; i < N; ++i) {
+        auto Cur = C.readVarU32();
+        if (Cur > Idx)
+            break;
+        auto Off = C.skipName();
+        if (Cur == Idx)
+            return nameAt(Off);
+    }
+    return {};
+}
+
+std::string_view NameIndex::getModuleName() const {
+    return ModuleName == None ? std::string_view() : nameAt(ModuleName);
+}
+
+std::string_view NameIndex::getFuncName(FuncIdx Func) const {
+    if (Func >= FuncNames.size() || FuncNames[Func] == None)
+        return {};
+    return nameAt(FuncNames[Func]);
+}
+
+std::string_view NameIndex::getLocalName(FuncIdx Func, uint32_t Local) const {
+    return findIn(LocalMaps, Func, Local);
+}
+
+std::string_view NameIndex::getLabelName(FuncIdx Func, uint32_t Label) const {
+    return findIn(LabelMaps, Func, Label);
+}
+
+const NameIndex *getNameIndex(const Module &M) {
+    auto *Lazy = M.NameSec.get();
+    if (Lazy == nullptr)
+        return nullptr;
+    std::call_once(Lazy->Once, [&] {
+        uint32_t NumFuncs = M.FuncSec.size();
+        for (auto &Import : M.ImportSec)
+            NumFuncs += Import.Desc.Tag == ImportTagFunc;
+        Lazy->Index.emplace(Lazy->Bytes, Lazy->Size, NumFuncs);
+    });
+    return &*Lazy->Index;
+}
+
+} // namespace module
+} // namespace parser
+} // namespace wasmrt
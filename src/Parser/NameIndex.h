@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Type.h"
+
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace parser {
+namespace module {
+
+struct Module;
+
+enum NameSubsecID {
+    NameModuleID = 0,
+    NameFuncID,
+    NameLocalID,
+    NameLabelID
+};
+
+// Index over the "name" custom section, built in a single pass and holding
+// only offsets into the section bytes: a function name is one lookup, a
+// local or label name a scan of that function's entries. Names are decoded
+// when asked for. A malformed section leaves the index empty, since custom
+// sections never make a module invalid.
+class NameIndex {
+public:
+    NameIndex(const uint8_t *Bytes, uint32_t Size, uint32_t NumFuncs);
+
+    // All empty when there is no name.
+    std::string_view getModuleName() const;
+    std::string_view getFuncName(FuncIdx Func) const;
+    std::string_view getLocalName(FuncIdx Func, uint32_t Local) const;
+    std::string_view getLabelName(FuncIdx Func, uint32_t Label) const;
+
+private:
+    static constexpr uint32_t None = UINT32_MAX;
+
+    bool build(uint32_t NumFuncs);
+    std::string_view nameAt(uint32_t Off) const;
+    std::string_view findIn(const std::vector<uint32_t> &Maps, FuncIdx Func, uint32_t Idx) const;
+
+    const uint8_t*         Bytes;
+    uint32_t               Size;
+    uint32_t               ModuleName{None};
+    std::vector<uint32_t>  FuncNames;   // offset of each function's name
+    std::vector<uint32_t>  LocalMaps;   // offset of each function's name map
+    std::vector<uint32_t>  LabelMaps;
+};
+
+// The name section of a module, indexed by whoever needs it first.
+struct LazyNameIndex {
+    LazyNameIndex(const uint8_t *Bytes, uint32_t Size) : Bytes(Bytes), Size(Size) {}
+
+    const uint8_t*            Bytes;
+    uint32_t                  Size;
+    std::once_flag            Once;
+    std::optional<NameIndex>  Index;
+};
+
+// Null when M has no name section.
+const NameIndex *getNameIndex(const Module &M);
+
+} // namespace module
+} // namespace parser
+} // namespace wasmrt
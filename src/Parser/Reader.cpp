@@ -1,14 +1,26 @@
 #include "Support/Output.h"
+#include "Support/Result.h"
+#include "Support/Utf8.h"
 #include "Bytecode.h"
 #include "Reader.h"
 #include "Type.h"
 
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include <cstdlib>
+#include <cstring>
 #include <bit>
-#include <ifstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <fcntl.h>
+#include <unistd.h>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <tuple>
+#include <unordered_map>
 #include <utility>
 
 using namespace wasmrt;
@@ -22,42 +34,44 @@ namespace reader {
 static std::tuple<uint64_t, size_t>
 decodeVarUint(const SimpleBuffer& SB, size_t Start, size_t Bits) {
     uint64_t Result{0};
-    for (int i = Start, e = SB.Size; i < e; ++i) {
-        uint8_t Part = SB.Buffer[i];
+    for (size_t i = 0, e = SB.Size - Start; i < e; ++i) {
+        uint8_t Part = SB.Buffer[Start + i];
         if (i == Bits / 7) {
-            if (Part & 0x80 != 0)
-                support::output::Error("decodeVarUint", "Integer is too long!");
+            if ((Part & 0x80) != 0)
+                return {0, 0};      // too long
             if ((Part >> (Bits - i * 7)) > 0)
-                support::output::Error("decodeVarUint", "Integer is too large!");
+                return {0, 0};      // too large
         }
         Result |= ((uint64_t)Part & 0x7f) << (i * 7);
-        if (Part & 0x80 == 0)
+        if ((Part & 0x80) == 0)
             return {Result, i + 1};
     }
-    support::output::Error("decodeVarUint", "Unexpected path!");
+    return {0, 0};
 }
 
 // https://en.wikipedia.org/wiki/LEB128#Decode_signed_integer
 static std::tuple<int64_t, size_t>
 decodeVarInt(const SimpleBuffer& SB, size_t Start, size_t Bits) {
-    int64_t Result{0};
-    for (int i = Start, e = SB.Size; i < e; ++i) {
-        uint8_t Part = SB.Buffer[i];
+    uint64_t Result{0};
+    for (size_t i = 0, e = SB.Size - Start; i < e; ++i) {
+        uint8_t Part = SB.Buffer[Start + i];
         if (i == Bits / 7) {
-            if (Part & 0x80 != 0)
-                support::output::Error("decodeVarInt", "Integer is too long!");
-            if ((Part & 0x40 == 0) && (Part >> (Bits - i * 7 - 1) != 0) ||
-				(Part & 0x40 != 0) && (((int8_t)Part | 0x80) >> (Bits - i * 7 - 1) != -1))
-                support::output::Error("decodeVarUint", "Integer is too large!");
+            if ((Part & 0x80) != 0)
+                return {0, 0};      // too long
+            // The unused high bits must all be copies of the sign bit.
+            size_t Used = Bits - i * 7;
+            uint8_t High = Part >> (Used - 1);
+            if (High != 0 && High != (0x7f >> (Used - 1)))
+                return {0, 0};      // too large
         }
-        Result |= ((int64_t)Part & 0x7f) << (i * 7);
-        if (Part & 0x80 == 0) {
-            if ((i * 7 < Bits) && (Part & 0x40 != 0))
-				Result |= (-1 << ((i + 1) * 7));
-            return {Result, i + 1};
+        Result |= ((uint64_t)Part & 0x7f) << (i * 7);
+        if ((Part & 0x80) == 0) {
+            if ((i + 1) * 7 < 64 && (Part & 0x40) != 0)
+                Result |= ~0ull << ((i + 1) * 7);
+            return {int64_t(Result), i + 1};
         }
     }
-    support::output::Error("decodeVarInt", "Unexpected path!");
+    return {0, 0};
 }
 
 template<class U, size_t... N>
@@ -72,6 +86,10 @@ static T bswap(T Val) {
 	*reinterpret_cast<U*>(Val), std::make_index_sequence<sizeof(U)>{}));
 }
 
+// Blocks nest by recursion in readInstructions, so their depth is bounded
+// to keep a hostile module from exhausting the parsing thread's stack.
+static constexpr uint32_t MaxBlockDepth = 4096;
+
 template <bool translate = false>
 class ModuleParser {
 public:
@@ -85,15 +103,22 @@ public:
     uint8_t readZero();
     uint8_t readByte();
     uint8_t *readBytes();
+    void readFixedBytes(uint8_t *Dst, size_t N);
+    std::tuple<const uint8_t *, uint32_t> viewBytes();
     uint32_t readU32();
     float readF32();
     double readF64();
     uint32_t readVarU32();
     int32_t readVarS32();
+    int64_t readVarS64();
     uint64_t readVarU64();
-    std::string readName();
+    uint64_t readMemOffset();
+    std::string_view readName();
+    bytecode::Instruction *readMiscInstruction();
+    bytecode::Instruction *readSimdInstruction();
     std::tuple<module::Expr, uint8_t> readInstructions();
     module::Expr readExpr();
+    module::ConstExpr readConstExpr(Module &M, type::ValType Expected);
     std::vector<uint32_t> readIndices();
     void ReadTypeSec(Module &M);
     void ReadImportSec(Module &M);
@@ -104,6 +129,7 @@ public:
     void ReadElemSec(Module &M);
     void ReadCodeSec(Module &M);
     void ReadDataSec(Module &M);
+    void ReadCustomSec(Module &M);
     void ReadNonCustomSec(uint8_t SecID, Module &M);
     type::ValType ReadValType();
     std::vector<type::ValType> ReadValTypes();
@@ -114,22 +140,43 @@ public:
     type::BlockType readBlockType();
     void ReadSections(Module &M);
 
-    Module *parse();
+    // The first error ends parsing: it is kept, and every read after it sees
+    // an empty buffer, so the section loops run out without further checks.
+    template <typename... Types>
+    void fail(const char *Function, const char *Format, Types... Args) {
+        if (!Failed)
+            Failed = support::result::MakeFailure(Function, Format, Args...);
+        Idx = SB.Size;
+    }
+    inline bool ok() const { return !Failed; }
 
+    // A vector length; each element takes at least a byte.
+    uint32_t readCount();
+
+    support::result::Result<std::unique_ptr<Module>> parse();
+
+    std::optional<support::result::Failure> Failed;
     size_t              Idx{0};
+    uint32_t            NumTypes{0};
+    bool                Memory64{false};    // memory 0 takes i64 addresses
+    uint32_t            CallIndirectSites{0};
+    uint32_t            BlockDepth{0};
+    uint32_t            NumElemSegs{0};
+    std::optional<uint32_t> DataCount;      // memory.init and data.drop require it
+    std::vector<type::GlobalType> ImportedGlobals;  // for global.get in constant expressions
     const SimpleBuffer& SB;
 };
 
 uint8_t ModuleParser::readZero() {
     auto Byte = readByte();
     if (Byte != 0)
-        support::output::Error("ModuleParser::readZero", "zero flag expected, got %d", Byte);
+        fail("ModuleParser::readZero", "zero flag expected, got %d", Byte);
     return 0;
 }
 
 uint8_t ModuleParser::readByte() {
     if (remaining() < 1) {
-        support::output::Error("ModuleParser::readByte", "Remaining len(Bytes) < 1!");
+        fail("ModuleParser::readByte", "Remaining len(Bytes) < 1!");
         return -1;
     }
     return *SB.Buffer[Idx++];
@@ -138,21 +185,45 @@ uint8_t ModuleParser::readByte() {
 uint8_t *ModuleParser::readBytes() {
     auto N = readVarU32();
     if (remaining() < N) {
-        support::output::Error("ModuleParser::readBytes",
+        fail("ModuleParser::readBytes",
             "Remaining %d bytes, but want %d bytes!", remaining(), N);
+        return nullptr;
     }
 
     auto *Bytes = new uint8_t[N];
     if (Bytes == nullptr)
-        support::output::Error("ModuleParser::readBytes", "Cannot allocate %d bytes!", N);
+        fail("ModuleParser::readBytes", "Cannot allocate %d bytes!", N);
     memcpy(Bytes, SB.Buffer + Idx, N);
     Idx += N;
     return Bytes;
 }
 
+void ModuleParser::readFixedBytes(uint8_t *Dst, size_t N) {
+    if (remaining() < N) {
+        fail("ModuleParser::readFixedBytes",
+            "Remaining %d bytes, but want %d bytes!", remaining(), N);
+        memset(Dst, 0, N);
+        return;
+    }
+    memcpy(Dst, SB.Buffer + Idx, N);
+    Idx += N;
+}
+
+std::tuple<const uint8_t *, uint32_t> ModuleParser::viewBytes() {
+    auto N = readVarU32();
+    if (remaining() < N) {
+        fail("ModuleParser::viewBytes",
+            "Remaining %d bytes, but want %d bytes!", remaining(), N);
+        return {nullptr, 0};
+    }
+    const uint8_t *Bytes = SB.Buffer + Idx;
+    Idx += N;
+    return {Bytes, N};
+}
+
 uint32_t ModuleParser::readU32() {
     if (remaining() < 4) {
-        support::output::Error("ModuleParser::readU32", "Remaining len(Bytes) < 4!");
+        fail("ModuleParser::readU32", "Remaining len(Bytes) < 4!");
         return -1;
     }
     uint32_t Result = *reinterpret_cast<uint32_t*>(&SB.Buffer[Idx]);
@@ -162,7 +233,7 @@ uint32_t ModuleParser::readU32() {
 
 float ModuleParser::readF32() {
     if (remaining() < 4) {
-        support::output::Error("ModuleParser::readF32", "Remaining len(Bytes) < 4!");
+        fail("ModuleParser::readF32", "Remaining len(Bytes) < 4!");
         return -1;
     }
     float Result = *reinterpret_cast<float*>(&SB.Buffer[Idx]);
@@ -172,7 +243,7 @@ float ModuleParser::readF32() {
 
 double ModuleParser::readF64() {
     if (remaining() < 8) {
-        support::output::Error("ModuleParser::readF64", "Remaining len(Bytes) < 8!");
+        fail("ModuleParser::readF64", "Remaining len(Bytes) < 8!");
         return -1;
     }
     double Result = *reinterpret_cast<double*>(&SB.Buffer[Idx]);
@@ -182,63 +253,51 @@ double ModuleParser::readF64() {
 
 uint32_t ModuleParser::readVarU32() {
     auto [N, Bytes] = decodeVarUint(SB, Idx, 32);
+    if (Bytes == 0)
+        fail("ModuleParser::readVarU32", "malformed integer at offset %zu", Idx);
     Idx += Bytes;
     return (uint32_t)N;
 }
 
+uint32_t ModuleParser::readCount() {
+    auto N = readVarU32();
+    if (N > remaining()) {
+        fail("ModuleParser::readCount", "length out of bounds: %u", N);
+        return 0;
+    }
+    return N;
+}
+
 int32_t ModuleParser::readVarS32() {
-    auto [N, Bytes] = decodeVarUint(SB, Idx, 32);
+    auto [N, Bytes] = decodeVarInt(SB, Idx, 32);
+    if (Bytes == 0)
+        fail("ModuleParser::readVarS32", "malformed integer at offset %zu", Idx);
     Idx += Bytes;
     return (int32_t)N;
 }
 
-uint64_t ModuleParser::readVarU64() {
-    auto [N, Bytes] = decodeVarUint(SB, Idx, 64);
+int64_t ModuleParser::readVarS64() {
+    auto [N, Bytes] = decodeVarInt(SB, Idx, 64);
+    if (Bytes == 0)
+        fail("ModuleParser::readVarS64", "malformed integer at offset %zu", Idx);
     Idx += Bytes;
     return N;
 }
 
-// https://www.jianshu.com/p/a83d398e3606
-static bool IsUtf8(unsigned char* data, int len) {
-    static auto PreNum = [](uint8_t byte) {
-        int num = 0;
-        uint8_t mask = 0x80;
-        for (int i = 0; i < 8; i++) {
-            if ((byte & mask) == mask) {
-                mask >>= 1;
-                ++num;
-            } else
-                break;
-        }
-        return num;
-    };
-
-    int i = 0, num = 0;
-    while (i < len) {
-        if ((data[i] & 0x80) == 0x00) {
-            ++i;
-            continue;
-        }
-        
-        if ((num = PreNum(data[i])) > 2) {       
-            ++i;
-            for(int j = 0; j < num - 1; j++) {
-                if ((data[i] & 0xc0) != 0x80)
-                    return false;
-                ++i;
-            }
-        } else
-            return false;
-    } 
-    return true;
+uint64_t ModuleParser::readVarU64() {
+    auto [N, Bytes] = decodeVarUint(SB, Idx, 64);
+    if (Bytes == 0)
+        fail("ModuleParser::readVarU64", "malformed integer at offset %zu", Idx);
+    Idx += Bytes;
+    return N;
 }
 
-std::string ModuleParser::readName() {
-    auto RemainingBeforeRead = remaining();
-    auto *Bytes = readBytes();
-    if (!IsUtf8(Bytes, remaining() - RemainingBeforeRead))
-        support::output::Error("ModuleParser::readName", "malformed UTF-8 encoding");
-    return std::string(reinterpret_cast<char *>readBytes());
+// A view into the module bytes; names are interned, never copied.
+std::string_view ModuleParser::readName() {
+    auto [Bytes, N] = viewBytes();
+    if (!support::utf8::IsUtf8(Bytes, N))
+        fail("ModuleParser::readName", "malformed UTF-8 encoding");
+    return {reinterpret_cast<const char *>(Bytes), N};
 }
 
 type::ValType ModuleParser::ReadValType() {
@@ -248,15 +307,18 @@ type::ValType ModuleParser::ReadValType() {
         case type::ValTypeI64:
         case type::ValTypeF32:
         case type::ValTypeF64:
+        case type::ValTypeV128:
+        case type::ValTypeFuncRef:
+        case type::ValTypeExternRef:
             break;
         default:
-            support::output::Error("ModuleParser::ReadValType", "malformed value type: %d", Tag);
+            fail("ModuleParser::ReadValType", "malformed value type: %d", Tag);
     }
     return Tag;
 }
 
 std::vector<type::ValType> ModuleParser::ReadValTypes() {
-    int N = readVarU32();
+    int N = readCount();
     std::vector<type::ValType> Vec(N);
     for (int i = 0; i < N; ++i)
         Vec[i] = ReadValType();
@@ -266,59 +328,212 @@ std::vector<type::ValType> ModuleParser::ReadValTypes() {
 type::FuncType ModuleParser::ReadFuncType() {
     auto Tag = ReadByte();
     if (Tag != type::FtTag)
-        support::output::Error("ModuleParser::ReadFuncType", "invalid functype tag: %d", Tag);
+        fail("ModuleParser::ReadFuncType", "invalid functype tag: %d", Tag);
     return FuncType(Tag, ReadValTypes(), ReadValTypes());
 }
 
 type::TableType ModuleParser::readTableType() {
     type::TableType TT = {readByte(), readRangeType()};
-    if (TT.ElemType != type::FuncRef)
-        support::output::Error("ModuleParser::ReadFuncType", "invalid elemtype: %d", TT.ElemType);
+    if (!type::isRefType(TT.ElemType))
+        fail("ModuleParser::readTableType", "invalid elemtype: %d", TT.ElemType);
+    if (TT.Range.is64())
+        fail("ModuleParser::readTableType", "tables cannot be 64-bit");
+    if (TT.Range.isShared())
+        fail("ModuleParser::readTableType", "tables cannot be shared");
     return TT;
 }
 
 type::RangeType ModuleParser::readRangeType() {
-    type::RangeType Range = {readByte(), readVarU32()};
-    if (Range.Tag == 1)
-        Range.Max = readVarU32();
+    type::RangeType Range = {readByte()};
+    if (Range.Tag > (type::LimitsHasMax | type::LimitsShared | type::LimitsIs64))
+        fail("ModuleParser::readRangeType", "malformed limits flags: %d", Range.Tag);
+    if (Range.isShared() && !Range.hasMax())
+        fail("ModuleParser::readRangeType", "shared memory must have maximum");
+    Range.Min = Range.is64() ? readVarU64() : readVarU32();
+    if (Range.hasMax())
+        Range.Max = Range.is64() ? readVarU64() : readVarU32();
     return Range;
 }
 
+// memarg offsets are u64 for memory64 and must fit 32 bits otherwise.
+uint64_t ModuleParser::readMemOffset() {
+    auto Offset = readVarU64();
+    if (!Memory64 && Offset > UINT32_MAX)
+        fail("ModuleParser::readMemOffset", "offset out of range: %lu", Offset);
+    return Offset;
+}
+
 type::GlobalType ModuleParser::readGlobalType() {
     type::GlobalType GT = {readValType(), readByte()};
-    if (GT.Mut != type::MutConst || GT.Mut != type::MutVar)
-        support::output::Error("ModuleParser::readGlobalType", "malformed mutability: %d", gt.Mut);
+    if (GT.Mut != type::MutConst && GT.Mut != type::MutVar)
+        fail("ModuleParser::readGlobalType", "malformed mutability: %d", GT.Mut);
     return GT;
 }
 
+// A block type is a signed 33-bit LEB: negative values are the single-byte
+// value types and the empty type, non-negative ones index the type section.
 type::BlockType ModuleParser::readBlockType() {
-    auto BT = readVarS32();
+    auto [BT, Bytes] = decodeVarInt(SB, Idx, 33);
+    if (Bytes == 0) {
+        fail("ModuleParser::readBlockType", "malformed block type at offset %zu", Idx);
+        return type::BlockTypeEmpty;
+    }
+    Idx += Bytes;
     if (BT < 0) {
         switch (BT) {
             case type::BlockTypeI32: case type::BlockTypeI64:
 			case type::BlockTypeF32: case type::BlockTypeF64:
-			case type::BlockTypeEmpty:
-                return BT;
+			case type::BlockTypeV128: case type::BlockTypeEmpty:
+			case type::BlockTypeFuncRef: case type::BlockTypeExternRef:
+                return type::BlockType(BT);
             default:
-                support::output::Error("ModuleParser::readGlobalType", "malformed block type: %d", BT);
+                fail("ModuleParser::readBlockType", "malformed block type: %ld", BT);
+                return type::BlockTypeEmpty;
         }
     }
-    return BT;
+    if (uint64_t(BT) >= NumTypes) {
+        fail("ModuleParser::readBlockType", "unknown block type index: %ld", BT);
+        return type::BlockTypeEmpty;
+    }
+    return type::BlockType(BT);
 }
 
 std::vector<uint32_t> ModuleParser::readIndices(Module &M) {
-    std::vector<uint32_t> Indices(readVarU32());
+    std::vector<uint32_t> Indices(readCount());
     for (auto &Indice : Indices)
         Indice = readVarU32();
     return std::move(Indices);
 }
 
+bytecode::Instruction *ModuleParser::readMiscInstruction() {
+    auto SubOp = readVarU32();
+    if (bytecode::MiscOpNames.count(SubOp) == 0)
+        fail("ModuleParser::readMiscInstruction", "undefined 0xfc opcode: %d", SubOp);
+
+    auto Op = bytecode::MiscOp(SubOp);
+    switch (Op) {
+        case bytecode::MemoryInit:
+        case bytecode::DataDrop: {
+            // The code section comes before the data section, so segment
+            // indices can only be checked against the data count.
+            auto Data = readVarU32();
+            if (!DataCount)
+                fail("ModuleParser::readMiscInstruction", "data count section required");
+            else if (Data >= *DataCount)
+                fail("ModuleParser::readMiscInstruction", "unknown data segment %u", Data);
+            if (Op == bytecode::MemoryInit)
+                readZero();
+            return new bytecode::MiscInst(Op, Data);
+        }
+        case bytecode::ElemDrop: {
+            auto Elem = readVarU32();
+            if (Elem >= NumElemSegs)
+                fail("ModuleParser::readMiscInstruction", "unknown elem segment %u", Elem);
+            return new bytecode::MiscInst(Op, Elem);
+        }
+        case bytecode::TableGrow:
+        case bytecode::TableSize:
+        case bytecode::TableFill:
+            return new bytecode::MiscInst(Op, readVarU32());
+        case bytecode::MemoryCopy:
+            readZero();
+            readZero();
+            return new bytecode::MiscInst(Op);
+        case bytecode::MemoryFill:
+            readZero();
+            return new bytecode::MiscInst(Op);
+        case bytecode::TableInit: {
+            auto Elem = readVarU32();
+            if (Elem >= NumElemSegs)
+                fail("ModuleParser::readMiscInstruction", "unknown elem segment %u", Elem);
+            return new bytecode::MiscInst(Op, Elem, readVarU32());
+        }
+        case bytecode::TableCopy: {
+            auto Dst = readVarU32();
+            return new bytecode::MiscInst(Op, Dst, readVarU32());
+        }
+        default:
+            return new bytecode::MiscInst(Op);
+    }
+}
+
+// Lanes addressed by the lane immediate of a SIMD op, 0 if it has none.
+static uint8_t SimdLaneCount(uint32_t SubOp) {
+    switch (SubOp) {
+        case bytecode::I8x16ExtractLaneS: case bytecode::I8x16ExtractLaneU:
+        case bytecode::I8x16ReplaceLane:
+        case bytecode::V128Load8Lane: case bytecode::V128Store8Lane:
+            return 16;
+        case bytecode::I16x8ExtractLaneS: case bytecode::I16x8ExtractLaneU:
+        case bytecode::I16x8ReplaceLane:
+        case bytecode::V128Load16Lane: case bytecode::V128Store16Lane:
+            return 8;
+        case bytecode::I32x4ExtractLane: case bytecode::I32x4ReplaceLane:
+        case bytecode::F32x4ExtractLane: case bytecode::F32x4ReplaceLane:
+        case bytecode::V128Load32Lane: case bytecode::V128Store32Lane:
+            return 4;
+        case bytecode::I64x2ExtractLane: case bytecode::I64x2ReplaceLane:
+        case bytecode::F64x2ExtractLane: case bytecode::F64x2ReplaceLane:
+        case bytecode::V128Load64Lane: case bytecode::V128Store64Lane:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
+bytecode::Instruction *ModuleParser::readSimdInstruction() {
+    auto SubOp = readVarU32();
+    if (bytecode::SimdOpNames.count(SubOp) == 0)
+        fail("ModuleParser::readSimdInstruction", "undefined simd opcode: %d", SubOp);
+
+    auto Op = bytecode::SimdOp(SubOp);
+    auto Lanes = SimdLaneCount(SubOp);
+    auto readLane = [&] {
+        auto Lane = readByte();
+        if (Lane >= Lanes)
+            fail("ModuleParser::readSimdInstruction", "invalid lane index: %d", Lane);
+        return Lane;
+    };
+
+    if (Op <= bytecode::V128Store || Op == bytecode::V128Load32Zero || Op == bytecode::V128Load64Zero) {
+        auto Align = readVarU32();
+        return new bytecode::SimdMemoryInst(Op, Align, readMemOffset());
+    }
+    if (Op >= bytecode::V128Load8Lane && Op <= bytecode::V128Store64Lane) {
+        auto Align = readVarU32();
+        auto Offset = readMemOffset();
+        return new bytecode::SimdMemoryInst(Op, Align, Offset, readLane());
+    }
+    if (Op == bytecode::V128Const || Op == bytecode::I8x16Shuffle) {
+        auto *Inst = new bytecode::SimdBytesInst(Op);
+        readFixedBytes(Inst->Bytes, sizeof(Inst->Bytes));
+        if (Op == bytecode::I8x16Shuffle) {
+            for (auto Lane : Inst->Bytes) {
+                if (Lane >= 32)
+                    fail("ModuleParser::readSimdInstruction", "invalid lane index: %d", Lane);
+            }
+        }
+        return Inst;
+    }
+    if (Lanes != 0)
+        return new bytecode::SimdLaneInst(Op, readLane());
+    return new bytecode::SimdInst(Op);
+}
+
 std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
     module::Expr Instructions;
+    if (BlockDepth == MaxBlockDepth) {
+        fail("ModuleParser::readInstructions", "blocks nested deeper than %u", MaxBlockDepth);
+        return {std::move(Instructions), bytecode::End_};
+    }
+    ++BlockDepth;
     while (true) {
         auto opcode = readByte();
-        if (bytecode::OpNames.count(opcode) == 0)
-            support::output::Error("ModuleParser::readInstructions", "undefined opcode: %d", opcode);
+        if (bytecode::OpNames.count(opcode) == 0) {
+            fail("ModuleParser::readInstructions", "undefined opcode: %d", opcode);
+            --BlockDepth;
+            return {std::move(Instructions), bytecode::End_};
+        }
         bytecode::Instruction *Inst;
         switch (opcode) {
             case Block:
@@ -333,7 +548,7 @@ std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
                     auto [Insts1, End1] = readInstructions();
                     Inst->IfFalse = std::move(Insts1);
                     if (End1 != bytecode::End_)
-                        support::output::Error("ModuleParser::readInstructions", "invalid block end: %d", End1);
+                        fail("ModuleParser::readInstructions", "invalid block end: %d", End1);
                 }
                 break;
             }
@@ -341,9 +556,23 @@ std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
                 Inst = new bytecode::BrTableInst(std::move(readIndices()), readVarU32());
                 break;
             case CallIndirect:
-                Inst = new bytecode::WithArgInst(opcode, readVarU32());
-                readZero();
+            case ReturnCallIndirect: {
+                auto Type = readVarU32();
+                Inst = new bytecode::CallIndirectInst(Type, readVarU32(), CallIndirectSites++, opcode);
+                break;
+            }
+            case SelectT:
+                if (readVarU32() != 1)
+                    fail("ModuleParser::readInstructions", "invalid result arity for select");
+                Inst = new bytecode::WithArgInst(opcode, ReadValType());
                 break;
+            case RefNull: {
+                auto Type = readByte();
+                if (!type::isRefType(Type))
+                    fail("ModuleParser::readInstructions", "malformed reference type: %d", Type);
+                Inst = new bytecode::WithArgInst(opcode, Type);
+                break;
+            }
             case Br:
             case BrIf:
             case LocalGet:
@@ -351,11 +580,15 @@ std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
             case LocalTee:
             case GlobalGet:
             case GlobalSet:
+            case TableGet:
+            case TableSet:
             case Call:
+            case ReturnCall:
+            case RefFunc:
                 Inst = new bytecode::WithArgInst(opcode, readVarU32());
                 break;
             case I32Const:
-                Inst = new bytecode::WithArgInst(opcode, readVarS32());
+                Inst = new bytecode::WithArgInst(opcode, uint32_t(readVarS32()));
                 break;
             case I64Const:
                 Inst = new bytecode::WithArgInst(opcode, readVarS64());
@@ -371,11 +604,28 @@ std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
                 break;
             }
             case TruncSat:
-                Inst = new bytecode::WithArgInst(opcode, readByte());
+                Inst = readMiscInstruction();
                 break;
+            case Simd:
+                Inst = readSimdInstruction();
+                break;
+            case Atomic: {
+                auto SubOp = readVarU32();
+                if (bytecode::AtomicOpNames.count(SubOp) == 0)
+                    fail("ModuleParser::readInstructions", "undefined atomic opcode: %d", SubOp);
+                if (SubOp == bytecode::AtomicFence) {
+                    readZero();
+                    Inst = new bytecode::AtomicInst(bytecode::AtomicFence, 0, 0);
+                } else {
+                    auto Align = readVarU32();
+                    Inst = new bytecode::AtomicInst(bytecode::AtomicOp(SubOp), Align, readMemOffset());
+                }
+                break;
+            }
             default:
                 if (opcode >= bytecode::I32Load && opcode <= bytecode::I64Store32) {
-                    Inst = new bytecode::MemoryInst(opcode, readVarU32(), readVarU32());
+                    auto Align = readVarU32();
+                    Inst = new bytecode::MemoryInst(opcode, Align, readMemOffset());
                 } else {
                     if (opcode == bytecode::MemorySize || opcode == bytecode::MemoryGrow)
                         readZero();
@@ -383,195 +633,483 @@ std::tuple<module::Expr, uint8_t> ModuleParser::readInstructions() {
                 }
         }
         Instructions.emplace_back(Inst);
-        if (opcode == bytecode::Else_ || opcode == bytecode::End_)
+        if (opcode == bytecode::Else_ || opcode == bytecode::End_) {
+            --BlockDepth;
             return {Instructions, opcode};
+        }
     }
 }
 
 module::Expr ModuleParser::readExpr() {
     auto [Instructions, End] = readInstructions();
     if (End != opcode == bytecode::End_)
-        support::output::Error("ModuleParser::readExpr", "invalid expr end: %d", End);
+        fail("ModuleParser::readExpr", "invalid expr end: %d", End);
     return Instructions;
 }
 
+// Folds a constant expression without building instructions. Besides the
+// plain constants this takes the extended-const arithmetic. An imported
+// global keeps the expression symbolic, as the global plus an addend, so
+// only adding or subtracting immediates to it folds; other arithmetic on
+// globals becomes a program of ConstOps, the operands' programs first.
+// global.get must name an immutable import, ref.func a known function.
+module::ConstExpr ModuleParser::readConstExpr(Module &M, type::ValType Expected) {
+    module::ConstExpr Stack[8];
+    std::vector<module::ConstOp> Ops[std::size(Stack)];
+    size_t Depth = 0;
+    auto Push = [&](uint8_t Kind, type::ValType Type, uint64_t Lo, uint64_t Hi = 0) {
+        if (Depth == std::size(Stack)) {
+            fail("ModuleParser::readConstExpr", "constant expression too deep");
+            return;
+        }
+        Ops[Depth].clear();
+        Stack[Depth++] = {Kind, Type, {Lo, Hi}};
+    };
+    auto Lower = [&](size_t i) {
+        auto &E = Stack[i];
+        if (E.Kind == module::ConstImm) {
+            Ops[i] = {{module::ConstOpImm, E.Bits[0]}};
+        } else if (E.Kind == module::ConstGlobal) {
+            Ops[i] = {{module::ConstOpGlobal, E.Bits[0]}};
+            if (E.Bits[1] != 0)
+                Ops[i].insert(Ops[i].end(), {{module::ConstOpImm, E.Bits[1]}, {module::ConstOpAdd, 0}});
+        }
+        E.Kind = module::ConstProgram;
+    };
+
+    for (;;) {
+        auto opcode = bytecode::BytecodeOp(readByte());
+        switch (opcode) {
+            case bytecode::I32Const: Push(module::ConstImm, type::ValTypeI32, uint32_t(readVarS32())); break;
+            case bytecode::I64Const: Push(module::ConstImm, type::ValTypeI64, readVarS64()); break;
+            case bytecode::F32Const: {
+                auto Val = readF32();
+                Push(module::ConstImm, type::ValTypeF32, std::bit_cast<uint32_t>(Val));
+                break;
+            }
+            case bytecode::F64Const: {
+                auto Val = readF64();
+                Push(module::ConstImm, type::ValTypeF64, std::bit_cast<uint64_t>(Val));
+                break;
+            }
+            case bytecode::Simd: {
+                auto SubOp = readVarU32();
+                if (SubOp != bytecode::V128Const)
+                    fail("ModuleParser::readConstExpr", "constant expression required, got simd op %d", SubOp);
+                uint64_t Bits[2];
+                readFixedBytes(reinterpret_cast<uint8_t *>(Bits), sizeof(Bits));
+                Push(module::ConstImm, type::ValTypeV128, Bits[0], Bits[1]);
+                break;
+            }
+            case bytecode::RefNull: {
+                auto Type = readByte();
+                if (!type::isRefType(Type))
+                    fail("ModuleParser::readConstExpr", "malformed reference type: %d", Type);
+                Push(module::ConstImm, Type, module::NullElem);
+                break;
+            }
+            case bytecode::RefFunc: {
+                auto Idx = readVarU32();
+                if (Idx >= M.FuncTypes.size()) {
+                    fail("ModuleParser::readConstExpr", "unknown function: %d", Idx);
+                    return {};
+                }
+                Push(module::ConstImm, type::ValTypeFuncRef, Idx);
+                break;
+            }
+            case bytecode::GlobalGet: {
+                auto Idx = readVarU32();
+                if (Idx >= ImportedGlobals.size() || ImportedGlobals[Idx].Mut != type::MutConst) {
+                    fail("ModuleParser::readConstExpr", "unknown or mutable global: %d", Idx);
+                    return {};
+                }
+                Push(module::ConstGlobal, ImportedGlobals[Idx].Type, Idx);
+                break;
+            }
+            case bytecode::I32Add: case bytecode::I32Sub: case bytecode::I32Mul:
+            case bytecode::I64Add: case bytecode::I64Sub: case bytecode::I64Mul: {
+                bool Is64 = opcode >= bytecode::I64Add;
+                auto Type = Is64 ? type::ValTypeI64 : type::ValTypeI32;
+                if (Depth < 2 || Stack[Depth - 1].Type != Type || Stack[Depth - 2].Type != Type) {
+                    fail("ModuleParser::readConstExpr", "type mismatch in constant expression");
+                    return {};
+                }
+                auto &L = Stack[Depth - 2], &R = Stack[Depth - 1];
+                bool Add = opcode == bytecode::I32Add || opcode == bytecode::I64Add;
+                bool Sub = opcode == bytecode::I32Sub || opcode == bytecode::I64Sub;
+                bool Foldable = L.Kind != module::ConstProgram && R.Kind != module::ConstProgram;
+                // The value, or the addend of a symbolic operand.
+                uint64_t A = L.Kind == module::ConstImm ? L.Bits[0] : L.Bits[1];
+                uint64_t B = R.Kind == module::ConstImm ? R.Bits[0] : R.Bits[1];
+                uint64_t V;
+                if (Foldable && L.Kind == module::ConstImm && R.Kind == module::ConstImm) {
+                    V = Add ? A + B : Sub ? A - B : A * B;
+                } else if (Foldable && L.Kind != R.Kind && (Add || (Sub && R.Kind == module::ConstImm))) {
+                    V = Add ? A + B : A - B;
+                    if (R.Kind == module::ConstGlobal)
+                        L.Bits[0] = R.Bits[0];
+                    L.Kind = module::ConstGlobal;
+                } else {
+                    Lower(Depth - 2);
+                    Lower(Depth - 1);
+                    auto &Prog = Ops[Depth - 2];
+                    Prog.insert(Prog.end(), Ops[Depth - 1].begin(), Ops[Depth - 1].end());
+                    Prog.push_back({uint8_t(Add ? module::ConstOpAdd : Sub ? module::ConstOpSub : module::ConstOpMul), 0});
+                    --Depth;
+                    break;
+                }
+                L.Bits[L.Kind == module::ConstImm ? 0 : 1] = Is64 ? V : uint32_t(V);
+                --Depth;
+                break;
+            }
+            case bytecode::End_:
+                if (Depth != 1 || Stack[0].Type != Expected) {
+                    fail("ModuleParser::readConstExpr", "type mismatch in constant expression");
+                    return {};
+                }
+                if (Stack[0].Kind == module::ConstProgram) {
+                    Stack[0].Bits[0] = M.ConstOps.size();
+                    Stack[0].Bits[1] = Ops[0].size();
+                    M.ConstOps.insert(M.ConstOps.end(), Ops[0].begin(), Ops[0].end());
+                }
+                return Stack[0];
+            default:
+                fail("ModuleParser::readConstExpr", "constant expression required, got opcode 0x%x", opcode);
+                return {};
+        }
+    }
+}
+
 void ModuleParser::ReadTypeSec(Module &M) {
-    int N = ReadVarU32();
+    int N = readCount();
     for (int i = 0; i < N; ++i)
         M.TypeSec.emplace_back(std::move(ReadFuncType()));
+    NumTypes = M.TypeSec.size();
+
+    // Keyed by the value type bytes of params and results.
+    std::unordered_map<std::string, uint32_t> Canonical;
+    M.TypeIds.resize(NumTypes);
+    for (uint32_t i = 0; i < NumTypes; ++i) {
+        auto &Type = M.TypeSec[i];
+        std::string Key(Type.ParamTypes.begin(), Type.ParamTypes.end());
+        Key.push_back(0);
+        Key.append(Type.ResultTypes.begin(), Type.ResultTypes.end());
+        M.TypeIds[i] = Canonical.emplace(std::move(Key), i).first->second;
+    }
 }
 
 void ModuleParser::ReadImportSec(Module &M) {
-    int N = readVarU32();
+    int N = readCount();
     for (int i = 0; i < N; ++i) {
-        auto Module = readName();
+        auto Module = M.Names.intern(readName());
         auto Name = readName();
+        auto Hash = module::getImportHash(M.Names.getHash(Module), Name);
         ImportDesc Desc = {readByte()};
         switch (Desc.Tag) {
-            case module::ImportTagFunc:     Desc.Idx.FuncType = readVarU32(); break;
+            case module::ImportTagFunc:
+                Desc.Idx.FuncType = readVarU32();
+                M.FuncTypes.push_back(Desc.Idx.FuncType);
+                ++M.NumImportedFuncs;
+                break;
             case module::ImportTagTable:    Desc.Idx.Table = readTableType(); break;
-            case module::ImportTagMem:      Desc.Idx.Mem = readRangeType(); break;
-            case module::ImportTagGlobal:   Desc.Idx.Global = readGlobalType(); break;
+            case module::ImportTagMem:
+                Desc.Idx.Mem = readRangeType();
+                Memory64 |= Desc.Idx.Mem.is64();
+                break;
+            case module::ImportTagGlobal:
+                Desc.Idx.Global = readGlobalType();
+                ImportedGlobals.push_back(Desc.Idx.Global);
+                break;
             default:
-                support::output::Error("ModuleParser::ReadImportSec", "invalid import desc tag: %d", Desc.Tag);
+                fail("ModuleParser::ReadImportSec", "invalid import desc tag: %d", Desc.Tag);
         }
-        M.ImportSec.emplace_back(Import(Module, Name, Desc));
+        M.ImportSec.push_back({Module, M.Names.intern(Name), Hash, Desc});
     }
 }
 
 void ModuleParser::ReadTableSec(Module &M) {
-    M.TableSec.resize(readVarU32());
+    M.TableSec.resize(readCount());
     for (auto &TT : M.TableSec)
         TT = readTableType();
 }
 
 void ModuleParser::ReadMemSec(Module &M) {
-    M.MemSec.resize(readVarU32());
-    for (auto &Mem : M.MemSec)
+    M.MemSec.resize(readCount());
+    for (auto &Mem : M.MemSec) {
         Mem = readRangeType();
+        uint64_t Limit = Mem.is64() ? module::MaxPageCount64 : module::MaxPageCount;
+        if (Mem.Min > Limit || (Mem.hasMax() && Mem.Max > Limit))
+            fail("ModuleParser::ReadMemSec", "memory size must be at most %lu pages", Limit);
+        else if (Mem.hasMax() && Mem.Min > Mem.Max)
+            fail("ModuleParser::ReadMemSec", "size minimum must not be greater than maximum");
+        Memory64 |= Mem.is64();
+    }
 }
 
 void ModuleParser::ReadGlobalSec(Module &M) {
-    M.GlobalSec.resize(readVarU32());
-    for (auto &Global : M.GlobalSec)
-        Global = {readGlobalType(), readExpr()};    
+    M.GlobalSec.resize(readCount());
+    for (auto &Global : M.GlobalSec) {
+        Global.Type = readGlobalType();
+        Global.Init = readConstExpr(M, Global.Type.Type);
+    }
 }
 
 void ModuleParser::ReadExportSec(Module &M) {
-    M.ExportSec.resize(readVarU32());
+    M.ExportSec.resize(readCount());
     for (auto &Export : M.ExportSec) {
-        auto Name = readName();
+        auto Name = M.Names.intern(readName());
         auto Tag = readByte();
         auto Idx = readVarU32();
-        switch Tag {
+        switch (Tag) {
             case module::ExportTagFunc: // func_idx
             case module::ExportTagTable: // table_idx
             case module::ExportTagMem: // mem_idx
             case module::ExportTagGlobal: // global_idx
                 break;
             default:
-                support::output::Error("ModuleParser::ReadExportSec", "invalid export desc tag: %d", Tag);
+                fail("ModuleParser::ReadExportSec", "invalid export desc tag: %d", Tag);
         }
-        Export = {std::move(Name), ExportDesc(Tag, Idx)};
+        Export = {Name, {Tag, Idx}};
+    }
+
+    M.ExportOf.assign(M.Names.size(), UINT32_MAX);
+    for (uint32_t i = 0; i < M.ExportSec.size(); ++i) {
+        auto &Slot = M.ExportOf[M.ExportSec[i].Name];
+        if (Slot != UINT32_MAX)
+            fail("ModuleParser::ReadExportSec", "duplicate export name");
+        Slot = i;
     }
 }
 
+// Flags bit 0: passive or declarative, bit 1: explicit table index (active)
+// or declarative, bit 2: entries are expressions rather than function indices.
 void ModuleParser::ReadElemSec(Module &M) {
-    M.ElemSec.resize(readVarU32());
-    for (auto &Elem : M.ElemSec)
-        Elem = {readVarU32(), std::move(readExpr()), std::move(readIndices())};
+    M.ElemSec.resize(readCount());
+    for (auto &Elem : M.ElemSec) {
+        auto Flags = readVarU32();
+        if (Flags > 7)
+            fail("ModuleParser::ReadElemSec", "malformed elements segment kind: %d", Flags);
+
+        Elem.Table = 0;
+        Elem.Type = type::ValTypeFuncRef;
+        if (Flags & 0x1) {
+            Elem.Mode = (Flags & 0x2) ? module::ElemDeclarative : module::ElemPassive;
+        } else {
+            Elem.Mode = module::ElemActive;
+            if (Flags & 0x2)
+                Elem.Table = readVarU32();
+            Elem.Offset = readConstExpr(M, type::ValTypeI32);
+        }
+
+        // elemkind (0x00 = funcref) or reftype; both absent for flags 0 and 4.
+        if (Flags & 0x3) {
+            auto Kind = readByte();
+            if (Flags & 0x4) {
+                if (!type::isRefType(Kind))
+                    fail("ModuleParser::ReadElemSec", "malformed reference type: %d", Kind);
+                Elem.Type = Kind;
+            } else if (Kind != 0x00) {
+                fail("ModuleParser::ReadElemSec", "malformed element kind: %d", Kind);
+            }
+        }
+
+        if (!(Flags & 0x4)) {
+            Elem.Init = readIndices();
+            for (auto Func : Elem.Init) {
+                if (Func >= M.FuncTypes.size())
+                    fail("ModuleParser::ReadElemSec", "unknown function: %d", Func);
+            }
+            continue;
+        }
+        Elem.Init.resize(readCount());
+        for (auto &Func : Elem.Init) {
+            auto Init = readConstExpr(M, Elem.Type);
+            if (Init.Kind != module::ConstImm)
+                fail("ModuleParser::ReadElemSec", "element expressions must be ref.null or ref.func");
+            Func = Init.Bits[0];
+        }
+    }
 }
 
 void ModuleParser::ReadCodeSec(Module &M) {
     uint64_t LocalLimit = (0x1 << (sizeof(uint32_t) << 3)) - 1;
-    M.CodeSec.resize(readVarU32());
+    M.CodeSec.resize(readCount());
     for (auto &Code : M.CodeSec) {
+        auto Size = readVarU32();
         auto ReamainingBeforeRead = remaining();
-        std::vector<module::Locals> LocalGroup(readVarU32());
+        std::vector<module::Locals> LocalGroup(readCount());
         for (auto &Locals : LocalGroup)
             Locals = {readVarU32(), readValType()};
+        CallIndirectSites = 0;
         Code = {std::move(Locals), std::move(readExpr())};
-        if (remaining() + M.CodeSec.size() != ReamainingBeforeRead)
-            support::output::Error("ModuleParser::ReadCodeSec", "Invalid code!");
+        Code.CallIndirectSites = CallIndirectSites;
+        Code.Size = Size;
+        if (ReamainingBeforeRead - remaining() != Size)
+            fail("ModuleParser::ReadCodeSec", "Invalid code!");
         if (Code.getLocalCount() == LocalLimit)
-            support::output::Error("ModuleParser::ReadCodeSec", "too many locals!");
+            fail("ModuleParser::ReadCodeSec", "too many locals!");
     }
 }
 
 void ModuleParser::ReadDataSec(Module &M) {
-    M.DataSec.resize(readVarU32());
-    for (auto &Data : M.DataSec)
-        Data = {readVarU32(), std::move(readExpr()), std::move(readBytes())};
+    M.DataSec.resize(readCount());
+    for (auto &Data : M.DataSec) {
+        Data.Mode = readVarU32();
+        switch (Data.Mode) {
+            case module::DataActive:
+                Data.Mem = 0;
+                Data.Offset = readConstExpr(M, Memory64 ? type::ValTypeI64 : type::ValTypeI32);
+                break;
+            case module::DataPassive:
+                break;
+            case module::DataActiveExplicit:
+                Data.Mem = readVarU32();
+                Data.Offset = readConstExpr(M, Memory64 ? type::ValTypeI64 : type::ValTypeI32);
+                break;
+            default:
+                fail("ModuleParser::ReadDataSec", "malformed data segment flags: %d", Data.Mode);
+        }
+        std::tie(Data.Init, Data.Size) = viewBytes();
+    }
+}
+
+// The contents are kept as a view and only looked at on demand; the name
+// section is merely noted for getNameIndex.
+void ModuleParser::ReadCustomSec(Module &M) {
+    auto N = readVarU32();
+    if (remaining() < N) {
+        fail("ModuleParser::ReadCustomSec", "Remaining %d bytes, but want %d bytes!", remaining(), N);
+        return;
+    }
+    auto End = Idx + N;
+    auto Name = readName();
+    if (Idx > End) {
+        fail("ModuleParser::ReadCustomSec", "section size mismatch");
+        return;
+    }
+
+    CustomSec Sec{Name, SB.Buffer + Idx, uint32_t(End - Idx)};
+    Idx = End;
+    if (Name == "name" && !M.NameSec)
+        M.NameSec = std::make_unique<module::LazyNameIndex>(Sec.Bytes, Sec.Size);
+    M.CustomSecs.push_back(Sec);
 }
 
 void ModuleParser::ReadNonCustomSec(uint8_t SecID, Module &M) {
     switch (SecID) {
         case module::SecTypeID:     ReadTypeSec(M); break;
         case module::SecImportID:   ReadImportSec(M); break;
-        case module::SecFuncID:     M.FuncSec = std::move(readIndices()); break;
+        case module::SecFuncID:
+            M.FuncSec = std::move(readIndices());
+            M.FuncTypes.insert(M.FuncTypes.end(), M.FuncSec.begin(), M.FuncSec.end());
+            break;
         case module::SecTableID:    ReadTableSec(M); break;
         case module::SecMemID:      ReadMemSec(M); break;
         case module::SecGlobalID:   ReadGlobalSec(M); break;
         case module::SecExportID:   ReadExportSec(M); break;
         case module::SecStartID:    M.StartSec = readVarU32(); break;
-        case module::SecElemID:     ReadElemSec(M); break;
+        case module::SecElemID:
+            ReadElemSec(M);
+            NumElemSegs = M.ElemSec.size();
+            break;
         case module::SecCodeID:     ReadCodeSec(M); break;
         case module::SecDataID:     ReadDataSec(M); break;
+        case module::SecDataCountID: M.DataCount = DataCount = readVarU32(); break;
         default:
-            support::output::Error("ModuleParser::ReadNonCustomSec", "Unexpected Section ID: %d", SecID);
+            fail("ModuleParser::ReadNonCustomSec", "Unexpected Section ID: %d", SecID);
     }
 }
 
+// Position of a section in the required order; the data count section sits
+// between the element and code sections despite its larger id.
+static int SectionOrder(uint8_t SecID) {
+    if (SecID == module::SecDataCountID)
+        return module::SecElemID * 2 + 1;
+    return SecID * 2;
+}
+
 void ModuleParser::ReadSections(Module &M) {
     uint8_t PrevSecID = 0;
     while (remaining() > 0) {
         auto SecID = readByte();
         if (SecID == module::SecCustomID) {
-            M.CustomSecs.emplace_back(std::move(CustomSec(readName(), readBytes())));
+            ReadCustomSec(M);
             continue;
         }
 
-        if (SecID > module::SecDataID)
-            support::output::Error("ModuleParser::ReadSections", "malformed section id: %d!", SecID);
-        if (SecID <= PrevSecID)
-            support::output::Error("ModuleParser::ReadSections", "junk after last section, id: %d!", SecID);
+        if (SecID > module::SecDataCountID)
+            fail("ModuleParser::ReadSections", "malformed section id: %d!", SecID);
+        if (SectionOrder(SecID) <= SectionOrder(PrevSecID))
+            fail("ModuleParser::ReadSections", "junk after last section, id: %d!", SecID);
         
         PrevSecID = SecID;
         auto N = readVarU32();
         auto RemainingBeforeRead = remaining();
         ReadNonCustomSec(SecID, M);
         if (RemainingBeforeRead - N != remaining())
-            support::output::Error("ModuleParser::ReadSections", "section size mismatch, id: %d", SecID);
+            fail("ModuleParser::ReadSections", "section size mismatch, id: %d", SecID);
     }
 }
 
-Module *ModuleParser::parse() {
+support::result::Result<std::unique_ptr<Module>> ModuleParser::parse() {
+    auto M = std::make_unique<Module>();
     if (remaining() < 4)
-        support::output::Log"ModuleParser::parse", "Unexpected end of magic header!");
-
-    Module *M = new Module();
-    if (M == nullptr)
-        support::output::Log"ModuleParser::parse", "Cannot allocate Module Object!");
-
-    if ((M->Magic = readU32()) != module::MagicNumber)
-        support::output::Log"ModuleParser::parse", "Unsupported Magic!");
-
-    if (remaning() < 4)
-        support::output::Log"ModuleParser::parse", "unexpected end of binary version!");
-    if ((M->Version = readU32()) != module::SupportVersion)
-        support::output::Log"ModuleParser::parse", "Unsupported Version!");
+        fail("ModuleParser::parse", "Unexpected end of magic header!");
+    else if ((M->Magic = readU32()) != module::MagicNumber)
+        fail("ModuleParser::parse", "Unsupported Magic!");
+    else if (remaining() < 4)
+        fail("ModuleParser::parse", "unexpected end of binary version!");
+    else if ((M->Version = readU32()) != module::SupportVersion)
+        fail("ModuleParser::parse", "Unsupported Version!");
     ReadSections(*M);
+    if (M->DataCount && *M->DataCount != M->DataSec.size())
+        fail("ModuleParser::parse", "data count and data section have inconsistent lengths!");
     if (M->FuncSec.size() != M->CodeSec.size())
-        support::output::Log"ModuleParser::parse", "function and code section have inconsistent lengths!");
+        fail("ModuleParser::parse", "function and code section have inconsistent lengths!");
+    for (auto Type : M->FuncTypes) {
+        if (Type >= M->TypeSec.size()) {
+            fail("ModuleParser::parse", "unknown type: %u", Type);
+            break;
+        }
+    }
     if (remaining() != 0)
-        support::output::Log"ModuleParser::parse", "junk after last section!");
-    return M;
+        fail("ModuleParser::parse", "junk after last section!");
+    if (Failed)
+        return std::move(*Failed);
+    return std::move(M);
 }
 
-Module *ReadFromBuffer(SimpleBuffer &SB) {
+support::result::Result<std::unique_ptr<Module>> ReadFromBuffer(SimpleBuffer &SB) {
     constexpr bool translate = std::endian::native == std::endian::big;
-    return ModuleParser<translate>(SB).parse()
+    return ModuleParser<translate>(SB).parse();
 }
 
-Module *ReadFromFile(const std::string FileName) {
-    std::ifstream is(FileName, std::ios::binary);
-    if (!is.is_open()) {
-        support::output::Error("ReadFromFile", "Cannot Open File: %s!\n", FileName.c_str());
-        return nullptr; // unreachable.
-    }
+support::result::Result<std::unique_ptr<Module>> ReadFromFile(const std::string FileName) {
+    auto SB = SimpleBuffer::MapFile(FileName);
+    if (SB == nullptr)
+        return support::result::MakeFailure("ReadFromFile", "Cannot map file: %s", FileName.c_str());
+    auto Module = ReadFromBuffer(*SB);
+    if (Module)
+        Module->get()->Source = std::move(SB);
+    return Module;
+}
 
-    is.seekg(0, std::ios::end);
-    int Length = is.tellg();
+// Null if the file cannot be opened or mapped.
+std::shared_ptr<SimpleBuffer> SimpleBuffer::MapFile(const std::string &FileName) {
+    int Fd = open(FileName.c_str(), O_RDONLY | O_CLOEXEC);
+    if (Fd < 0)
+        return nullptr;
 
-    is.seekg(0, std::ios::begin);
-    SimpleBuffer SB(Length + 1);
-    is.read(SB.Buffer, Length);
-    auto *Module = ReadFromBuffer(SB);
-    if (Module == nullptr) {
-        support::output::Error("ReadFromFile", "Cannot decode module from file: %s!\n", FileName.c_str());
-        return nullptr; // unreachable.
+    struct stat St;
+    void *Ptr = MAP_FAILED;
+    if (fstat(Fd, &St) == 0 && St.st_size != 0)
+        Ptr = mmap(nullptr, St.st_size, PROT_READ, MAP_PRIVATE, Fd, 0);
+    if (Ptr == MAP_FAILED) {
+        close(Fd);
+        return nullptr;
     }
-    return Module;
+    return std::shared_ptr<SimpleBuffer>(
+        new SimpleBuffer(static_cast<const uint8_t *>(Ptr), St.st_size, Fd));
 }
 
 SimpleBuffer::SimpleBuffer(size_t Size)
@@ -581,7 +1119,10 @@ SimpleBuffer::SimpleBuffer(size_t Size)
 }
     
 SimpleBuffer::~SimpleBuffer() {
-    if (Buffer != nullptr)
+    if (Fd >= 0) {
+        munmap(const_cast<uint8_t *>(Buffer), Size);
+        close(Fd);
+    } else if (Buffer != nullptr)
         delete[] Buffer;
 }
 
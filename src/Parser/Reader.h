@@ -1,7 +1,10 @@
 #pragma once
 
+#include "Support/Result.h"
+
 #include "Module.h"
 
+#include <memory>
 #include <string>
 
 namespace wasmrt {
@@ -12,12 +15,23 @@ struct SimpleBuffer {
     SimpleBuffer(size_t Size);
     ~SimpleBuffer();
 
+    // Maps the file read-only; Fd stays open so that data segments can be
+    // mapped from it again, copy-on-write, into linear memory.
+    static std::shared_ptr<SimpleBuffer> MapFile(const std::string &FileName);
+
     const size_t   Size{0};
     const uint8_t* Buffer{nullptr};
+    int            Fd{-1};
+
+private:
+    SimpleBuffer(const uint8_t *Buffer, size_t Size, int Fd)
+        : Size(Size), Buffer(Buffer), Fd(Fd) {}
 };
 
-Module *ReadFromBuffer(SimpleBuffer &SB);
-Module *ReadFromFile(const std::string FileName);
+// The returned module borrows from SB, which must outlive it. Malformed input
+// yields the first error found.
+support::result::Result<std::unique_ptr<Module>> ReadFromBuffer(SimpleBuffer &SB);
+support::result::Result<std::unique_ptr<Module>> ReadFromFile(const std::string FileName);
 
 } // namespace reader
 } // namespace parser
@@ -27,15 +27,30 @@ inline constexpr ValueType ValTypeI32 = 0x7F; // i32
 inline constexpr ValueType ValTypeI64 = 0x7E; // i64
 inline constexpr ValueType ValTypeF32 = 0x7D; // f32
 inline constexpr ValueType ValTypeF64 = 0x7C; // f64
+inline constexpr ValueType ValTypeV128 = 0x7B; // v128
+inline constexpr ValueType ValTypeFuncRef = 0x70; // funcref
+inline constexpr ValueType ValTypeExternRef = 0x6F; // externref
 
 inline constexpr BlockType BlockTypeI32 = -1;  // ()->(i32)
 inline constexpr BlockType BlockTypeI64 = -2;  // ()->(i64)
 inline constexpr BlockType BlockTypeF32 = -3;  // ()->(f32)
 inline constexpr BlockType BlockTypeF64 = -4;  // ()->(f64)
+inline constexpr BlockType BlockTypeV128 = -5; // ()->(v128)
+inline constexpr BlockType BlockTypeFuncRef = -16; // ()->(funcref)
+inline constexpr BlockType BlockTypeExternRef = -17; // ()->(externref)
 inline constexpr BlockType BlockTypeEmpty = -64; // ()->()
+// Any non-negative block type indexes the type section instead (multi-value).
+inline bool isTypeIndex(BlockType BT) { return BT >= 0; }
 
 inline constexpr uint8_t FtTag   = 0x60;
 inline constexpr uint8_t FuncRef = 0x70;
+inline constexpr uint8_t ExternRef = 0x6F;
+
+inline bool isRefType(ValType Type) { return Type == FuncRef || Type == ExternRef; }
+
+inline constexpr uint8_t LimitsHasMax = 0x1;
+inline constexpr uint8_t LimitsShared = 0x2;
+inline constexpr uint8_t LimitsIs64   = 0x4; // memory64: i64 addresses, 64-bit limits
 
 inline constexpr uint8_t MutConst = 0;
 inline constexpr uint8_t MutVar   = 1;
@@ -46,6 +61,9 @@ static const char *ValTypeToStr(ValType Type) {
         case ValTypeI64: return "i64";
         case ValTypeF32: return "f32";
         case ValTypeF64: return "f64";
+        case ValTypeV128: return "v128";
+        case ValTypeFuncRef: return "funcref";
+        case ValTypeExternRef: return "externref";
         default:
             support::output::Error("ValTypeToStr", "Invalid ValType: %d!\n", (int) Type);
 	}
@@ -105,6 +123,10 @@ struct FuncType {
 };
 
 struct RangeType {
+    inline bool hasMax() const { return Tag & LimitsHasMax; }
+    inline bool isShared() const { return Tag & LimitsShared; }
+    inline bool is64() const { return Tag & LimitsIs64; }
+
     std::string str() const {
         std::string str("{min: ");
         str.append(Min).append(", max: ").append(Max).append('}');
@@ -112,8 +134,8 @@ struct RangeType {
     }
 
 	uint8_t  Tag;
-	uint32_t Min;
-	uint32_t Max;
+	uint64_t Min;
+	uint64_t Max;
 };
 
 using MemType = RangeType;
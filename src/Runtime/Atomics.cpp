@@ -0,0 +1,150 @@
+#include "Atomics.h"
+#include "Trap.h"
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <ctime>
+#include <mutex>
+
+namespace wasmrt {
+namespace runtime {
+namespace atomics {
+
+// Waiters park on a futex word of their own and are queued in a bucket
+// selected by address. Checking the value and queueing happen under the
+// bucket lock, which notify also takes, so no wakeup can be lost between a
+// store, its notify and a concurrent wait; the kernel only ever sees
+// uncontended single waiter futexes.
+struct Waiter {
+    const uint8_t          *Addr;
+    std::atomic<uint32_t>  Woken{0};
+    Waiter                 *Next{nullptr};
+};
+
+struct alignas(64) Bucket {
+    std::mutex  Lock;
+    Waiter      *Head{nullptr};
+    Waiter      *Tail{nullptr};
+};
+
+static constexpr size_t BucketCount = 256;
+static Bucket Buckets[BucketCount];
+
+static inline Bucket &getBucket(const uint8_t *Addr) {
+    auto Key = reinterpret_cast<uintptr_t>(Addr);
+    return Buckets[(Key >> 2) * 0x9E3779B97F4A7C15ull >> 56];
+}
+
+static bool Unlink(Bucket &B, Waiter *W) {
+    for (Waiter **Link = &B.Head, *Prev = nullptr; *Link != nullptr; Prev = *Link, Link = &(*Link)->Next) {
+        if (*Link != W)
+            continue;
+        *Link = W->Next;
+        if (B.Tail == W)
+            B.Tail = Prev;
+        return true;
+    }
+    return false;
+}
+
+// In the order the spec checks them. Runs before Addr is turned into a
+// pointer, so that nothing past the memory is ever touched.
+static void CheckAccess(Memory *Mem, uint64_t Addr, uint64_t Size) {
+    if (!Mem->inBounds(Addr, Size))
+        trap::Raise(trap::TrapOutOfBounds);
+    if (Addr % Size != 0)
+        trap::Raise(trap::TrapUnalignedAtomic);
+}
+
+template <typename T>
+static int32_t Wait(Memory *Mem, uint64_t Addr, T Expected, int64_t Timeout) {
+    CheckAccess(Mem, Addr, sizeof(T));
+    if (!Mem->Shared)
+        trap::Raise(trap::TrapExpectedShared);
+    auto *Ptr = Mem->getBase() + Addr;
+    auto &B = getBucket(Ptr);
+    Waiter W;
+    W.Addr = Ptr;
+    {
+        std::lock_guard<std::mutex> Guard(B.Lock);
+        if (__atomic_load_n(reinterpret_cast<T *>(Ptr), __ATOMIC_SEQ_CST) != Expected)
+            return WaitNotEqual;
+        (B.Tail ? B.Tail->Next : B.Head) = &W;
+        B.Tail = &W;
+    }
+
+    // The timeout is signed on purpose: any negative value, not just -1,
+    // means no deadline at all.
+    struct timespec Deadline, *DeadlinePtr = nullptr;
+    if (Timeout >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &Deadline);
+        Deadline.tv_sec += Timeout / 1000000000;
+        Deadline.tv_nsec += Timeout % 1000000000;
+        if (Deadline.tv_nsec >= 1000000000) {
+            ++Deadline.tv_sec;
+            Deadline.tv_nsec -= 1000000000;
+        }
+        DeadlinePtr = &Deadline;
+    }
+
+    while (W.Woken.load(std::memory_order_acquire) == 0) {
+        // FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC deadline.
+        long Ret = syscall(SYS_futex, &W.Woken, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+                           0, DeadlinePtr, nullptr, FUTEX_BITSET_MATCH_ANY);
+        if (Ret == -1 && errno == ETIMEDOUT) {
+            std::lock_guard<std::mutex> Guard(B.Lock);
+            if (Unlink(B, &W))
+                return WaitTimedOut;
+            // A notify dequeued us concurrently; it counted us as woken.
+            break;
+        }
+    }
+    while (W.Woken.load(std::memory_order_acquire) == 0)
+        ;
+    return WaitOk;
+}
+
+int32_t Wait32(Memory *Mem, uint64_t Addr, uint32_t Expected, int64_t Timeout) {
+    return Wait<uint32_t>(Mem, Addr, Expected, Timeout);
+}
+
+int32_t Wait64(Memory *Mem, uint64_t Addr, uint64_t Expected, int64_t Timeout) {
+    return Wait<uint64_t>(Mem, Addr, Expected, Timeout);
+}
+
+uint32_t Notify(Memory *Mem, uint64_t Addr, uint32_t Count) {
+    CheckAccess(Mem, Addr, 4);
+    // Only shared memories can have waiters.
+    if (!Mem->Shared)
+        return 0;
+
+    auto *Ptr = Mem->getBase() + Addr;
+    auto &B = getBucket(Ptr);
+    uint32_t Woken = 0;
+    std::lock_guard<std::mutex> Guard(B.Lock);
+    for (Waiter **Link = &B.Head, *Prev = nullptr; *Link != nullptr && Woken < Count; ) {
+        auto *W = *Link;
+        if (W->Addr != Ptr) {
+            Prev = W;
+            Link = &W->Next;
+            continue;
+        }
+        *Link = W->Next;
+        if (B.Tail == W)
+            B.Tail = Prev;
+        ++Woken;
+        // W lives on the waiter's stack: once Woken is set it may return, so
+        // the futex address is only used by the kernel from here on.
+        W->Woken.store(1, std::memory_order_release);
+        syscall(SYS_futex, &W->Woken, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, 1, nullptr, nullptr, 0);
+    }
+    return Woken;
+}
+
+} // namespace atomics
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Memory.h"
+
+#include <cstdint>
+
+namespace wasmrt {
+namespace runtime {
+namespace atomics {
+
+// Results of memory.atomic.wait32/64.
+inline constexpr int32_t WaitOk       = 0;
+inline constexpr int32_t WaitNotEqual = 1;
+inline constexpr int32_t WaitTimedOut = 2;
+
+// Called through MemoryWait32/64 and MemoryNotify for memory.atomic.wait32/64
+// and notify. Addr is the effective address, not yet checked: out of bounds
+// or misaligned addresses trap, as does waiting on an unshared memory. A
+// negative Timeout waits forever.
+int32_t Wait32(Memory *Mem, uint64_t Addr, uint32_t Expected, int64_t Timeout);
+int32_t Wait64(Memory *Mem, uint64_t Addr, uint64_t Expected, int64_t Timeout);
+uint32_t Notify(Memory *Mem, uint64_t Addr, uint32_t Count);
+
+} // namespace atomics
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,180 @@
+#include "BoundsCheck.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace wasmrt {
+namespace runtime {
+namespace bounds {
+
+uint32_t getAccessSize(bytecode::BytecodeOp Op) {
+    switch (Op) {
+        case bytecode::I32Load8S: case bytecode::I32Load8U:
+        case bytecode::I64Load8S: case bytecode::I64Load8U:
+        case bytecode::I32Store8: case bytecode::I64Store8:
+            return 1;
+        case bytecode::I32Load16S: case bytecode::I32Load16U:
+        case bytecode::I64Load16S: case bytecode::I64Load16U:
+        case bytecode::I32Store16: case bytecode::I64Store16:
+            return 2;
+        case bytecode::I32Load: case bytecode::F32Load:
+        case bytecode::I64Load32S: case bytecode::I64Load32U:
+        case bytecode::I32Store: case bytecode::F32Store: case bytecode::I64Store32:
+            return 4;
+        case bytecode::I64Load: case bytecode::F64Load:
+        case bytecode::I64Store: case bytecode::F64Store:
+            return 8;
+        default:
+            return 0;
+    }
+}
+
+static bool isStore(bytecode::BytecodeOp Op) {
+    return Op >= bytecode::I32Store && Op <= bytecode::I64Store32;
+}
+
+// The local holding the address of E[Idx], if it is a tracked access.
+static bool getAddressLocal(const module::Expr &E, size_t Idx, LocalIdx &Local, uint64_t &Extent) {
+    auto &Inst = static_cast<const bytecode::MemoryInst &>(*E[Idx]);
+    auto Size = getAccessSize(Inst.getOpcode());
+    if (Size == 0 || Inst.Offset > UINT64_MAX - Size)
+        return false;
+
+    size_t AddrIdx = Idx - 1;
+    if (isStore(Inst.getOpcode())) {
+        if (Idx < 2)
+            return false;
+        switch (E[Idx - 1]->getOpcode()) {
+            case bytecode::LocalGet: case bytecode::I32Const: case bytecode::I64Const:
+            case bytecode::F32Const: case bytecode::F64Const:
+                break;
+            default:
+                return false;
+        }
+        AddrIdx = Idx - 2;
+    } else if (Idx < 1) {
+        return false;
+    }
+
+    if (E[AddrIdx]->getOpcode() != bytecode::LocalGet)
+        return false;
+    Local = static_cast<const bytecode::WithArgInst &>(*E[AddrIdx]).Arg;
+    Extent = Inst.Offset + Size;
+    return true;
+}
+
+// Calls Fn on every nested instruction list of Inst.
+template <typename FnT>
+static void ForEachNested(const bytecode::Instruction &Inst, FnT Fn) {
+    switch (Inst.getOpcode()) {
+        case bytecode::Block:
+        case bytecode::Loop:
+            Fn(static_cast<const bytecode::BlockInst &>(Inst).Instructions);
+            break;
+        case bytecode::If: {
+            auto &IfI = static_cast<const bytecode::IfInst &>(Inst);
+            Fn(IfI.IfTrue);
+            Fn(IfI.IfFalse);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void CollectWrites(const module::Expr &E, std::unordered_set<LocalIdx> &Written) {
+    for (auto &Inst : E) {
+        auto Op = Inst->getOpcode();
+        if (Op == bytecode::LocalSet || Op == bytecode::LocalTee)
+            Written.insert(static_cast<const bytecode::WithArgInst &>(*Inst).Arg);
+        ForEachNested(*Inst, [&](const module::Expr &Inner) { CollectWrites(Inner, Written); });
+    }
+}
+
+static void CollectAccesses(const module::Expr &E, std::unordered_map<LocalIdx, uint64_t> &Accesses) {
+    for (size_t i = 0; i < E.size(); ++i) {
+        LocalIdx Local;
+        uint64_t Extent;
+        if (getAccessSize(E[i]->getOpcode()) != 0 && getAddressLocal(E, i, Local, Extent)) {
+            auto &Max = Accesses[Local];
+            Max = std::max(Max, Extent);
+        }
+        ForEachNested(*E[i], [&](const module::Expr &Inner) { CollectAccesses(Inner, Accesses); });
+    }
+}
+
+BoundsPlan::BoundsPlan(const module::Expr &Body) {
+    Walk(Body, {}, {});
+}
+
+// Checked holds, per address local, the extent some check that dominates the
+// current instruction has already proven. It flows into nested blocks, since
+// their entry is dominated by what came before. Checks made inside a nested
+// block do not flow out.
+void BoundsPlan::Walk(const module::Expr &E, Extents Checked, const Extents &Guarded) {
+    for (size_t i = 0; i < E.size(); ++i) {
+        auto &Inst = *E[i];
+        auto Op = Inst.getOpcode();
+
+        LocalIdx Local;
+        uint64_t Extent;
+        if (getAccessSize(Op) != 0 && getAddressLocal(E, i, Local, Extent)) {
+            auto G = Guarded.find(Local);
+            auto C = Checked.find(Local);
+            if (C != Checked.end() && C->second >= Extent) {
+                Checks[&Inst] = CheckElided;
+            } else {
+                if (G != Guarded.end() && G->second >= Extent)
+                    Checks[&Inst] = CheckGuarded;
+                Checked[Local] = std::max(C == Checked.end() ? 0 : C->second, Extent);
+            }
+            continue;
+        }
+
+        switch (Op) {
+            case bytecode::LocalSet:
+            case bytecode::LocalTee:
+                Checked.erase(static_cast<const bytecode::WithArgInst &>(Inst).Arg);
+                break;
+            case bytecode::Block:
+            case bytecode::If: {
+                ForEachNested(Inst, [&](const module::Expr &Inner) { Walk(Inner, Checked, Guarded); });
+                std::unordered_set<LocalIdx> Written;
+                ForEachNested(Inst, [&](const module::Expr &Inner) { CollectWrites(Inner, Written); });
+                for (auto L : Written)
+                    Checked.erase(L);
+                break;
+            }
+            case bytecode::Loop: {
+                auto &Body = static_cast<const bytecode::BlockInst &>(Inst).Instructions;
+                std::unordered_set<LocalIdx> Written;
+                CollectWrites(Body, Written);
+                std::unordered_map<LocalIdx, uint64_t> Accesses;
+                CollectAccesses(Body, Accesses);
+
+                Extents Inner = Guarded;
+                std::vector<LoopGuard> LoopGuards;
+                for (auto [L, Max] : Accesses) {
+                    if (Written.count(L) != 0)
+                        continue;
+                    LoopGuards.push_back({L, Max});
+                    Inner[L] = std::max(Inner[L], Max);
+                }
+                if (!LoopGuards.empty())
+                    Guards[&Inst] = std::move(LoopGuards);
+
+                // Later iterations enter with whatever the body wrote.
+                for (auto L : Written)
+                    Checked.erase(L);
+                Walk(Body, Checked, Inner);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+} // namespace bounds
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Parser/Bytecode.h"
+#include "Parser/Module.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::parser;
+
+namespace wasmrt {
+namespace runtime {
+namespace bounds {
+
+// Bytes touched by a plain load or store, 0 for any other opcode.
+uint32_t getAccessSize(bytecode::BytecodeOp Op);
+
+enum CheckKind : uint8_t {
+    CheckFull = 0,  // compare against the memory bound
+    CheckElided,    // an earlier check of the same address local covers it
+    CheckGuarded    // the enclosing loop's guard covers it
+};
+
+// Tested once before entering a loop: if Local + Extent is in bounds, no
+// access based on Local can fault while the loop runs, because Local is
+// never written in it and memories never shrink. A compiled tier runs an
+// unchecked copy of the loop when the guard holds and the checked one when
+// it does not.
+struct LoopGuard {
+    LocalIdx  Local;
+    uint64_t  Extent;   // max offset + access size over the covered accesses
+};
+
+// Explicit bounds checks for one function body, needed where memories have
+// no guard region to fault into (memory64). Only accesses addressed straight
+// from a local (local.get x, then for stores one constant or local.get) are
+// tracked; every other access keeps its check.
+class BoundsPlan {
+public:
+    BoundsPlan(const module::Expr &Body);
+
+    inline CheckKind lookup(const bytecode::Instruction *Inst) const {
+        auto It = Checks.find(Inst);
+        return It == Checks.end() ? CheckFull : It->second;
+    }
+
+    inline const std::vector<LoopGuard> *getGuards(const bytecode::Instruction *Loop) const {
+        auto It = Guards.find(Loop);
+        return It == Guards.end() ? nullptr : &It->second;
+    }
+
+    std::unordered_map<const bytecode::Instruction *, CheckKind> Checks;
+    std::unordered_map<const bytecode::Instruction *, std::vector<LoopGuard>> Guards;
+
+private:
+    using Extents = std::unordered_map<LocalIdx, uint64_t>;
+
+    void Walk(const module::Expr &E, Extents Checked, const Extents &Guarded);
+};
+
+} // namespace bounds
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,193 @@
+#include "Support/CPUFeatures.h"
+
+#include "BulkMemory.h"
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace wasmrt {
+namespace runtime {
+namespace bulk {
+
+// Up to 32 bytes: every load happens before any store, so overlap is fine.
+static inline void CopySmall(uint8_t *Dst, const uint8_t *Src, size_t N) {
+    if (N >= 16) {
+        __m128i Head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Src));
+        __m128i Tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Src + N - 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst), Head);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst + N - 16), Tail);
+    } else if (N >= 8) {
+        uint64_t Head, Tail;
+        memcpy(&Head, Src, 8);
+        memcpy(&Tail, Src + N - 8, 8);
+        memcpy(Dst, &Head, 8);
+        memcpy(Dst + N - 8, &Tail, 8);
+    } else if (N >= 4) {
+        uint32_t Head, Tail;
+        memcpy(&Head, Src, 4);
+        memcpy(&Tail, Src + N - 4, 4);
+        memcpy(Dst, &Head, 4);
+        memcpy(Dst + N - 4, &Tail, 4);
+    } else if (N > 0) {
+        uint8_t First = Src[0], Mid = Src[N / 2], Last = Src[N - 1];
+        Dst[0] = First;
+        Dst[N / 2] = Mid;
+        Dst[N - 1] = Last;
+    }
+}
+
+// Copies N > Width bytes Width at a time. The chunk that goes last is loaded
+// before the loop starts, the loop walks away from it, so an overlapping
+// source is never read after it was overwritten.
+#define DEFINE_COPY_LOOP(Name, Target, Vec, Width, Load, Store)                 \
+    __attribute__((target(Target)))                                            \
+    static void Name(uint8_t *Dst, const uint8_t *Src, size_t N) {             \
+        if (Dst <= Src) {                                                      \
+            Vec Tail = Load(reinterpret_cast<const Vec *>(Src + N - Width));   \
+            for (size_t i = 0; N - i > Width; i += Width)                      \
+                Store(reinterpret_cast<Vec *>(Dst + i),                        \
+                      Load(reinterpret_cast<const Vec *>(Src + i)));           \
+            Store(reinterpret_cast<Vec *>(Dst + N - Width), Tail);             \
+        } else {                                                               \
+            Vec Head = Load(reinterpret_cast<const Vec *>(Src));               \
+            for (size_t i = N; i > Width; ) {                                  \
+                i -= Width;                                                    \
+                Store(reinterpret_cast<Vec *>(Dst + i),                        \
+                      Load(reinterpret_cast<const Vec *>(Src + i)));           \
+            }                                                                  \
+            Store(reinterpret_cast<Vec *>(Dst), Head);                         \
+        }                                                                      \
+    }
+
+DEFINE_COPY_LOOP(CopyLoopSSE, "sse2", __m128i, 16, _mm_loadu_si128, _mm_storeu_si128)
+DEFINE_COPY_LOOP(CopyLoopAVX, "avx", __m256i, 32, _mm256_loadu_si256, _mm256_storeu_si256)
+
+#undef DEFINE_COPY_LOOP
+
+__attribute__((target("avx")))
+static void FillLoopAVX(uint8_t *Dst, uint8_t Val, size_t N) {
+    __m256i V = _mm256_set1_epi8(Val);
+    for (size_t i = 0; N - i > 32; i += 32)
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(Dst + i), V);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(Dst + N - 32), V);
+}
+
+static void FillLoopSSE(uint8_t *Dst, uint8_t Val, size_t N) {
+    __m128i V = _mm_set1_epi8(Val);
+    for (size_t i = 0; N - i > 16; i += 16)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst + i), V);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst + N - 16), V);
+}
+
+static inline void RepMovsb(uint8_t *Dst, const uint8_t *Src, size_t N) {
+    asm volatile("rep movsb" : "+D"(Dst), "+S"(Src), "+c"(N) : : "memory");
+}
+
+static inline void RepStosb(uint8_t *Dst, uint8_t Val, size_t N) {
+    asm volatile("rep stosb" : "+D"(Dst), "+c"(N) : "a"(Val) : "memory");
+}
+
+static const bool HasAVX = support::cpu::getCPUFeatures().AVX;
+
+void Copy(uint8_t *Dst, const uint8_t *Src, size_t N) {
+    if (N <= 32)
+        return CopySmall(Dst, Src, N);
+    // rep movsb only runs forward: a destination inside the source has to
+    // take the backward vector loop.
+    bool Backward = Dst > Src && Dst < Src + N;
+    if (N >= RepThreshold && !Backward)
+        return RepMovsb(Dst, Src, N);
+    if (HasAVX)
+        CopyLoopAVX(Dst, Src, N);
+    else
+        CopyLoopSSE(Dst, Src, N);
+}
+
+void Fill(uint8_t *Dst, uint8_t Val, size_t N) {
+    if (N >= RepThreshold)
+        return RepStosb(Dst, Val, N);
+    if (N > 32)
+        return HasAVX ? FillLoopAVX(Dst, Val, N) : FillLoopSSE(Dst, Val, N);
+    if (N >= 16) {
+        __m128i V = _mm_set1_epi8(Val);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst), V);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(Dst + N - 16), V);
+    } else if (N >= 8) {
+        uint64_t V = 0x0101010101010101ull * Val;
+        memcpy(Dst, &V, 8);
+        memcpy(Dst + N - 8, &V, 8);
+    } else {
+        for (size_t i = 0; i < N; ++i)
+            Dst[i] = Val;
+    }
+}
+
+bool MemoryCopy(Module *M, uint64_t Dst, uint64_t Src, uint64_t N) {
+    auto &Mem = M->getMemory();
+    if (!Mem.inBounds(Dst, N) || !Mem.inBounds(Src, N))
+        return false;
+    Copy(Mem.getBase() + Dst, Mem.getBase() + Src, N);
+    return true;
+}
+
+bool MemoryFill(Module *M, uint64_t Dst, uint32_t Val, uint64_t N) {
+    auto &Mem = M->getMemory();
+    if (!Mem.inBounds(Dst, N))
+        return false;
+    Fill(Mem.getBase() + Dst, uint8_t(Val), N);
+    return true;
+}
+
+bool MemoryInit(Module *M, uint32_t Seg, uint64_t Dst, uint32_t Src, uint32_t N) {
+    auto &Mem = M->getMemory();
+    auto &Data = M->DataSegments[Seg];
+    if (!Mem.inBounds(Dst, N) || uint64_t(Src) + N > Data.Size)
+        return false;
+    Copy(Mem.getBase() + Dst, Data.Bytes + Src, N);
+    return true;
+}
+
+void DataDrop(Module *M, uint32_t Seg) {
+    M->DataSegments[Seg] = {nullptr, 0};
+}
+
+bool TableCopy(Module *M, uint32_t DstTable, uint32_t SrcTable, uint32_t Dst, uint32_t Src, uint32_t N) {
+    auto &D = *M->Tables[DstTable], &S = *M->Tables[SrcTable];
+    if (uint64_t(Dst) + N > D.getSize() || uint64_t(Src) + N > S.getSize())
+        return false;
+    Copy(reinterpret_cast<uint8_t *>(D.Elems.data() + Dst),
+         reinterpret_cast<const uint8_t *>(S.Elems.data() + Src), N * sizeof(Ref));
+    return true;
+}
+
+bool TableInit(Module *M, uint32_t TableIdx, uint32_t Seg, uint32_t Dst, uint32_t Src, uint32_t N) {
+    auto &T = *M->Tables[TableIdx];
+    auto &Elem = M->ElemSegments[Seg];
+    if (uint64_t(Dst) + N > T.getSize() || uint64_t(Src) + N > Elem.Size)
+        return false;
+    for (uint32_t i = 0; i < N; ++i)
+        T.Elems[Dst + i] = M->getFuncRef(Elem.Elems[Src + i]);
+    return true;
+}
+
+int32_t TableGrow(Module *M, uint32_t TableIdx, Ref Init, uint32_t Delta) {
+    return M->growTable(TableIdx, Delta, Init);
+}
+
+bool TableFill(Module *M, uint32_t TableIdx, uint32_t Dst, Ref Val, uint32_t N) {
+    auto &T = *M->Tables[TableIdx];
+    if (uint64_t(Dst) + N > T.getSize())
+        return false;
+    std::fill_n(T.Elems.data() + Dst, N, Val);
+    return true;
+}
+
+void ElemDrop(Module *M, uint32_t Seg) {
+    M->ElemSegments[Seg] = {nullptr, 0};
+}
+
+} // namespace bulk
+} // namespace runtime
+} // namespace wasmrt
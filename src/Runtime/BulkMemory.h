@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Memory.h"
+#include "Module.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wasmrt {
+namespace runtime {
+namespace bulk {
+
+// memmove semantics. Picks a kernel by size: overlapping register moves up
+// to 32 bytes, an SSE/AVX loop up to RepThreshold, rep movsb beyond.
+void Copy(uint8_t *Dst, const uint8_t *Src, size_t N);
+void Fill(uint8_t *Dst, uint8_t Val, size_t N);
+
+inline constexpr size_t RepThreshold = 2048;
+
+// Entries for the 0xfc bulk ops. All bounds are checked once, up front;
+// false means the generated code must trap without having written anything.
+bool MemoryCopy(Module *M, uint64_t Dst, uint64_t Src, uint64_t N);
+bool MemoryFill(Module *M, uint64_t Dst, uint32_t Val, uint64_t N);
+bool MemoryInit(Module *M, uint32_t Seg, uint64_t Dst, uint32_t Src, uint32_t N);
+void DataDrop(Module *M, uint32_t Seg);
+bool TableCopy(Module *M, uint32_t DstTable, uint32_t SrcTable, uint32_t Dst, uint32_t Src, uint32_t N);
+bool TableInit(Module *M, uint32_t TableIdx, uint32_t Seg, uint32_t Dst, uint32_t Src, uint32_t N);
+void ElemDrop(Module *M, uint32_t Seg);
+// table.grow returns the old size or -1, like the instruction.
+int32_t TableGrow(Module *M, uint32_t TableIdx, Ref Init, uint32_t Delta);
+bool TableFill(Module *M, uint32_t TableIdx, uint32_t Dst, Ref Val, uint32_t N);
+
+} // namespace bulk
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,37 @@
+#include "Epoch.h"
+#include "Fiber.h"
+#include "Module.h"
+#include "Trap.h"
+
+namespace wasmrt {
+namespace runtime {
+namespace epoch {
+
+EpochCounter Epoch;
+
+Ticker::Ticker(std::chrono::microseconds Period)
+    : Thread([this, Period] {
+        while (!Stop.load(std::memory_order_relaxed)) {
+            std::this_thread::sleep_for(Period);
+            Increment();
+        }
+    }) {}
+
+Ticker::~Ticker() {
+    Stop = true;
+    Thread.join();
+}
+
+void OnDeadline(Module *M) {
+    if (M->EpochAction == DeadlineYield && fiber::getCurrent() != nullptr) {
+        M->setEpochDeadline(M->EpochDelta);
+        fiber::getCurrentWaker().Wake();
+        fiber::Suspend();
+        return;
+    }
+    trap::Raise(trap::TrapInterrupted, __builtin_return_address(0));
+}
+
+} // namespace epoch
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+namespace wasmrt {
+namespace runtime {
+
+class Module;
+
+namespace epoch {
+
+// Process wide epoch. Generated code loads it at function entries and loop
+// headers and compares it against the instance's deadline; that load and
+// compare is all interruption costs on the fast path.
+struct alignas(64) EpochCounter {
+    std::atomic<uint64_t> Value{0};
+};
+
+extern EpochCounter Epoch;
+
+inline uint64_t getCurrent() { return Epoch.Value.load(std::memory_order_relaxed); }
+inline void Increment() { Epoch.Value.fetch_add(1, std::memory_order_relaxed); }
+
+enum DeadlineAction : uint8_t {
+    DeadlineTrap = 0,
+    DeadlineYield   // suspend the fiber and extend the deadline by the same delta
+};
+
+// Bumps the epoch every Period on a background thread.
+class Ticker {
+public:
+    Ticker(std::chrono::microseconds Period);
+    ~Ticker();
+
+private:
+    std::atomic<bool>  Stop{false};
+    std::thread        Thread;
+};
+
+// Slow path taken by generated code once Epoch reached the context's
+// EpochDeadline.
+void OnDeadline(Module *M);
+
+} // namespace epoch
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,267 @@
+#include "Support/Output.h"
+
+#include "Fiber.h"
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <utility>
+
+// Saves the callee-saved state of the SysV ABI on the current stack, stores
+// the stack pointer to *From and continues on the stack saved in To.
+extern "C" void wasmrt_fiber_switch(void **From, void *To);
+extern "C" void wasmrt_fiber_start();
+
+asm(R"(
+    .text
+    .globl wasmrt_fiber_switch
+    .type wasmrt_fiber_switch, @function
+wasmrt_fiber_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    subq $8, %rsp
+    stmxcsr (%rsp)
+    fnstcw 4(%rsp)
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    ldmxcsr (%rsp)
+    fldcw 4(%rsp)
+    addq $8, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size wasmrt_fiber_switch, .-wasmrt_fiber_switch
+
+    .globl wasmrt_fiber_start
+    .type wasmrt_fiber_start, @function
+wasmrt_fiber_start:
+    movq %r12, %rdi
+    call wasmrt_fiber_main
+    ud2
+    .size wasmrt_fiber_start, .-wasmrt_fiber_start
+)");
+
+namespace wasmrt {
+namespace runtime {
+namespace fiber {
+
+// Pages kept committed when a stack goes back to the pool.
+static constexpr size_t HotStackSize = 16 << 10;
+
+static thread_local Fiber *Current = nullptr;
+
+extern "C" void wasmrt_fiber_main(Fiber *F) {
+    F->Entry();
+    F->Returned = true;
+    wasmrt_fiber_switch(&F->SP, F->ResumerSP);
+}
+
+Stack::Stack(size_t Reserve) : Reserve(Reserve) {
+    void *Ptr = mmap(nullptr, Reserve, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (Ptr == MAP_FAILED)
+        return;
+    Base = static_cast<uint8_t *>(Ptr);
+    mprotect(Base, GuardSize, PROT_NONE);
+}
+
+Stack::Stack(Stack &&Other) : Base(Other.Base), Reserve(Other.Reserve) {
+    Other.Base = nullptr;
+}
+
+Stack &Stack::operator=(Stack &&Other) {
+    std::swap(Base, Other.Base);
+    std::swap(Reserve, Other.Reserve);
+    return *this;
+}
+
+Stack::~Stack() {
+    if (Base != nullptr)
+        munmap(Base, Reserve);
+}
+
+void Stack::Release() {
+    if (Reserve > GuardSize + HotStackSize)
+        madvise(Base + GuardSize, Reserve - GuardSize - HotStackSize, MADV_DONTNEED);
+}
+
+Fiber::Fiber(EventLoop &Loop, std::function<void()> &&Entry, Stack &&S)
+    : Loop(Loop), Entry(std::move(Entry)), S(std::move(S)) {
+    // Initial frame, as wasmrt_fiber_switch expects to pop it:
+    // [mxcsr|fpucw] r15 r14 r13 r12(=this) rbx rbp ret(=wasmrt_fiber_start)
+    auto *Top = reinterpret_cast<uint64_t *>(
+        reinterpret_cast<uintptr_t>(this->S.getTop()) & ~uintptr_t(15));
+    Top[-1] = reinterpret_cast<uint64_t>(&wasmrt_fiber_start);
+    Top[-2] = 0;
+    Top[-3] = 0;
+    Top[-4] = reinterpret_cast<uint64_t>(this);
+    Top[-5] = 0;
+    Top[-6] = 0;
+    Top[-7] = 0;
+    uint32_t Control[2] = {0x1F80, 0x037F};
+    memcpy(&Top[-8], Control, sizeof(Control));
+    SP = &Top[-8];
+}
+
+void Waker::Wake() const {
+    F->Loop.MakeReady(F);
+}
+
+Fiber *getCurrent() {
+    return Current;
+}
+
+void Suspend() {
+    auto *F = Current;
+    if (F == nullptr)
+        support::output::Error("fiber::Suspend", "not running on a fiber!\n");
+    // The resumer publishes FiberSuspended once the switch saved SP; until
+    // then a Wake() only leaves WakePending behind.
+    wasmrt_fiber_switch(&F->SP, F->ResumerSP);
+}
+
+EventLoop::EventLoop() {
+    NotifyFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+}
+
+EventLoop::~EventLoop() {
+    if (NotifyFd >= 0)
+        close(NotifyFd);
+}
+
+bool EventLoop::Spawn(std::function<void()> Entry, size_t StackReserve) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Stack S = [&] {
+        for (auto It = FreeStacks.begin(); It != FreeStacks.end(); ++It) {
+            if (It->Reserve == StackReserve) {
+                Stack Reused(std::move(*It));
+                FreeStacks.erase(It);
+                return Reused;
+            }
+        }
+        return Stack(StackReserve);
+    }();
+    if (S.Base == nullptr)
+        return false;
+    ReadyQueue.push_back(new Fiber(*this, std::move(Entry), std::move(S)));
+    ++Live;
+    Cond.notify_one();
+    return true;
+}
+
+void EventLoop::MakeReady(Fiber *F) {
+    {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        if (F->State != FiberSuspended) {
+            // Still running, or switching out of Suspend(): Resume() requeues it.
+            F->WakePending = true;
+            return;
+        }
+        F->State = FiberReady;
+        ReadyQueue.push_back(F);
+    }
+    Cond.notify_one();
+    uint64_t One = 1;
+    if (NotifyFd >= 0)
+        (void)write(NotifyFd, &One, sizeof(One));
+}
+
+void EventLoop::Resume(Fiber *F, std::unique_lock<std::mutex> &Lock) {
+    F->State = FiberRunning;
+    Lock.unlock();
+    auto *Prev = Current;
+    Current = F;
+    wasmrt_fiber_switch(&F->ResumerSP, F->SP);
+    Current = Prev;
+    Lock.lock();
+
+    if (F->Returned) {
+        F->State = FiberFinished;
+        F->S.Release();
+        FreeStacks.push_back(std::move(F->S));
+        delete F;
+        if (--Live == 0)
+            Cond.notify_all();
+        return;
+    }
+    if (F->WakePending) {
+        F->WakePending = false;
+        F->State = FiberReady;
+        ReadyQueue.push_back(F);
+    } else {
+        F->State = FiberSuspended;
+    }
+}
+
+bool EventLoop::addTickHook(const void *Owner, std::function<void()> Hook) {
+    auto Has = [this, Owner] {
+        for (size_t i = 0, N = NumHooks.load(std::memory_order_acquire); i < N; ++i) {
+            if (Hooks[i].Owner == Owner)
+                return true;
+        }
+        return false;
+    };
+    if (Has())
+        return true;
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Has())
+        return true;
+    size_t N = NumHooks.load(std::memory_order_relaxed);
+    if (N == MaxTickHooks)
+        return false;
+    Hooks[N] = {Owner, std::move(Hook)};
+    NumHooks.store(N + 1, std::memory_order_release);
+    return true;
+}
+
+// A tick runs the fibers ready at its start, so that fibers waking each
+// other cannot keep the hooks from running, and then the hooks, without the
+// lock.
+void EventLoop::RunTick(std::unique_lock<std::mutex> &Lock) {
+    for (size_t N = ReadyQueue.size(); N > 0 && !ReadyQueue.empty(); --N) {
+        auto *F = ReadyQueue.front();
+        ReadyQueue.pop_front();
+        Resume(F, Lock);
+    }
+    size_t N = NumHooks.load(std::memory_order_acquire);
+    if (N == 0)
+        return;
+    Lock.unlock();
+    for (size_t i = 0; i < N; ++i)
+        Hooks[i].Run();
+    Lock.lock();
+}
+
+void EventLoop::Run() {
+    std::unique_lock<std::mutex> Lock(Mutex);
+    while (Live > 0) {
+        if (ReadyQueue.empty()) {
+            Cond.wait(Lock);
+            continue;
+        }
+        RunTick(Lock);
+    }
+}
+
+void EventLoop::RunReady() {
+    uint64_t Count;
+    if (NotifyFd >= 0)
+        (void)read(NotifyFd, &Count, sizeof(Count));
+
+    std::unique_lock<std::mutex> Lock(Mutex);
+    RunTick(Lock);
+}
+
+} // namespace fiber
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace wasmrt {
+namespace runtime {
+namespace trap {
+struct EntryFrame;
+} // namespace trap
+
+namespace fiber {
+
+// Virtual reservation per fiber stack. Only touched pages are backed by
+// memory, so a fiber that stays shallow costs a few pages.
+inline constexpr size_t DefaultStackReserve = 1 << 20;   // 1MB
+inline constexpr size_t GuardSize           = 1 << 12;   // 4KB
+
+class Stack {
+public:
+    // Leaves Base null if the reservation cannot be mapped.
+    Stack(size_t Reserve = DefaultStackReserve);
+    Stack(Stack &&Other);
+    Stack &operator=(Stack &&Other);
+    ~Stack();
+
+    // Returns the pages the previous fiber touched to the kernel.
+    void Release();
+
+    inline uint8_t *getTop() const { return Base + Reserve; }
+
+    uint8_t *Base{nullptr};
+    size_t   Reserve{0};
+};
+
+class EventLoop;
+
+enum FiberState : uint8_t {
+    FiberReady = 0,
+    FiberRunning,
+    FiberSuspended,
+    FiberFinished
+};
+
+class Fiber {
+public:
+    Fiber(EventLoop &Loop, std::function<void()> &&Entry, Stack &&S);
+
+    inline FiberState getState() const { return State; }
+
+    EventLoop              &Loop;
+    std::function<void()>  Entry;
+    Stack                  S;
+    void                   *SP{nullptr};
+    void                   *ResumerSP{nullptr};
+    FiberState             State{FiberReady};      // guarded by the loop's mutex
+    bool                   WakePending{false};
+    bool                   Returned{false};        // Entry returned; read by the resumer only
+    trap::EntryFrame       *TrapFrames{nullptr};   // innermost entry into wasm on this fiber
+};
+
+// Handle a host function hands to its completion callback. Wake() may be
+// called from any thread, before or after the fiber actually suspended.
+class Waker {
+public:
+    Waker(Fiber *F = nullptr) : F(F) {}
+    void Wake() const;
+
+    Fiber *F;
+};
+
+// Multiplexes fibers over the threads that call Run(). A suspended fiber
+// resumes on whichever worker picks it up after Wake().
+class EventLoop {
+public:
+    EventLoop();
+    ~EventLoop();
+
+    // Fails when no stack can be mapped for the fiber.
+    bool Spawn(std::function<void()> Entry, size_t StackReserve = DefaultStackReserve);
+
+    // Runs Hook once per tick, on the thread running the tick, after the
+    // fibers that were ready when it began have run or parked; an I/O
+    // backend submits what they queued from here, in one go. One hook per
+    // Owner, adding another does nothing. Fails once MaxTickHooks owners
+    // have one.
+    bool addTickHook(const void *Owner, std::function<void()> Hook);
+
+    // Runs fibers until none are left.
+    void Run();
+
+    // Runs one tick: every fiber that is ready right now, then the hooks;
+    // for embedding in an existing event loop that watches getNotifyFd().
+    void RunReady();
+
+    // eventfd that becomes readable whenever a fiber is woken, or -1 if none
+    // could be created.
+    inline int getNotifyFd() const { return NotifyFd; }
+
+private:
+    friend class Waker;
+
+    static constexpr size_t MaxTickHooks = 4;
+
+    struct TickHook {
+        const void             *Owner{nullptr};
+        std::function<void()>  Run;
+    };
+
+    void Resume(Fiber *F, std::unique_lock<std::mutex> &Lock);
+    void RunTick(std::unique_lock<std::mutex> &Lock);
+    void MakeReady(Fiber *F);
+
+    std::mutex               Mutex;
+    std::condition_variable  Cond;
+    std::deque<Fiber *>      ReadyQueue;
+    std::vector<Stack>       FreeStacks;
+    size_t                   Live{0};
+    int                      NotifyFd{-1};
+    // Only ever appended to, under Mutex; ticks run the first NumHooks
+    // without it.
+    TickHook                 Hooks[MaxTickHooks];
+    std::atomic<size_t>      NumHooks{0};
+};
+
+// Called from a host import running on a fiber.
+Fiber *getCurrent();
+inline Waker getCurrentWaker() { return Waker(getCurrent()); }
+void Suspend();
+
+} // namespace fiber
+} // namespace runtime
+} // namespace wasmrt
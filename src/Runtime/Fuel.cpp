@@ -0,0 +1,77 @@
+#include "Fuel.h"
+#include "Trap.h"
+
+namespace wasmrt {
+namespace runtime {
+namespace fuel {
+
+uint32_t getOpCost(bytecode::BytecodeOp Op) {
+    switch (Op) {
+        case bytecode::Nop:
+        case bytecode::Block:
+        case bytecode::Loop:
+        case bytecode::Else_:
+        case bytecode::End_:
+            return 0;
+        default:
+            return 1;
+    }
+}
+
+FuelPlan::FuelPlan(const module::Expr &Body) {
+    Walk(Body, true);
+}
+
+void FuelPlan::Walk(const module::Expr &E, bool CheckFirst) {
+    StartBlock = true;
+    for (auto &Inst : E) {
+        if (StartBlock) {
+            Current = &Charges[Inst.get()];
+            *Current = {0, CheckFirst};
+            StartBlock = false;
+            CheckFirst = false;
+        }
+
+        auto Op = Inst->getOpcode();
+        Current->Cost += getOpCost(Op);
+        switch (Op) {
+            case bytecode::Block:
+                Walk(static_cast<const bytecode::BlockInst &>(*Inst).Instructions, false);
+                StartBlock = true;
+                break;
+            case bytecode::Loop:
+                Walk(static_cast<const bytecode::BlockInst &>(*Inst).Instructions, true);
+                StartBlock = true;
+                break;
+            case bytecode::If: {
+                auto &IfI = static_cast<const bytecode::IfInst &>(*Inst);
+                Walk(IfI.IfTrue, false);
+                if (!IfI.IfFalse.empty())
+                    Walk(IfI.IfFalse, false);
+                StartBlock = true;
+                break;
+            }
+            case bytecode::Unreachable:
+            case bytecode::Br:
+            case bytecode::BrIf:
+            case bytecode::BrTable:
+            case bytecode::Return:
+            case bytecode::ReturnCall:
+            case bytecode::ReturnCallIndirect:
+            case bytecode::Else_:
+            case bytecode::End_:
+                StartBlock = true;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void OnExhausted(Module *M) {
+    trap::Raise(trap::TrapOutOfFuel, __builtin_return_address(0));
+}
+
+} // namespace fuel
+} // namespace runtime
+} // namespace wasmrt
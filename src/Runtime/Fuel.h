@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Parser/Bytecode.h"
+#include "Parser/Module.h"
+
+#include <cstdint>
+#include <unordered_map>
+
+using namespace wasmrt;
+using namespace wasmrt::parser;
+
+namespace wasmrt {
+namespace runtime {
+
+class Module;
+
+namespace fuel {
+
+// Fuel charged for executing one instruction. Structural instructions are
+// free so that the cost of a function does not depend on how it is nested.
+uint32_t getOpCost(bytecode::BytecodeOp Op);
+
+struct Charge {
+    uint32_t  Cost;    // fuel for the whole basic block starting here
+    bool      Check;   // test the remaining fuel after charging
+};
+
+// Charges for one function body, keyed by the instruction leading each basic
+// block. Derived from the Expr alone, so every tier charges the exact same
+// amounts at the exact same points. Fuel is only checked at the function
+// entry and at loop headers, which every backedge goes through.
+class FuelPlan {
+public:
+    FuelPlan(const module::Expr &Body);
+
+    inline const Charge *lookup(const bytecode::Instruction *Inst) const {
+        auto It = Charges.find(Inst);
+        return It == Charges.end() ? nullptr : &It->second;
+    }
+
+    std::unordered_map<const bytecode::Instruction *, Charge> Charges;
+
+private:
+    void Walk(const module::Expr &E, bool CheckFirst);
+
+    Charge *Current{nullptr};
+    bool    StartBlock{true};
+};
+
+// Slow path taken by generated code once the context's Fuel went negative.
+void OnExhausted(Module *M);
+
+} // namespace fuel
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,25 @@
+#include "Function.h"
+
+namespace wasmrt {
+namespace runtime {
+
+CodegenConfig getCodegenConfig(const Module &Instance) {
+    CodegenConfig Config;
+    Config.BoundsChecks = !Instance.Memories.empty() && Instance.Memories[0]->needsBoundsChecks();
+    Config.Metered = Instance.Options.Metered;
+    Config.Interruptible = Instance.Options.Interruptible;
+    return Config;
+}
+
+Function::Function(const parser::module::Module &M, const FuncType &Type, parser::module::Code &Code,
+                   const CodegenConfig &Config)
+    : Parent(M), Type(Type), Code(Code), Config(Config), CallSites(Code.CallIndirectSites),
+      EpochChecks(Config.Interruptible) {
+    if (Config.Metered)
+        Fuel = std::make_unique<fuel::FuelPlan>(Code.Expr);
+    if (Config.BoundsChecks)
+        Bounds = std::make_unique<bounds::BoundsPlan>(Code.Expr);
+}
+
+} // namespace runtime
+} // namespace wasmrt
@@ -2,17 +2,51 @@
 
 #include "Parser/Module.h"
 
+#include "BoundsCheck.h"
+#include "Fuel.h"
+#include "InlineCache.h"
 #include "Module.h"
 
+#include <memory>
+#include <vector>
+
 using namespace wasmrt;
 
 namespace wasmrt {
 namespace runtime {
 
+// Everything besides the module that changes the code a function is
+// compiled to. Code compiled for one config serves every instance that
+// needs the same one.
+struct CodegenConfig {
+    bool BoundsChecks{false};   // memory 0 has no guard region, see Memory::needsBoundsChecks
+    bool Metered{false};        // see InstanceOptions
+    bool Interruptible{false};
+
+    static constexpr uint32_t NumKeys = 8;
+    inline uint32_t getKey() const { return BoundsChecks | Metered << 1 | Interruptible << 2; }
+};
+
+CodegenConfig getCodegenConfig(const Module &Instance);
+
+// A function as the code generators see it. Built from the module alone, so
+// that its code can be shared by all instances with the same config.
 class Function {
 public:
-    Function(Module &M, parser::module::Code &Code);
+    Function(const parser::module::Module &M, const FuncType &Type, parser::module::Code &Code,
+             const CodegenConfig &Config);
+
+    inline inline_cache::CallSiteCache &getCallSite(uint32_t Site) { return CallSites[Site]; }
+
+    const parser::module::Module              &Parent;
+    const FuncType                            &Type;
+    parser::module::Code                      &Code;
+    CodegenConfig                             Config;
+    std::vector<inline_cache::CallSiteCache>  CallSites;
+    std::unique_ptr<fuel::FuelPlan>           Fuel;   // set when metering is enabled
+    std::unique_ptr<bounds::BoundsPlan>       Bounds; // set when memory accesses are checked explicitly
+    bool                                      EpochChecks{false};
 };
 
 } // namespace runtime
-} // namespace wasmrt
\ No newline at end of file
+} // namespace wasmrt
@@ -0,0 +1,53 @@
+#include "Support/Result.h"
+
+#include "HostFunction.h"
+
+namespace wasmrt {
+namespace runtime {
+namespace host {
+
+HostRegistry::Entry *HostRegistry::find(uint64_t Hash, std::string_view ModuleName, std::string_view Name) {
+    auto [Begin, End] = Funcs.equal_range(Hash);
+    for (auto It = Begin; It != End; ++It) {
+        if (It->second.ModuleName == ModuleName && It->second.Name == Name)
+            return &It->second;
+    }
+    return nullptr;
+}
+
+const HostFunction *HostRegistry::lookup(uint64_t Hash, std::string_view ModuleName, std::string_view Name) const {
+    auto *E = const_cast<HostRegistry *>(this)->find(Hash, ModuleName, Name);
+    return E == nullptr ? nullptr : &E->Func;
+}
+
+const HostFunction *HostRegistry::lookup(std::string_view ModuleName, std::string_view Name) const {
+    return lookup(parser::module::getImportHash(ModuleName, Name), ModuleName, Name);
+}
+
+support::result::Result<std::vector<const HostFunction *>>
+HostRegistry::Link(const parser::module::Module &M) const {
+    std::vector<const HostFunction *> Resolved;
+    for (auto &Import : M.ImportSec) {
+        if (Import.Desc.Tag != parser::module::ImportTagFunc)
+            continue;
+
+        auto ModuleName = M.Names.get(Import.Module);
+        auto Name = M.Names.get(Import.Name);
+        auto *HF = lookup(Import.Hash, ModuleName, Name);
+        if (HF == nullptr)
+            return support::result::MakeFailure("HostRegistry::Link", "unknown import: %.*s.%.*s",
+                int(ModuleName.size()), ModuleName.data(), int(Name.size()), Name.data());
+
+        auto &Expected = M.TypeSec[Import.Desc.Idx.FuncType];
+        if (!HF->Type.equals(Expected))
+            return support::result::MakeFailure("HostRegistry::Link", "incompatible import type for %.*s.%.*s: %s, expected %s",
+                int(ModuleName.size()), ModuleName.data(), int(Name.size()), Name.data(),
+                HF->Type.str().c_str(), Expected.str().c_str());
+        Resolved.push_back(HF);
+    }
+    return std::move(Resolved);
+}
+
+} // namespace host
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Parser/Module.h"
+#include "Parser/Type.h"
+#include "Support/Result.h"
+
+#include "Module.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace runtime {
+namespace host {
+
+template <typename T> struct ValTypeOf;
+template <> struct ValTypeOf<int32_t>  { static constexpr ValType Value = ValTypeI32; };
+template <> struct ValTypeOf<uint32_t> { static constexpr ValType Value = ValTypeI32; };
+template <> struct ValTypeOf<int64_t>  { static constexpr ValType Value = ValTypeI64; };
+template <> struct ValTypeOf<uint64_t> { static constexpr ValType Value = ValTypeI64; };
+template <> struct ValTypeOf<float>    { static constexpr ValType Value = ValTypeF32; };
+template <> struct ValTypeOf<double>   { static constexpr ValType Value = ValTypeF64; };
+
+// Result slots are 64 bits wide; narrower values live in the low bits.
+template <typename T>
+inline uint64_t ToSlot(T Val) {
+    uint64_t Slot = 0;
+    memcpy(&Slot, &Val, sizeof(T));
+    return Slot;
+}
+
+// Wasm code reaches Entry through a thunk generated for it (see
+// target::x86_64::getHostEntry), which passes the calling instance and the
+// wasm arguments with the SysV ABI. Entry is the host function itself,
+// Ret(Module &, Args...), unless it has several results; those do not fit
+// SysV's return registers, so Entry is then an adapter
+// void(Module &, uint64_t *Results, Args...) storing them to a slot each.
+struct HostFunction {
+    FuncType     Type;
+    const void  *Entry;
+};
+
+// Result list of a host function: nothing, a scalar, or a std::tuple of
+// scalars for multi-value results.
+template <typename T>
+struct ResultsOf {
+    static_assert(std::is_arithmetic_v<T>, "host functions return wasm scalars");
+    static constexpr bool Multi = false;
+    static std::vector<ValType> getTypes() { return {ValTypeOf<T>::Value}; }
+    static void Store(uint64_t *Slots, T Val) { Slots[0] = ToSlot(Val); }
+};
+
+template <typename... Ts>
+struct ResultsOf<std::tuple<Ts...>> {
+    static_assert(sizeof...(Ts) > 1, "a single result is returned as a scalar");
+    static constexpr bool Multi = true;
+    static std::vector<ValType> getTypes() { return {ValTypeOf<Ts>::Value...}; }
+    static void Store(uint64_t *Slots, const std::tuple<Ts...> &Vals) {
+        store(Slots, Vals, std::index_sequence_for<Ts...>{});
+    }
+
+private:
+    template <size_t... I>
+    static inline void store(uint64_t *Slots, const std::tuple<Ts...> &Vals, std::index_sequence<I...>) {
+        ((Slots[I] = ToSlot(std::get<I>(Vals))), ...);
+    }
+};
+
+template <auto Fn> struct Binder;
+
+// Host functions take the calling instance first, followed by their wasm
+// parameters as plain C++ scalars.
+template <typename Ret, typename... Args, Ret (*Fn)(Module &, Args...)>
+struct Binder<Fn> {
+    static const void *getEntry() {
+        if constexpr (!std::is_void_v<Ret>) {
+            if constexpr (ResultsOf<Ret>::Multi)
+                return reinterpret_cast<const void *>(&StoreResults);
+        }
+        return reinterpret_cast<const void *>(Fn);
+    }
+
+    static FuncType getType() {
+        std::vector<ValType> Results;
+        if constexpr (!std::is_void_v<Ret>)
+            Results = ResultsOf<Ret>::getTypes();
+        return FuncType(FtTag, std::vector<ValType>{ValTypeOf<Args>::Value...}, std::move(Results));
+    }
+
+private:
+    static void StoreResults(Module &M, uint64_t *Results, Args... Params) {
+        ResultsOf<Ret>::Store(Results, Fn(M, Params...));
+    }
+};
+
+// Host functions are keyed by getImportHash of their module and name, the
+// same hash the reader precomputes for every import, so linking a module
+// costs one integer lookup per import. Names are still compared on a hit.
+class HostRegistry {
+public:
+    template <auto Fn>
+    void Define(std::string_view ModuleName, std::string_view Name) {
+        using B = Binder<Fn>;
+        HostFunction HF{B::getType(), B::getEntry()};
+        auto Hash = parser::module::getImportHash(ModuleName, Name);
+        if (auto *E = find(Hash, ModuleName, Name)) {
+            E->Func = std::move(HF);
+            return;
+        }
+        Funcs.emplace(Hash, Entry{std::string(ModuleName), std::string(Name), std::move(HF)});
+    }
+
+    const HostFunction *lookup(std::string_view ModuleName, std::string_view Name) const;
+    const HostFunction *lookup(uint64_t Hash, std::string_view ModuleName, std::string_view Name) const;
+
+    // Resolves every function import of M against the registry and checks its
+    // signature. Done once at link time; calls are never type checked again.
+    support::result::Result<std::vector<const HostFunction *>> Link(const parser::module::Module &M) const;
+
+private:
+    struct Entry {
+        std::string   ModuleName;
+        std::string   Name;
+        HostFunction  Func;
+    };
+
+    // Import hashes are already well mixed.
+    struct IdentityHash {
+        inline size_t operator()(uint64_t Hash) const { return Hash; }
+    };
+
+    Entry *find(uint64_t Hash, std::string_view ModuleName, std::string_view Name);
+
+    std::unordered_multimap<uint64_t, Entry, IdentityHash> Funcs;
+};
+
+} // namespace host
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,98 @@
+#include "InlineCache.h"
+#include "Module.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace wasmrt {
+namespace runtime {
+namespace inline_cache {
+
+// Saturates rather than wrapping, so that a long-running site keeps its ratios.
+static void Bump(std::atomic<uint32_t> &Count) {
+    uint32_t N = Count.load(std::memory_order_relaxed);
+    if (N != std::numeric_limits<uint32_t>::max())
+        Count.store(N + 1, std::memory_order_relaxed);
+}
+
+void CallSiteCache::Record(FuncIdx Target) {
+    Bump(Samples);
+    if (Megamorphic.load(std::memory_order_relaxed)) {
+        Bump(Misses);
+        return;
+    }
+
+    for (auto &E : Entries) {
+        FuncIdx Seen = E.Target.load(std::memory_order_relaxed);
+        if (Seen == NoTarget) {
+            if (E.Target.compare_exchange_strong(Seen, Target, std::memory_order_relaxed)) {
+                Bump(Misses);
+                Bump(E.Hits);
+                return;
+            }
+            // Another thread claimed the slot; Seen is now its target.
+        }
+        if (Seen == Target) {
+            Bump(E.Hits);
+            return;
+        }
+    }
+
+    Bump(Misses);
+    Megamorphic.store(true, std::memory_order_relaxed);
+}
+
+CacheState CallSiteCache::getState() const {
+    if (Megamorphic.load(std::memory_order_relaxed))
+        return CacheMegamorphic;
+    if (Entries[0].Target.load(std::memory_order_relaxed) == NoTarget)
+        return CacheEmpty;
+    return Entries[1].Target.load(std::memory_order_relaxed) == NoTarget ? CacheMonomorphic : CachePolymorphic;
+}
+
+std::vector<FuncIdx> CallSiteCache::getGuardTargets(double MinCoverage) const {
+    std::vector<FuncIdx> Targets;
+    uint32_t NumSamples = getSamples();
+    auto State = getState();
+    if (State == CacheEmpty || State == CacheMegamorphic || NumSamples < MinSamplesForDevirtualize)
+        return Targets;
+
+    // Recording does not keep the slots in order, so sort a snapshot to put
+    // the likeliest guard first.
+    std::pair<uint32_t, FuncIdx> Hot[MaxPolymorphicTargets];
+    size_t Size = 0;
+    for (auto &E : Entries) {
+        FuncIdx Target = E.Target.load(std::memory_order_relaxed);
+        if (Target == NoTarget)
+            break;
+        Hot[Size++] = {E.Hits.load(std::memory_order_relaxed), Target};
+    }
+    std::stable_sort(Hot, Hot + Size, [](const auto &A, const auto &B) { return A.first > B.first; });
+
+    uint64_t Covered = 0;
+    for (size_t i = 0; i < Size; ++i) {
+        if (Hot[i].second == ForeignTarget)
+            break;
+        Targets.push_back(Hot[i].second);
+        Covered += Hot[i].first;
+        if (Covered >= MinCoverage * NumSamples)
+            return Targets;
+    }
+    // Hits spread too thin, so that a chain of guards would cost more than it
+    // saves, or too many go to other instances.
+    Targets.clear();
+    return Targets;
+}
+
+void RecordCallTarget(CallSiteCache *Cache, const FuncEntry *Target, Module *Caller) {
+    if (Target->Instance != Caller) {
+        Cache->Record(ForeignTarget);
+        return;
+    }
+    Cache->Record(FuncIdx(Target - Caller->FuncEntries.data()));
+}
+
+} // namespace inline_cache
+} // namespace runtime
+} // namespace wasmrt
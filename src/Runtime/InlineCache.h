@@ -0,0 +1,73 @@
+#pragma once
+
+#include "Parser/Type.h"
+
+#include "Table.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace runtime {
+namespace inline_cache {
+
+inline constexpr uint32_t MaxPolymorphicTargets = 4;
+// Sites seen fewer times than this are not worth guarding in compiled code.
+inline constexpr uint32_t MinSamplesForDevirtualize = 64;
+// Recorded for targets in another instance (reached through an imported
+// table), which a guard on a function index of this module cannot match.
+inline constexpr FuncIdx ForeignTarget = UINT32_MAX;
+// Held by slots not claimed yet; no module has that many functions.
+inline constexpr FuncIdx NoTarget = UINT32_MAX - 1;
+
+enum CacheState : uint8_t {
+    CacheEmpty = 0,
+    CacheMonomorphic,
+    CachePolymorphic,
+    CacheMegamorphic
+};
+
+struct CacheEntry {
+    std::atomic<FuncIdx>   Target{NoTarget};
+    std::atomic<uint32_t>  Hits{0};
+};
+
+// Per call_indirect site profile, filled by the interpreter tier and read by
+// the compiler tier to guard and inline the common targets.
+//
+// All threads running the function record into the same profile without a
+// lock. Slots are claimed in order by swapping a target into an empty one,
+// so no two threads take the same slot; counters are relaxed loads and
+// stores that may drop an increment under contention, which a heuristic can
+// afford and the hot path is spared a locked instruction for.
+struct CallSiteCache {
+    void Record(FuncIdx Target);
+
+    CacheState getState() const;
+    inline bool isMonomorphic() const { return getState() == CacheMonomorphic; }
+    inline bool isMegamorphic() const { return getState() == CacheMegamorphic; }
+    inline uint32_t getSamples() const { return Samples.load(std::memory_order_relaxed); }
+
+    // Returns the targets, hottest first, that together cover at least
+    // MinCoverage of the recorded calls. Empty if the site is not worth
+    // devirtualizing.
+    std::vector<FuncIdx> getGuardTargets(double MinCoverage = 0.9) const;
+
+    std::atomic<uint32_t>  Samples{0};
+    std::atomic<uint32_t>  Misses{0};
+    std::atomic<bool>      Megamorphic{false};
+    CacheEntry             Entries[MaxPolymorphicTargets];
+};
+
+// Entry used by the interpreter's call_indirect template after the table
+// lookup and signature check succeeded, with the resolved entry and the
+// calling instance.
+void RecordCallTarget(CallSiteCache *Cache, const FuncEntry *Target, Module *Caller);
+
+} // namespace inline_cache
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Table.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wasmrt {
+namespace runtime {
+
+class Module;
+struct GlobalSlot;
+
+// The only instance state generated code addresses directly, through
+// ContextReg. Everything loads, stores, globals, tables, calls and the
+// loop-header checks need sits in one cache line, so code that stays in
+// wasm keeps a single line of instance state hot. Offsets are part of the
+// code generator's contract and pinned by the asserts below.
+struct alignas(64) InstanceContext {
+    uint8_t      *MemBase;        // memory 0, also held in MemBaseReg
+    uint64_t      MemBound;       // byte size of memory 0, also held in MemBoundReg
+    GlobalSlot   *Globals;
+    TableView    *Tables;
+    FuncEntry    *Funcs;          // by function index, for call and ref.func
+    int64_t       Fuel;           // remaining fuel in metered mode
+    uint64_t      EpochDeadline;
+    Module       *Instance;       // first argument of runtime calls
+};
+
+static_assert(sizeof(InstanceContext) == 64, "context must stay within one cache line");
+static_assert(offsetof(InstanceContext, MemBase) == 0 && offsetof(InstanceContext, MemBound) == 8,
+              "templates address the memory fields at fixed offsets");
+
+} // namespace runtime
+} // namespace wasmrt
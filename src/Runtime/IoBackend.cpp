@@ -0,0 +1,175 @@
+#include "Support/Output.h"
+
+#include "Fiber.h"
+#include "IoBackend.h"
+
+#include <cerrno>
+#include <unistd.h>
+
+#ifdef WASMRT_IO_URING
+#include <liburing.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace wasmrt {
+namespace runtime {
+namespace io {
+
+ssize_t SyncIoBackend::Readv(int Fd, const struct iovec *Iov, int Count, int64_t Offset) {
+    auto N = Offset < 0 ? readv(Fd, Iov, Count) : preadv(Fd, Iov, Count, Offset);
+    return N < 0 ? -errno : N;
+}
+
+ssize_t SyncIoBackend::Writev(int Fd, const struct iovec *Iov, int Count, int64_t Offset) {
+    auto N = Offset < 0 ? writev(Fd, Iov, Count) : pwritev(Fd, Iov, Count, Offset);
+    return N < 0 ? -errno : N;
+}
+
+IoBackend &getSyncBackend() {
+    static SyncIoBackend Backend;
+    return Backend;
+}
+
+#ifdef WASMRT_IO_URING
+class IoUringBackend final : public IoBackend {
+public:
+    static constexpr unsigned RingEntries = 256;
+
+    IoUringBackend() {
+        if (int Err = io_uring_queue_init(RingEntries, &Ring, 0); Err < 0)
+            support::output::Error("IoUringBackend::IoUringBackend", "io_uring_queue_init failed: %d", -Err);
+        Reaper = std::thread([this] { Reap(); });
+    }
+
+    // A request without a waiter tells the reaper to stop.
+    ~IoUringBackend() override {
+        {
+            std::lock_guard<std::mutex> Lock(Mutex);
+            auto *SQE = getSQE();
+            io_uring_prep_nop(SQE);
+            io_uring_sqe_set_data(SQE, nullptr);
+            Submit();
+        }
+        Reaper.join();
+        io_uring_queue_exit(&Ring);
+    }
+
+    ssize_t Readv(int Fd, const struct iovec *Iov, int Count, int64_t Offset) override {
+        return submit([&](struct io_uring_sqe *SQE) {
+            io_uring_prep_readv(SQE, Fd, Iov, Count, Offset < 0 ? -1 : Offset);
+        });
+    }
+
+    ssize_t Writev(int Fd, const struct iovec *Iov, int Count, int64_t Offset) override {
+        return submit([&](struct io_uring_sqe *SQE) {
+            io_uring_prep_writev(SQE, Fd, Iov, Count, Offset < 0 ? -1 : Offset);
+        });
+    }
+
+private:
+    struct Request {
+        ssize_t       Result{0};
+        bool          Done{false};
+        fiber::Waker  Waker;    // of the parked fiber; none for a blocked thread
+    };
+
+    // With Mutex held. A full submission queue is drained by submitting it.
+    struct io_uring_sqe *getSQE() {
+        struct io_uring_sqe *SQE;
+        while ((SQE = io_uring_get_sqe(&Ring)) == nullptr)
+            Submit();
+        return SQE;
+    }
+
+    void Submit() {
+        io_uring_submit(&Ring);
+        Queued = 0;
+    }
+
+    void Flush() {
+        std::lock_guard<std::mutex> Lock(Mutex);
+        if (Queued != 0)
+            Submit();
+    }
+
+    // A fiber queues its request and parks; its loop submits everything
+    // queued during the tick with one call once the tick's fibers have run,
+    // and the reaper wakes the fiber on completion, so the loop's thread
+    // goes on running other fibers meanwhile. Callers not on a fiber, or on
+    // a loop without room for the hook, submit right away and block.
+    template <typename Prep>
+    ssize_t submit(Prep &&P) {
+        Request Req;
+        auto *F = fiber::getCurrent();
+        if (F != nullptr && !F->Loop.addTickHook(this, [this] { Flush(); }))
+            F = nullptr;
+        Req.Waker = fiber::Waker(F);
+
+        std::unique_lock<std::mutex> Lock(Mutex);
+        auto *SQE = getSQE();
+        P(SQE);
+        io_uring_sqe_set_data(SQE, &Req);
+        if (F == nullptr) {
+            Submit();
+            Cond.wait(Lock, [&Req] { return Req.Done; });
+            return Req.Result;
+        }
+        ++Queued;
+        // Only the reaper wakes the fiber, and it does so holding Mutex, so
+        // Req stays alive until the wake is delivered.
+        while (!Req.Done) {
+            Lock.unlock();
+            fiber::Suspend();
+            Lock.lock();
+        }
+        return Req.Result;
+    }
+
+    // The only user of the completion queue, which it waits on without the
+    // lock while others keep queueing and submitting.
+    void Reap() {
+        for (;;) {
+            struct io_uring_cqe *CQE;
+            if (io_uring_wait_cqe(&Ring, &CQE) < 0)
+                continue;
+            std::lock_guard<std::mutex> Lock(Mutex);
+            unsigned Head, Seen = 0;
+            bool Stop = false;
+            io_uring_for_each_cqe(&Ring, Head, CQE) {
+                auto *R = static_cast<Request *>(io_uring_cqe_get_data(CQE));
+                ++Seen;
+                if (R == nullptr) {
+                    Stop = true;
+                    continue;
+                }
+                R->Result = CQE->res;
+                R->Done = true;
+                if (R->Waker.F != nullptr)
+                    R->Waker.Wake();
+            }
+            io_uring_cq_advance(&Ring, Seen);
+            Cond.notify_all();
+            if (Stop)
+                return;
+        }
+    }
+
+    struct io_uring          Ring;
+    std::mutex               Mutex;
+    std::condition_variable  Cond;
+    unsigned                 Queued{0};     // prepared since the last submit
+    std::thread              Reaper;
+};
+
+IoBackend &getIoUringBackend() {
+    static IoUringBackend Backend;
+    return Backend;
+}
+#endif
+
+} // namespace io
+} // namespace runtime
+} // namespace wasmrt
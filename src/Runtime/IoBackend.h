@@ -0,0 +1,40 @@
+#pragma once
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <cstdint>
+
+namespace wasmrt {
+namespace runtime {
+namespace io {
+
+// Vectored I/O over guest buffers. Offset < 0 means "current file position".
+// Results follow the syscall convention: bytes transferred, or -errno.
+class IoBackend {
+public:
+    virtual ~IoBackend() = default;
+    virtual ssize_t Readv(int Fd, const struct iovec *Iov, int Count, int64_t Offset) = 0;
+    virtual ssize_t Writev(int Fd, const struct iovec *Iov, int Count, int64_t Offset) = 0;
+};
+
+// Issues readv/writev/preadv/pwritev directly on the calling thread.
+class SyncIoBackend final : public IoBackend {
+public:
+    ssize_t Readv(int Fd, const struct iovec *Iov, int Count, int64_t Offset) override;
+    ssize_t Writev(int Fd, const struct iovec *Iov, int Count, int64_t Offset) override;
+};
+
+IoBackend &getSyncBackend();
+
+#ifdef WASMRT_IO_URING
+// One ring shared by every instance using it. Requests made on a fiber park
+// the fiber instead of its thread; the requests queued during an event-loop
+// tick are submitted together at its end (see EventLoop::addTickHook), and a
+// reaper thread wakes each fiber as its completion comes in.
+IoBackend &getIoUringBackend();
+#endif
+
+} // namespace io
+} // namespace runtime
+} // namespace wasmrt
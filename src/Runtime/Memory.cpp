@@ -0,0 +1,200 @@
+#include "Memory.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace wasmrt {
+namespace runtime {
+
+void IoVecList::reset(size_t N) {
+    if (N > Capacity) {
+        if (Vecs != Inline)
+            delete[] Vecs;
+        Vecs = new struct iovec[N];
+        Capacity = N;
+    }
+    Count = N;
+    Total = 0;
+}
+
+// The largest memory64 size, 2^64 bytes, does not fit; stop a page short.
+static uint64_t getPageLimit(const MemType &Type) {
+    return Type.is64() ? parser::module::MaxPageCount64 - 1 : parser::module::MaxPageCount;
+}
+
+static uint64_t getMaxSize(const MemType &Type) {
+    uint64_t Limit = getPageLimit(Type);
+    return std::min(Type.hasMax() ? Type.Max : Limit, Limit) * parser::module::PageSize;
+}
+
+// Capped like the maximum, so that a minimum of 2^48 pages fails to map
+// below rather than wrapping to an empty memory.
+static uint64_t getMinSize(const MemType &Type) {
+    return std::min<uint64_t>(Type.Min, getPageLimit(Type)) * parser::module::PageSize;
+}
+
+static void *Reserve(uint64_t Len) {
+    return mmap(nullptr, Len, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+}
+
+namespace {
+
+// Reservations of live memories, for the fault handler: it may read them at
+// any time, so slots are claimed and cleared with atomics only and blocks,
+// once published, are never freed. A slot's Base is 1 while it is being
+// filled in.
+struct ReservationSlot {
+    std::atomic<uintptr_t>  Base{0};
+    std::atomic<uint64_t>   Len{0};
+};
+
+struct ReservationBlock {
+    static constexpr size_t NumSlots = 64;
+
+    ReservationSlot   Slots[NumSlots];
+    ReservationBlock  *Next{nullptr};
+};
+
+std::atomic<ReservationBlock *> Reservations{nullptr};
+
+void Publish(ReservationSlot &Slot, const uint8_t *Base, uint64_t Len) {
+    Slot.Len.store(Len, std::memory_order_relaxed);
+    Slot.Base.store(reinterpret_cast<uintptr_t>(Base), std::memory_order_release);
+}
+
+void AddReservation(const uint8_t *Base, uint64_t Len) {
+    for (auto *B = Reservations.load(std::memory_order_acquire); B != nullptr; B = B->Next) {
+        for (auto &Slot : B->Slots) {
+            uintptr_t Free = 0;
+            if (Slot.Base.compare_exchange_strong(Free, 1, std::memory_order_relaxed)) {
+                Publish(Slot, Base, Len);
+                return;
+            }
+        }
+    }
+    auto *B = new ReservationBlock;
+    Publish(B->Slots[0], Base, Len);
+    B->Next = Reservations.load(std::memory_order_relaxed);
+    while (!Reservations.compare_exchange_weak(B->Next, B, std::memory_order_release))
+        ;
+}
+
+void RemoveReservation(const uint8_t *Base) {
+    auto Key = reinterpret_cast<uintptr_t>(Base);
+    for (auto *B = Reservations.load(std::memory_order_acquire); B != nullptr; B = B->Next) {
+        for (auto &Slot : B->Slots) {
+            if (Slot.Base.load(std::memory_order_relaxed) == Key) {
+                Slot.Base.store(0, std::memory_order_release);
+                return;
+            }
+        }
+    }
+}
+
+} // namespace
+
+bool isReservedAddress(const void *Addr) {
+    auto A = reinterpret_cast<uintptr_t>(Addr);
+    for (auto *B = Reservations.load(std::memory_order_acquire); B != nullptr; B = B->Next) {
+        for (auto &Slot : B->Slots) {
+            auto Base = Slot.Base.load(std::memory_order_acquire);
+            if (Base > 1 && A >= Base && A - Base < Slot.Len.load(std::memory_order_relaxed))
+                return true;
+        }
+    }
+    return false;
+}
+
+Memory::Memory(const MemType &Type)
+    : Size(getMinSize(Type)),
+      MaxSize(getMaxSize(Type)),
+      Shared(Type.isShared()), Is64(Type.is64()) {
+    // Without a large enough range (e.g. under a tight RLIMIT_AS), fall back
+    // to reserving what the memory may grow to and checking accesses.
+    void *Ptr = MAP_FAILED;
+    if (!Is64) {
+        Reserved = Reservation32;
+        Ptr = Reserve(Reserved);
+    }
+    if (Ptr == MAP_FAILED) {
+        Reserved = std::max<uint64_t>(std::min(MaxSize, MaxReservation64), parser::module::PageSize);
+        Ptr = Reserve(Reserved);
+    }
+    if (Ptr == MAP_FAILED)
+        return;
+
+    uint64_t Initial = Size.load(std::memory_order_relaxed);
+    if (Initial > Reserved || (Initial != 0 && mprotect(Ptr, Initial, PROT_READ | PROT_WRITE) != 0)) {
+        munmap(Ptr, Reserved);
+        return;
+    }
+    Base = static_cast<uint8_t *>(Ptr);
+    AddReservation(Base, Reserved);
+}
+
+Memory::~Memory() {
+    if (Base == nullptr)
+        return;
+    RemoveReservation(Base);
+    munmap(Base, Reserved);
+}
+
+int64_t Memory::grow(uint64_t DeltaPages) {
+    std::lock_guard<std::mutex> Guard(GrowLock);
+    uint64_t Old = Size.load(std::memory_order_relaxed);
+    if (DeltaPages > (MaxSize - Old) / parser::module::PageSize)
+        return -1;
+    uint64_t New = Old + DeltaPages * parser::module::PageSize;
+    if (New > Reserved)
+        return -1;
+    if (New != Old && mprotect(Base + Old, New - Old, PROT_READ | PROT_WRITE) != 0)
+        return -1;
+    Size.store(New, std::memory_order_release);
+    return Old / parser::module::PageSize;
+}
+
+bool Memory::getIoVecs(uint32_t IovsOffset, uint32_t IovsCount, IoVecList &Out) {
+    auto Iovs = getSpan<uint32_t>(IovsOffset, uint64_t(IovsCount) * 2);
+    if (!Iovs)
+        return false;
+
+    Out.reset(IovsCount);
+    for (uint32_t i = 0; i < IovsCount; ++i) {
+        uint32_t Buf = Iovs[2 * i], Len = Iovs[2 * i + 1];
+        if (!inBounds(Buf, Len))
+            return false;
+        Out.Vecs[i] = {Base + Buf, Len};
+        Out.Total += Len;
+    }
+    return true;
+}
+
+bool Memory::mapCopyOnWrite(uint64_t Offset, int Fd, uint64_t FileOffset, const uint8_t *Src, uint64_t Len) {
+    static const uint64_t HostPage = sysconf(_SC_PAGESIZE);
+    if (!inBounds(Offset, Len) || Offset % HostPage != FileOffset % HostPage)
+        return false;
+
+    uint64_t Begin = (Offset + HostPage - 1) & ~(HostPage - 1);
+    uint64_t End = (Offset + Len) & ~(HostPage - 1);
+    if (Begin >= End) {
+        memcpy(Base + Offset, Src, Len);
+        return true;
+    }
+
+    void *Ptr = mmap(Base + Begin, End - Begin, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_FIXED, Fd, FileOffset + (Begin - Offset));
+    if (Ptr == MAP_FAILED) {
+        // A failed MAP_FIXED may already have unmapped the range; put fresh
+        // pages back so that the caller can copy the segment instead.
+        mmap(Base + Begin, End - Begin, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+        return false;
+    }
+    memcpy(Base + Offset, Src, Begin - Offset);
+    memcpy(Base + End, Src + (End - Offset), Offset + Len - End);
+    return true;
+}
+
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Parser/Module.h"
+#include "Parser/Type.h"
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <type_traits>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace runtime {
+
+// A view of Count guest values that was bounds checked when it was created.
+// Host code indexes it without further checks. It stays valid until the
+// memory grows.
+template <typename T>
+class GuestSpan {
+public:
+    static_assert(std::is_trivially_copyable_v<T>, "guest memory holds plain data only");
+
+    GuestSpan() = default;
+    GuestSpan(T *Data, size_t Count) : Data(Data), Count(Count) {}
+
+    inline T *data() const { return Data; }
+    inline size_t size() const { return Count; }
+    inline size_t size_bytes() const { return Count * sizeof(T); }
+    inline bool empty() const { return Count == 0; }
+    inline T *begin() const { return Data; }
+    inline T *end() const { return Data + Count; }
+    inline T &operator[](size_t Idx) const { return Data[Idx]; }
+    inline explicit operator bool() const { return Data != nullptr; }
+
+private:
+    T      *Data{nullptr};
+    size_t  Count{0};
+};
+
+// Scatter/gather list over guest buffers, laid out as struct iovec so that it
+// can be handed to readv/writev/sendmsg as is. Small lists stay inline.
+class IoVecList {
+public:
+    static constexpr size_t InlineCapacity = 16;
+
+    IoVecList() = default;
+    IoVecList(const IoVecList &) = delete;
+    IoVecList &operator=(const IoVecList &) = delete;
+    ~IoVecList() {
+        if (Vecs != Inline)
+            delete[] Vecs;
+    }
+
+    void reset(size_t N);
+
+    inline struct iovec *data() { return Vecs; }
+    inline const struct iovec *data() const { return Vecs; }
+    inline size_t size() const { return Count; }
+    inline size_t totalBytes() const { return Total; }
+
+    struct iovec  *Vecs{Inline};
+    size_t         Count{0};
+    size_t         Total{0};
+
+private:
+    size_t         Capacity{InlineCapacity};
+    struct iovec   Inline[InlineCapacity];
+};
+
+// Linear memory lives in one virtual range reserved up front, so it never
+// moves: Base is fixed for the lifetime of the memory and growing only
+// makes more of the range accessible. For 32-bit memories the reservation
+// also covers every address + offset a wasm access can form, so an access
+// past Size faults on an inaccessible page instead of needing a check.
+class Memory {
+public:
+    // 4GB of addresses plus 4GB of offsets.
+    static constexpr uint64_t Reservation32 = 8ull << 30;
+    // memory64 cannot be covered; reserve up to this much and check explicitly.
+    static constexpr uint64_t MaxReservation64 = 1ull << 40;
+
+    // Leaves Base null if the range cannot be reserved or the initial pages
+    // made accessible; such a memory must not be used.
+    Memory(const MemType &Type);
+    ~Memory();
+
+    inline uint8_t *getBase() const { return Base; }
+    // Acquire pairs with the release in grow(), so the new pages are
+    // accessible before a thread can observe the new size.
+    inline uint64_t getSize() const { return Size.load(std::memory_order_acquire); }
+    inline bool needsBoundsChecks() const { return Reserved < Reservation32 || Is64; }
+
+    // Returns the old size in pages, or -1. Never moves the memory, and takes
+    // only this memory's lock, so accesses from other threads go on unaffected.
+    int64_t grow(uint64_t DeltaPages);
+
+    inline bool inBounds(uint64_t Offset, uint64_t Len) const {
+        uint64_t Size = getSize();
+        return Offset <= Size && Len <= Size - Offset;
+    }
+
+    template <typename T>
+    GuestSpan<T> getSpan(uint64_t Offset, uint64_t Count) {
+        if (Count > getSize() / sizeof(T) || !inBounds(Offset, Count * sizeof(T)))
+            return {};
+        auto *Ptr = Base + Offset;
+        if (reinterpret_cast<uintptr_t>(Ptr) % alignof(T) != 0)
+            return {};
+        return {reinterpret_cast<T *>(Ptr), static_cast<size_t>(Count)};
+    }
+
+    inline GuestSpan<uint8_t> getBytes(uint64_t Offset, uint64_t Len) {
+        return getSpan<uint8_t>(Offset, Len);
+    }
+
+    // Translates the guest array of (u32 buf, u32 len) pairs at IovsOffset
+    // into host iovecs pointing straight at guest memory. Every buffer is
+    // checked here, once, so the list can go to the kernel unchanged.
+    bool getIoVecs(uint32_t IovsOffset, uint32_t IovsCount, IoVecList &Out);
+
+    // Places Len bytes of the file Fd, starting at FileOffset, at Offset. Whole
+    // host pages are mapped privately from the file, so untouched pages are
+    // shared with the page cache; the ragged ends are copied. Requires Offset
+    // and FileOffset to agree modulo the host page size. Returns false when
+    // the segment could not be placed this way and has to be copied.
+    bool mapCopyOnWrite(uint64_t Offset, int Fd, uint64_t FileOffset, const uint8_t *Src, uint64_t Len);
+
+    template <typename T>
+    bool load(uint64_t Offset, T &Val) const {
+        if (!inBounds(Offset, sizeof(T)))
+            return false;
+        memcpy(&Val, Base + Offset, sizeof(T));
+        return true;
+    }
+
+    template <typename T>
+    bool store(uint64_t Offset, T Val) {
+        if (!inBounds(Offset, sizeof(T)))
+            return false;
+        memcpy(Base + Offset, &Val, sizeof(T));
+        return true;
+    }
+
+    uint8_t                *Base{nullptr};
+    std::atomic<uint64_t>   Size{0};
+    uint64_t                MaxSize{0};
+    uint64_t                Reserved{0};    // bytes of address space behind Base
+    std::mutex              GrowLock;
+    bool                    Shared{false};
+    bool                    Is64{false};    // i64 addresses; accesses are checked explicitly
+};
+
+// Whether Addr lies in the reserved range of a live memory, accessible or
+// not. Async-signal-safe, for fault handlers.
+bool isReservedAddress(const void *Addr);
+
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,239 @@
+#include "Parser/Reader.h"
+
+#include "Atomics.h"
+#include "BulkMemory.h"
+#include "Module.h"
+
+namespace wasmrt {
+namespace runtime {
+
+// Segments at least this large are mapped from the module file rather than
+// copied, when the module was read from a file.
+static constexpr uint32_t MapThreshold = 64 * 1024;
+
+Module::Module(parser::module::Module &M, const InstanceImports &Imports, const InstanceOptions &Options)
+    : Context{}, Options(Options), Globals(Imports.Globals) {
+    // call_indirect compares a single integer against the process-wide id of
+    // the signature. The reader canonicalized the types, so only the first
+    // of each shape is looked up.
+    std::vector<uint32_t> SigIds(M.TypeSec.size());
+    for (uint32_t i = 0; i < SigIds.size(); ++i)
+        SigIds[i] = M.TypeIds[i] == i ? getSignatureId(M.TypeSec[i]) : SigIds[M.TypeIds[i]];
+    // Calls to imported functions enter the exporting instance; host
+    // functions have none and run in this one. Imports not linked to
+    // anything trap when called.
+    FuncEntries.reserve(M.FuncTypes.size());
+    for (auto Type : M.FuncTypes) {
+        if (FuncEntries.size() < M.NumImportedFuncs && FuncEntries.size() < Imports.Funcs.size()) {
+            auto &Imported = Imports.Funcs[FuncEntries.size()];
+            if (Imported.TypeId != SigIds[Type]) {
+                InitFailure = support::result::MakeFailure("Module::Module", "incompatible function import %zu",
+                                                           FuncEntries.size());
+                return;
+            }
+            FuncEntries.push_back(Imported);
+            if (Imported.Context == nullptr) {
+                FuncEntries.back().Instance = this;
+                FuncEntries.back().Context = &Context;
+            }
+        } else if (FuncEntries.size() < M.NumImportedFuncs) {
+            FuncEntries.push_back({SigIds[Type], reinterpret_cast<const void *>(&trap::RaiseUnlinkedImport),
+                                   this, &Context});
+        } else {
+            FuncEntries.push_back({SigIds[Type], nullptr, this, &Context});
+        }
+    }
+    NumImportedFuncs = M.NumImportedFuncs;
+
+    // Initializers were folded by the reader, so this is a copy per global
+    // unless arithmetic on globals was left to run here.
+    Globals.reserve(Globals.size() + M.GlobalSec.size());
+    for (auto &G : M.GlobalSec) {
+        if (G.Init.Kind == parser::module::ConstProgram) {
+            Globals.push_back({{getConst(M, G.Init), 0}});
+        } else if (G.Init.Kind == parser::module::ConstGlobal) {
+            // The addend is zero unless the global is an integer.
+            auto Slot = Globals[G.Init.Bits[0]];
+            Slot.Bits[0] = getConst(M, G.Init);
+            Globals.push_back(Slot);
+        } else if (G.Type.Type == ValTypeFuncRef) {
+            Globals.push_back({{getFuncRef(G.Init.Bits[0]), 0}});
+        } else if (G.Type.Type == ValTypeExternRef) {
+            Globals.push_back({{NullRef, 0}});
+        } else {
+            Globals.push_back({{G.Init.Bits[0], G.Init.Bits[1]}});
+        }
+    }
+
+    // Imported memories, like tables below, take the first indices and are
+    // the exporters' own.
+    for (auto &Import : M.ImportSec) {
+        if (Import.Desc.Tag != parser::module::ImportTagMem)
+            continue;
+        auto &Type = Import.Desc.Idx.Mem;
+        if (Memories.size() >= Imports.Memories.size()) {
+            InitFailure = support::result::MakeFailure("Module::Module", "unresolved memory import %zu",
+                                                       Memories.size());
+            return;
+        }
+        auto &Imported = Imports.Memories[Memories.size()];
+        if (Imported->Shared != Type.isShared() || Imported->Is64 != Type.is64() ||
+            Imported->getSize() / parser::module::PageSize < Type.Min ||
+            (Type.hasMax() && Imported->MaxSize / parser::module::PageSize > Type.Max)) {
+            InitFailure = support::result::MakeFailure("Module::Module", "incompatible memory import %zu",
+                                                       Memories.size());
+            return;
+        }
+        Memories.push_back(Imported);
+    }
+    for (auto &Type : M.MemSec) {
+        Memories.emplace_back(std::make_shared<Memory>(Type));
+        if (Memories.back()->getBase() == nullptr) {
+            InitFailure = support::result::MakeFailure("Module::Module", "cannot reserve memory %zu",
+                                                       Memories.size() - 1);
+            return;
+        }
+    }
+    // Imported tables take the first indices and are the exporters' own, so
+    // that stores and growth through either instance are seen by both.
+    for (auto &Import : M.ImportSec) {
+        if (Import.Desc.Tag != parser::module::ImportTagTable)
+            continue;
+        auto &Type = Import.Desc.Idx.Table;
+        if (Tables.size() >= Imports.Tables.size()) {
+            InitFailure = support::result::MakeFailure("Module::Module", "unresolved table import %zu", Tables.size());
+            return;
+        }
+        auto &Imported = Imports.Tables[Tables.size()];
+        if (Imported->ElemType != Type.ElemType || Imported->getSize() < Type.Range.Min ||
+            (Type.Range.hasMax() && Imported->Max > Type.Range.Max)) {
+            InitFailure = support::result::MakeFailure("Module::Module", "incompatible table import %zu", Tables.size());
+            return;
+        }
+        Tables.push_back(Imported);
+    }
+    for (auto &Type : M.TableSec)
+        Tables.emplace_back(std::make_shared<Table>(Type));
+
+    for (auto &E : M.ElemSec) {
+        if (E.Mode == parser::module::ElemPassive) {
+            ElemSegments.push_back({E.Init.data(), uint32_t(E.Init.size())});
+            continue;
+        }
+        // Active segments behave as dropped once applied, declarative ones
+        // right away.
+        ElemSegments.push_back({nullptr, 0});
+        if (E.Mode == parser::module::ElemDeclarative)
+            continue;
+
+        auto &Tab = *Tables[E.Table];
+        uint32_t Dst = getConst(M, E.Offset);
+        if (uint64_t(Dst) + E.Init.size() > Tab.getSize()) {
+            InitTrap = trap::TrapOutOfBounds;
+            return;
+        }
+        for (auto Func : E.Init)
+            Tab.Elems[Dst++] = getFuncRef(Func);
+    }
+    TableViews.resize(Tables.size());
+    for (size_t i = 0; i < Tables.size(); ++i)
+        Tables[i]->attach(&TableViews[i]);
+
+    // Generated code only sees the instance through here. None of the
+    // vectors is resized after this point, so the pointers stay valid.
+    Context.Globals = Globals.data();
+    Context.Tables = TableViews.data();
+    Context.Funcs = FuncEntries.data();
+    Context.EpochDeadline = std::numeric_limits<uint64_t>::max();
+    Context.Instance = this;
+    if (!Memories.empty()) {
+        Context.MemBase = Memories[0]->getBase();
+        Context.MemBound = Memories[0]->getSize();
+    }
+
+    const auto *Source = M.Source.get();
+    for (auto &D : M.DataSec) {
+        if (D.Mode == parser::module::DataPassive) {
+            DataSegments.push_back({D.Init, D.Size});
+            continue;
+        }
+
+        auto &Mem = getMemory(D.Mem);
+        uint64_t Dst = getConst(M, D.Offset);
+        bool Mapped = false;
+        if (Source != nullptr && Source->Fd >= 0 && D.Size >= MapThreshold)
+            Mapped = Mem.mapCopyOnWrite(Dst, Source->Fd, D.Init - Source->Buffer, D.Init, D.Size);
+        if (!Mapped) {
+            if (!Mem.inBounds(Dst, D.Size)) {
+                InitTrap = trap::TrapOutOfBounds;
+                return;
+            }
+            bulk::Copy(Mem.getBase() + Dst, D.Init, D.Size);
+        }
+        DataSegments.push_back({nullptr, 0});
+    }
+}
+
+// Other threads running the instance read the bound while it is stored, so
+// the store must be atomic (C++17 has no atomic_ref). Relaxed is enough: a stale bound only makes the
+// reader take the refresh path.
+static uint64_t StoreMemoryBound(Module *M) {
+    auto Size = M->getMemory().getSize();
+    __atomic_store_n(&M->Context.MemBound, Size, __ATOMIC_RELAXED);
+    return Size;
+}
+
+int64_t MemoryGrow(Module *M, uint64_t DeltaPages) {
+    auto Old = M->getMemory().grow(DeltaPages);
+    // The base never moves; only the bound needs refreshing.
+    StoreMemoryBound(M);
+    return Old;
+}
+
+uint64_t RefreshMemoryBound(Module *M) {
+    return StoreMemoryBound(M);
+}
+
+int32_t MemoryWait32(Module *M, uint64_t Addr, uint32_t Expected, int64_t Timeout) {
+    return atomics::Wait32(&M->getMemory(), Addr, Expected, Timeout);
+}
+
+int32_t MemoryWait64(Module *M, uint64_t Addr, uint64_t Expected, int64_t Timeout) {
+    return atomics::Wait64(&M->getMemory(), Addr, Expected, Timeout);
+}
+
+uint32_t MemoryNotify(Module *M, uint64_t Addr, uint32_t Count) {
+    return atomics::Notify(&M->getMemory(), Addr, Count);
+}
+
+Module::~Module() {
+    for (size_t i = 0; i < TableViews.size(); ++i)
+        Tables[i]->detach(&TableViews[i]);
+}
+
+uint64_t Module::runConstOps(const parser::module::Module &M, const parser::module::ConstExpr &Expr) const {
+    std::vector<uint64_t> Stack;
+    for (uint64_t i = Expr.Bits[0]; i < Expr.Bits[0] + Expr.Bits[1]; ++i) {
+        auto &Op = M.ConstOps[i];
+        if (Op.Kind == parser::module::ConstOpImm) {
+            Stack.push_back(Op.Arg);
+            continue;
+        }
+        if (Op.Kind == parser::module::ConstOpGlobal) {
+            Stack.push_back(Globals[Op.Arg].Bits[0]);
+            continue;
+        }
+        uint64_t R = Stack.back();
+        Stack.pop_back();
+        auto &L = Stack.back();
+        L = Op.Kind == parser::module::ConstOpAdd ? L + R : Op.Kind == parser::module::ConstOpSub ? L - R : L * R;
+    }
+    return Stack.back();
+}
+
+int64_t Module::growTable(TableIdx Idx, uint32_t Delta, Ref Init) {
+    return Tables[Idx]->grow(Delta, Init);
+}
+
+} // namespace runtime
+} // namespace wasmrt
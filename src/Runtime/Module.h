@@ -1,14 +1,138 @@
 #pragma once
 
+#include "Support/Result.h"
+
+#include "Epoch.h"
+#include "InstanceContext.h"
+#include "Memory.h"
+#include "Table.h"
+#include "Trap.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <vector>
+
 using namespace wasmrt;
 
 namespace wasmrt {
 namespace runtime {
 
+namespace wasi {
+class Context;
+} // namespace wasi
+
+// Instance view of a data or element segment; dropping it empties the view.
+struct DataSegment {
+    const uint8_t  *Bytes;
+    uint32_t       Size;
+};
+
+struct ElemSegment {
+    const FuncIdx  *Elems;
+    uint32_t       Size;
+};
+
+// 16 bytes so that v128 fits; scalars live in the low word.
+struct GlobalSlot {
+    uint64_t Bits[2];
+};
+
+class Module;
+
+// memory.grow on memory 0: the old size in pages, or -1.
+int64_t MemoryGrow(Module *M, uint64_t DeltaPages);
+
+// Slow path of a failed explicit bounds check. Memories never shrink, so a
+// stale MemBoundReg (after a callee or another thread grew the memory) can
+// only cause false failures: reload it from here and retry before trapping.
+uint64_t RefreshMemoryBound(Module *M);
+
+// memory.atomic.wait32/64 and notify on memory 0, see Atomics.h.
+int32_t MemoryWait32(Module *M, uint64_t Addr, uint32_t Expected, int64_t Timeout);
+int32_t MemoryWait64(Module *M, uint64_t Addr, uint64_t Expected, int64_t Timeout);
+uint32_t MemoryNotify(Module *M, uint64_t Addr, uint32_t Count);
+
+// Instrumentation chosen when an instance is created; it changes the code
+// the instance's functions are compiled to.
+struct InstanceOptions {
+    bool Metered{false};        // charge fuel per basic block and trap once it runs out, see setFuel
+    bool Interruptible{false};  // check the epoch at entries and loop headers, see setEpochDeadline
+};
+
+// What an instance takes from the instances it links against, in import
+// order per kind.
+struct InstanceImports {
+    std::vector<FuncEntry>               Funcs;     // the exporters' entries, or host ones (see HostThunk.h)
+    std::vector<GlobalSlot>              Globals;   // the values of the imported globals
+    std::vector<std::shared_ptr<Table>>  Tables;    // the exporters' tables, shared
+    std::vector<std::shared_ptr<Memory>> Memories;  // the exporters' memories, shared
+};
+
 class Module {
 public:
-    Module(parser::module::Module &M);
+    Module(parser::module::Module &M, const InstanceImports &Imports = {},
+           const InstanceOptions &Options = {});
+    ~Module();
+
+    inline Memory &getMemory(MemIdx Idx = 0) { return *Memories[Idx]; }
+
+    // Funcref of function Idx, NullRef for parser::module::NullElem.
+    inline Ref getFuncRef(FuncIdx Idx) {
+        return Idx == parser::module::NullElem ? NullRef : reinterpret_cast<Ref>(&FuncEntries[Idx]);
+    }
+
+    // Grows table Idx, refreshing the views of all instances using it.
+    // Returns the old size or -1.
+    int64_t growTable(TableIdx Idx, uint32_t Delta, Ref Init);
+
+    // Interrupts the instance once the global epoch advanced Delta ticks.
+    // Only interruptible instances check the deadline.
+    inline void setEpochDeadline(uint64_t Delta) {
+        EpochDelta = Delta;
+        Context.EpochDeadline = epoch::getCurrent() + Delta;
+    }
+
+    // Only consumed by metered instances, which start with none.
+    inline int64_t getFuel() const { return Context.Fuel; }
+    inline void setFuel(int64_t Fuel) { Context.Fuel = Fuel; }
+
+    // The value of an integer constant expression of M.
+    inline uint64_t getConst(const parser::module::Module &M, const parser::module::ConstExpr &Expr) const {
+        if (Expr.Kind == parser::module::ConstImm)
+            return Expr.Bits[0];
+        uint64_t Val = Expr.Kind == parser::module::ConstProgram ? runConstOps(M, Expr)
+                                                                 : Globals[Expr.Bits[0]].Bits[0] + Expr.Bits[1];
+        return Expr.Type == ValTypeI32 ? uint32_t(Val) : Val;
+    }
+
+    InstanceContext Context;
+    InstanceOptions Options;
+    std::vector<GlobalSlot> Globals;
+    std::vector<std::shared_ptr<Memory>> Memories;
+    std::vector<std::shared_ptr<Table>> Tables;
+    std::vector<TableView> TableViews;
+    std::vector<FuncEntry> FuncEntries;
+    uint32_t NumImportedFuncs{0};   // imports take the first function indices
+    std::vector<DataSegment> DataSegments;
+    std::vector<ElemSegment> ElemSegments;
+    uint64_t EpochDelta{0};
+    epoch::DeadlineAction EpochAction{epoch::DeadlineTrap};
+    wasi::Context *Wasi{nullptr};
+    // Keeps the code the FuncEntries point into alive, see CachedModule::Link.
+    std::shared_ptr<const void> CodeOwner;
+    // Set when applying a segment trapped; the instance must not be run.
+    std::optional<trap::TrapKind> InitTrap;
+    // Set when the instance could not be created at all: an import did not
+    // match, a memory could not be reserved or the code not be compiled. The
+    // instance must not be run either.
+    std::optional<support::result::Failure> InitFailure;
+
+private:
+    // Wraps like 64-bit arithmetic; getConst truncates i32 results.
+    uint64_t runConstOps(const parser::module::Module &M, const parser::module::ConstExpr &Expr) const;
 };
 
 } // namespace runtime
-} // namespace wasmrt
\ No newline at end of file
+} // namespace wasmrt
@@ -0,0 +1,25 @@
+#include "Table.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace wasmrt {
+namespace runtime {
+
+// Keyed by the value type bytes of params and results, like the reader's
+// canonical type indices. Instances intern only their canonical types, once
+// each, so the lock is not on any hot path.
+uint32_t getSignatureId(const FuncType &Type) {
+    static std::mutex Lock;
+    static std::unordered_map<std::string, uint32_t> Ids;
+
+    std::string Key(Type.ParamTypes.begin(), Type.ParamTypes.end());
+    Key.push_back(0);
+    Key.append(Type.ResultTypes.begin(), Type.ResultTypes.end());
+    std::lock_guard<std::mutex> Guard(Lock);
+    return Ids.emplace(std::move(Key), uint32_t(Ids.size())).first->second;
+}
+
+} // namespace runtime
+} // namespace wasmrt
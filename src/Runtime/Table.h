@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Parser/Type.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace runtime {
+
+class Module;
+struct InstanceContext;
+
+// A reference as held by tables, globals and the operand stack; 0 is null.
+// A funcref points to the function's FuncEntry, an externref is opaque.
+using Ref = uintptr_t;
+inline constexpr Ref NullRef = 0;
+
+// Everything call_indirect needs once it loaded the entry: the canonical
+// signature to check against, where to go and the context to enter it with.
+// One per function, owned by the instance; an imported function's is a copy
+// of the exporter's.
+struct FuncEntry {
+    uint32_t          TypeId;     // see getSignatureId
+    const void       *Code;
+    Module           *Instance;
+    InstanceContext  *Context;    // Instance's
+};
+
+// Process-wide id of Type's signature: equal signatures get the same id in
+// every module, so code compiled once can check entries of any instance,
+// including those reached through an imported table, against an immediate.
+uint32_t getSignatureId(const FuncType &Type);
+
+// What generated code reads for a table access: a bounds check against
+// Length and one load from Base. Every instance keeps the views of all its
+// tables next to each other; the table refreshes them when it grows.
+struct TableView {
+    Ref       *Base;
+    uint64_t   Length;
+};
+
+class Table {
+public:
+    Table(const TableType &Type)
+        : Elems(Type.Range.Min, NullRef),
+          Max(Type.Range.hasMax() ? Type.Range.Max : std::numeric_limits<uint32_t>::max()),
+          ElemType(Type.ElemType) {}
+
+    inline uint32_t getSize() const { return Elems.size(); }
+    inline TableView getView() { return {Elems.data(), Elems.size()}; }
+
+    // An imported table is shared with the exporting instance, so every
+    // instance using it registers its view until it goes away.
+    inline void attach(TableView *View) {
+        Views.push_back(View);
+        *View = getView();
+    }
+    inline void detach(TableView *View) {
+        Views.erase(std::find(Views.begin(), Views.end(), View));
+    }
+
+    // Returns the old size, or -1 if the table cannot grow by Delta.
+    inline int64_t grow(uint32_t Delta, Ref Init) {
+        uint64_t Old = Elems.size();
+        if (Old + Delta > Max)
+            return -1;
+        Elems.resize(Old + Delta, Init);
+        for (auto *View : Views)
+            *View = getView();
+        return Old;
+    }
+
+    std::vector<Ref>          Elems;
+    uint32_t                  Max;
+    ValType                   ElemType;
+    std::vector<TableView *>  Views;
+};
+
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,188 @@
+#include "ADT/CodeBuffer.h"
+#include "Support/Output.h"
+
+#include "Fiber.h"
+#include "Memory.h"
+#include "Trap.h"
+
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <iterator>
+#include <mutex>
+
+namespace wasmrt {
+namespace runtime {
+namespace trap {
+
+const char *getMessage(TrapKind Kind) {
+    switch (Kind) {
+        case TrapUnreachable:       return "unreachable executed";
+        case TrapIntDivByZero:      return "integer divide by zero";
+        case TrapIntOverflow:       return "integer overflow";
+        case TrapInvalidConversion: return "invalid conversion to integer";
+        case TrapOutOfBounds:       return "out of bounds memory access";
+        case TrapTableOutOfBounds:  return "out of bounds table access";
+        case TrapUnalignedAtomic:   return "unaligned atomic";
+        case TrapExpectedShared:    return "expected shared memory";
+        case TrapIndirectCallNull:  return "uninitialized element";
+        case TrapUndefinedElement:  return "undefined element";
+        case TrapSignatureMismatch: return "indirect call type mismatch";
+        case TrapStackOverflow:     return "call stack exhausted";
+        case TrapInterrupted:       return "interrupted";
+        case TrapOutOfFuel:         return "all fuel consumed";
+        case TrapHost:              return "host function trapped";
+        case TrapUnlinkedImport:    return "unlinked import called";
+    }
+    return "unknown trap";
+}
+
+static thread_local EntryFrame *ThreadFrames = nullptr;
+
+static EntryFrame *&getFrames() {
+    auto *F = fiber::getCurrent();
+    return F != nullptr ? F->TrapFrames : ThreadFrames;
+}
+
+// Faults on the stack guard are taken on this stack instead, as there is no
+// room left on the faulting one. Unmapped when the thread exits.
+struct SignalStack {
+    static constexpr size_t Size = 64 << 10;
+
+    SignalStack() {
+        void *Ptr = mmap(nullptr, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (Ptr == MAP_FAILED)
+            return;
+        stack_t SS{};
+        SS.ss_sp = Ptr;
+        SS.ss_size = Size;
+        if (sigaltstack(&SS, nullptr) == 0)
+            Base = Ptr;
+        else
+            munmap(Ptr, Size);
+    }
+
+    ~SignalStack() {
+        if (Base == nullptr)
+            return;
+        stack_t SS{};
+        SS.ss_flags = SS_DISABLE;
+        sigaltstack(&SS, nullptr);
+        munmap(Base, Size);
+    }
+
+    void *Base{nullptr};
+};
+
+static constexpr int Signals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE};
+static struct sigaction Previous[std::size(Signals)];
+
+// Faults this close to the stack pointer are taken as stack overflow.
+// Generated code probes frames larger than the guard page, so an overflow
+// always hits the guard first.
+static constexpr uintptr_t StackWindow = 64 << 10;
+
+static bool Classify(int Sig, const siginfo_t *Info, const ucontext_t *UC, TrapKind &Kind) {
+    auto &Regs = UC->uc_mcontext.gregs;
+    auto PC = reinterpret_cast<const void *>(Regs[REG_RIP]);
+    if (getFrames() == nullptr || !adt::code_buffer::isGeneratedCode(PC))
+        return false;
+
+    switch (Sig) {
+        case SIGILL:
+            // ud2 is only emitted for unreachable.
+            Kind = TrapUnreachable;
+            return true;
+        case SIGFPE:
+            // #DE is raised for INT_MIN / -1 as well, but div_s and rem_s
+            // handle a divisor of -1 before dividing.
+            Kind = TrapIntDivByZero;
+            return true;
+        default: {
+            auto Addr = reinterpret_cast<uintptr_t>(Info->si_addr);
+            auto SP = uintptr_t(Regs[REG_RSP]);
+            if (Addr + StackWindow >= SP && Addr < SP + StackWindow) {
+                Kind = TrapStackOverflow;
+                return true;
+            }
+            // Looked up rather than read through ContextReg: the faulting
+            // code may have been anywhere, and the handler must not fault
+            // itself on a stale register.
+            if (isReservedAddress(Info->si_addr)) {
+                Kind = TrapOutOfBounds;
+                return true;
+            }
+            return false;
+        }
+    }
+}
+
+static void Handler(int Sig, siginfo_t *Info, void *Context) {
+    auto *UC = static_cast<ucontext_t *>(Context);
+    TrapKind Kind;
+    if (Classify(Sig, Info, UC, Kind))
+        Raise(Kind, reinterpret_cast<const void *>(UC->uc_mcontext.gregs[REG_RIP]));
+
+    // Not a trap: hand the signal to whoever had it before.
+    for (size_t i = 0; i < std::size(Signals); ++i) {
+        if (Signals[i] != Sig)
+            continue;
+        auto &Prev = Previous[i];
+        if (Prev.sa_flags & SA_SIGINFO)
+            return Prev.sa_sigaction(Sig, Info, Context);
+        if (Prev.sa_handler != SIG_DFL && Prev.sa_handler != SIG_IGN)
+            return Prev.sa_handler(Sig);
+        // Returning re-executes the faulting instruction, which now ends the
+        // process the default way.
+        signal(Sig, SIG_DFL);
+    }
+}
+
+// SA_NODEFER as frames save no signal mask: after unwinding from the
+// handler the signal must not stay blocked.
+static void InstallHandlers() {
+    struct sigaction SA{};
+    SA.sa_sigaction = &Handler;
+    SA.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_NODEFER;
+    sigemptyset(&SA.sa_mask);
+    for (size_t i = 0; i < std::size(Signals); ++i)
+        sigaction(Signals[i], &SA, &Previous[i]);
+}
+
+void Enter(EntryFrame &F) {
+    static std::once_flag Installed;
+    std::call_once(Installed, InstallHandlers);
+    static thread_local SignalStack Stack;
+    (void)Stack;
+
+    auto &Top = getFrames();
+    F.Prev = Top;
+    Top = &F;
+}
+
+void Leave(EntryFrame &F) {
+    getFrames() = F.Prev;
+}
+
+void Raise(TrapKind Kind, const void *PC) {
+    auto &Top = getFrames();
+    auto *F = Top;
+    if (F == nullptr)
+        support::output::Error("trap::Raise", "%s outside of wasm\n", getMessage(Kind));
+    Top = F->Prev;
+    F->Caught = {Kind, PC};
+    siglongjmp(F->Env, 1);
+}
+
+void RaiseFromCode(uint64_t Kind) {
+    Raise(TrapKind(Kind), __builtin_return_address(0));
+}
+
+void RaiseUnlinkedImport() {
+    Raise(TrapUnlinkedImport, __builtin_return_address(0));
+}
+
+} // namespace trap
+} // namespace runtime
+} // namespace wasmrt
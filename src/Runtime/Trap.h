@@ -0,0 +1,83 @@
+#pragma once
+
+#include <csetjmp>
+#include <cstdint>
+#include <optional>
+
+namespace wasmrt {
+namespace runtime {
+namespace trap {
+
+enum TrapKind : uint8_t {
+    TrapUnreachable = 0,
+    TrapIntDivByZero,
+    TrapIntOverflow,
+    TrapInvalidConversion,
+    TrapOutOfBounds,
+    TrapTableOutOfBounds,
+    TrapUnalignedAtomic,
+    TrapExpectedShared,     // memory.atomic.wait on an unshared memory
+    TrapIndirectCallNull,
+    TrapUndefinedElement,   // call_indirect past the end of the table
+    TrapSignatureMismatch,
+    TrapStackOverflow,
+    TrapInterrupted,        // epoch deadline reached
+    TrapOutOfFuel,
+    TrapHost,               // raised by a host function
+    TrapUnlinkedImport      // called an import nothing was linked to
+};
+
+const char *getMessage(TrapKind Kind);
+
+struct Trap {
+    TrapKind     Kind;
+    const void  *PC;    // in generated code, if known
+};
+
+// Where traps unwind to: the host frame that called into wasm. Frames nest
+// when wasm calls a host function that calls back into wasm; each fiber
+// has its own chain, since a fiber may resume on another thread.
+struct EntryFrame {
+    sigjmp_buf   Env;
+    EntryFrame  *Prev;
+    Trap         Caught;
+};
+
+// Installs the signal handlers (once per process) and the thread's signal
+// stack (once per thread), and makes F the innermost frame.
+void Enter(EntryFrame &F);
+void Leave(EntryFrame &F);
+
+// Unwinds to the innermost entry frame. Nothing between it and the caller
+// gets to clean up, so only generated code and runtime calls that hold no
+// resources may be on the stack in between.
+[[noreturn]] void Raise(TrapKind Kind, const void *PC = nullptr);
+
+// Called by generated code for traps its own checks detect, with the code
+// address it was called from as the PC.
+[[noreturn]] void RaiseFromCode(uint64_t Kind);
+
+// Code of the imports an instance was created without. Called like any wasm
+// function, so it raises right away; the arguments are never looked at.
+[[noreturn]] void RaiseUnlinkedImport();
+
+// Runs Fn, returning the trap that ended it, if any. Entering costs one
+// sigsetjmp that saves no signal mask, i.e. a handful of register stores;
+// code that does not trap pays nothing else. Traps the hardware detects in
+// generated code (ud2, integer division faults, accesses to guard pages of
+// linear memory or the stack) are turned into Raise by the signal handler.
+template <typename Fn>
+std::optional<Trap> Call(Fn &&F) {
+    EntryFrame Frame;
+    Enter(Frame);
+    // Raise pops the frame before jumping back here.
+    if (sigsetjmp(Frame.Env, 0) != 0)
+        return Frame.Caught;
+    F();
+    Leave(Frame);
+    return std::nullopt;
+}
+
+} // namespace trap
+} // namespace runtime
+} // namespace wasmrt
@@ -0,0 +1,247 @@
+#include "WASI.h"
+
+#include <linux/openat2.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace wasmrt {
+namespace runtime {
+namespace wasi {
+
+// oflags
+inline constexpr int32_t OFlagCreat     = 1 << 0;
+inline constexpr int32_t OFlagDirectory = 1 << 1;
+inline constexpr int32_t OFlagExcl      = 1 << 2;
+inline constexpr int32_t OFlagTrunc     = 1 << 3;
+
+// fdflags
+inline constexpr int32_t FdFlagAppend   = 1 << 0;
+inline constexpr int32_t FdFlagDsync    = 1 << 1;
+inline constexpr int32_t FdFlagNonblock = 1 << 2;
+inline constexpr int32_t FdFlagSync     = 1 << 4;
+
+// rights
+inline constexpr int64_t RightFdRead    = 1 << 1;
+inline constexpr int64_t RightFdWrite   = 1 << 6;
+
+// lookupflags
+inline constexpr int32_t LookupSymlinkFollow = 1 << 0;
+
+Errno FromHostErrno(int Err) {
+    switch (Err) {
+        case 0:             return ErrnoSuccess;
+        case EACCES:        return ErrnoAcces;
+        case EAGAIN:        return ErrnoAgain;
+        case EBADF:         return ErrnoBadf;
+        case EEXIST:        return ErrnoExist;
+        case EFAULT:        return ErrnoFault;
+        case EINTR:         return ErrnoIntr;
+        case EINVAL:        return ErrnoInval;
+        case EISDIR:        return ErrnoIsdir;
+        case ELOOP:         return ErrnoLoop;
+        case ENAMETOOLONG:  return ErrnoNametoolong;
+        case ENOENT:        return ErrnoNoent;
+        case ENOMEM:        return ErrnoNomem;
+        case ENOSPC:        return ErrnoNospc;
+        case ENOSYS:        return ErrnoNosys;
+        case ENOTDIR:       return ErrnoNotdir;
+        case EPERM:         return ErrnoPerm;
+        case EPIPE:         return ErrnoPipe;
+        case ESPIPE:        return ErrnoSpipe;
+        case EXDEV:         return ErrnoNotcapable;
+        default:            return ErrnoIo;
+    }
+}
+
+Context::Context(io::IoBackend &IO) : IO(IO) {
+    for (int Fd = 0; Fd < 3; ++Fd)
+        Fds.push_back({Fd, {}});
+}
+
+Context::~Context() {
+    for (size_t Fd = 3; Fd < Fds.size(); ++Fd) {
+        if (Fds[Fd].HostFd >= 0)
+            close(Fds[Fd].HostFd);
+    }
+}
+
+int32_t Context::Insert(int HostFd) {
+    for (size_t Fd = 3; Fd < Fds.size(); ++Fd) {
+        if (Fds[Fd].HostFd < 0) {
+            Fds[Fd] = {HostFd, {}};
+            return Fd;
+        }
+    }
+    Fds.push_back({HostFd, {}});
+    return Fds.size() - 1;
+}
+
+int32_t Context::Preopen(const std::string &HostDir, const std::string &GuestPath) {
+    int HostFd = open(HostDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (HostFd < 0)
+        return -1;
+    auto Fd = Insert(HostFd);
+    Fds[Fd].PreopenPath = GuestPath;
+    Fds[Fd].Directory = true;
+    return Fd;
+}
+
+static inline Context *getContext(Module &M) { return M.Wasi; }
+
+// Memory 0, or null for a module without memory; callers fail with
+// ErrnoFault then, like for any other bad guest pointer.
+static inline Memory *getMemory(Module &M) {
+    return M.Memories.empty() ? nullptr : &M.getMemory();
+}
+
+template <bool Write>
+static int32_t DoIo(Module &M, int32_t Fd, int32_t Iovs, int32_t IovsLen, int64_t Offset, int32_t NOut) {
+    auto *Ctx = getContext(M);
+    auto *Entry = Ctx ? Ctx->getFd(Fd) : nullptr;
+    if (Entry == nullptr)
+        return ErrnoBadf;
+
+    auto *Mem = getMemory(M);
+    IoVecList List;
+    if (Mem == nullptr || !Mem->getIoVecs(Iovs, IovsLen, List) || !Mem->inBounds(uint32_t(NOut), sizeof(uint32_t)))
+        return ErrnoFault;
+    if (List.size() > IOV_MAX)
+        return ErrnoInval;
+
+    auto N = Write ? Ctx->IO.Writev(Entry->HostFd, List.data(), List.size(), Offset)
+                   : Ctx->IO.Readv(Entry->HostFd, List.data(), List.size(), Offset);
+    if (N < 0)
+        return FromHostErrno(-N);
+    Mem->store<uint32_t>(uint32_t(NOut), N);
+    return ErrnoSuccess;
+}
+
+static int32_t FdRead(Module &M, int32_t Fd, int32_t Iovs, int32_t IovsLen, int32_t NRead) {
+    return DoIo<false>(M, Fd, Iovs, IovsLen, -1, NRead);
+}
+
+static int32_t FdWrite(Module &M, int32_t Fd, int32_t Iovs, int32_t IovsLen, int32_t NWritten) {
+    return DoIo<true>(M, Fd, Iovs, IovsLen, -1, NWritten);
+}
+
+static int32_t FdPread(Module &M, int32_t Fd, int32_t Iovs, int32_t IovsLen, int64_t Offset, int32_t NRead) {
+    if (Offset < 0)
+        return ErrnoInval;
+    return DoIo<false>(M, Fd, Iovs, IovsLen, Offset, NRead);
+}
+
+static int32_t FdPwrite(Module &M, int32_t Fd, int32_t Iovs, int32_t IovsLen, int64_t Offset, int32_t NWritten) {
+    if (Offset < 0)
+        return ErrnoInval;
+    return DoIo<true>(M, Fd, Iovs, IovsLen, Offset, NWritten);
+}
+
+static int32_t PathOpen(Module &M, int32_t DirFd, int32_t DirFlags, int32_t Path, int32_t PathLen,
+                        int32_t OFlags, int64_t RightsBase, int64_t RightsInheriting,
+                        int32_t FdFlags, int32_t OpenedFd) {
+    auto *Ctx = getContext(M);
+    auto *Dir = Ctx ? Ctx->getFd(DirFd) : nullptr;
+    if (Dir == nullptr)
+        return ErrnoBadf;
+    // Only directories the guest was given, or opened beneath them, may
+    // anchor a lookup; any other host fd could be a way out.
+    if (!Dir->Directory)
+        return ErrnoNotdir;
+
+    auto *Mem = getMemory(M);
+    if (Mem == nullptr)
+        return ErrnoFault;
+    auto Name = Mem->getBytes(uint32_t(Path), uint32_t(PathLen));
+    if (!Name || !Mem->inBounds(uint32_t(OpenedFd), sizeof(uint32_t)))
+        return ErrnoFault;
+    std::string HostPath(reinterpret_cast<const char *>(Name.data()), Name.size());
+    if (HostPath.find('\0') != std::string::npos)
+        return ErrnoInval;
+
+    bool Read = RightsBase & RightFdRead, Write = RightsBase & RightFdWrite;
+    uint64_t Flags = O_CLOEXEC;
+    Flags |= Read && Write ? O_RDWR : Write ? O_WRONLY : O_RDONLY;
+    if (OFlags & OFlagCreat)     Flags |= O_CREAT;
+    if (OFlags & OFlagDirectory) Flags |= O_DIRECTORY;
+    if (OFlags & OFlagExcl)      Flags |= O_EXCL;
+    if (OFlags & OFlagTrunc)     Flags |= O_TRUNC;
+    if (FdFlags & FdFlagAppend)   Flags |= O_APPEND;
+    if (FdFlags & FdFlagDsync)    Flags |= O_DSYNC;
+    if (FdFlags & FdFlagNonblock) Flags |= O_NONBLOCK;
+    if (FdFlags & FdFlagSync)     Flags |= O_SYNC;
+    if (!(DirFlags & LookupSymlinkFollow))
+        Flags |= O_NOFOLLOW;
+
+    // RESOLVE_BENEATH keeps the guest inside the directory it was given,
+    // including through symlinks and "..".
+    struct open_how How = {};
+    How.flags = Flags;
+    if (Flags & O_CREAT)
+        How.mode = 0644;
+    How.resolve = RESOLVE_BENEATH;
+    int HostFd = syscall(SYS_openat2, Dir->HostFd, HostPath.c_str(), &How, sizeof(How));
+    if (HostFd < 0)
+        return FromHostErrno(errno);
+
+    struct stat St;
+    bool IsDir = fstat(HostFd, &St) == 0 && S_ISDIR(St.st_mode);
+    auto Fd = Ctx->Insert(HostFd);
+    Ctx->Fds[Fd].Directory = IsDir;
+    Mem->store<uint32_t>(uint32_t(OpenedFd), Fd);
+    return ErrnoSuccess;
+}
+
+static int32_t ClockTimeGet(Module &M, int32_t Id, int64_t Precision, int32_t Time) {
+    static const clockid_t Clocks[] = {
+        CLOCK_REALTIME, CLOCK_MONOTONIC, CLOCK_PROCESS_CPUTIME_ID, CLOCK_THREAD_CPUTIME_ID
+    };
+    if (Id < 0 || Id >= int32_t(sizeof(Clocks) / sizeof(Clocks[0])))
+        return ErrnoInval;
+
+    struct timespec TS;
+    if (clock_gettime(Clocks[Id], &TS) != 0)
+        return FromHostErrno(errno);
+    uint64_t Nanos = uint64_t(TS.tv_sec) * 1000000000ull + TS.tv_nsec;
+    auto *Mem = getMemory(M);
+    return Mem && Mem->store<uint64_t>(uint32_t(Time), Nanos) ? ErrnoSuccess : ErrnoFault;
+}
+
+static int32_t RandomGet(Module &M, int32_t Buf, int32_t BufLen) {
+    auto *Mem = getMemory(M);
+    if (Mem == nullptr)
+        return ErrnoFault;
+    auto Bytes = Mem->getBytes(uint32_t(Buf), uint32_t(BufLen));
+    if (!Bytes)
+        return ErrnoFault;
+    for (size_t Done = 0; Done < Bytes.size(); ) {
+        auto N = getrandom(Bytes.data() + Done, Bytes.size() - Done, 0);
+        if (N < 0) {
+            if (errno == EINTR)
+                continue;
+            return FromHostErrno(errno);
+        }
+        Done += N;
+    }
+    return ErrnoSuccess;
+}
+
+void Register(host::HostRegistry &R) {
+    R.Define<&FdRead>(ModuleName, "fd_read");
+    R.Define<&FdWrite>(ModuleName, "fd_write");
+    R.Define<&FdPread>(ModuleName, "fd_pread");
+    R.Define<&FdPwrite>(ModuleName, "fd_pwrite");
+    R.Define<&PathOpen>(ModuleName, "path_open");
+    R.Define<&ClockTimeGet>(ModuleName, "clock_time_get");
+    R.Define<&RandomGet>(ModuleName, "random_get");
+}
+
+} // namespace wasi
+} // namespace runtime
+} // namespace wasmrt
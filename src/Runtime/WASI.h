@@ -0,0 +1,78 @@
+#pragma once
+
+#include "HostFunction.h"
+#include "IoBackend.h"
+#include "Module.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace wasmrt;
+
+namespace wasmrt {
+namespace runtime {
+namespace wasi {
+
+inline constexpr const char *ModuleName = "wasi_snapshot_preview1";
+
+using Errno = uint16_t;
+
+inline constexpr Errno ErrnoSuccess = 0;
+inline constexpr Errno ErrnoAcces   = 2;
+inline constexpr Errno ErrnoAgain   = 6;
+inline constexpr Errno ErrnoBadf    = 8;
+inline constexpr Errno ErrnoExist   = 20;
+inline constexpr Errno ErrnoFault   = 21;
+inline constexpr Errno ErrnoIntr    = 27;
+inline constexpr Errno ErrnoInval   = 28;
+inline constexpr Errno ErrnoIo      = 29;
+inline constexpr Errno ErrnoIsdir   = 31;
+inline constexpr Errno ErrnoLoop    = 32;
+inline constexpr Errno ErrnoNametoolong = 37;
+inline constexpr Errno ErrnoNoent   = 44;
+inline constexpr Errno ErrnoNomem   = 48;
+inline constexpr Errno ErrnoNospc   = 51;
+inline constexpr Errno ErrnoNosys   = 52;
+inline constexpr Errno ErrnoNotdir  = 54;
+inline constexpr Errno ErrnoPerm    = 63;
+inline constexpr Errno ErrnoPipe    = 64;
+inline constexpr Errno ErrnoSpipe   = 70;
+inline constexpr Errno ErrnoNotcapable = 76;
+
+Errno FromHostErrno(int Err);
+
+struct FdEntry {
+    int          HostFd{-1};
+    std::string  PreopenPath;   // non-empty for preopened directories
+    bool         Directory{false};  // preopened, or opened beneath one
+};
+
+// Per instance WASI state: guest fd numbers index Fds directly.
+class Context {
+public:
+    Context(io::IoBackend &IO = io::getSyncBackend());
+    ~Context();
+
+    // Makes HostDir visible to the guest as GuestPath; returns the guest fd,
+    // or -1 if HostDir cannot be opened.
+    int32_t Preopen(const std::string &HostDir, const std::string &GuestPath);
+
+    inline FdEntry *getFd(int32_t Fd) {
+        if (Fd < 0 || size_t(Fd) >= Fds.size() || Fds[Fd].HostFd < 0)
+            return nullptr;
+        return &Fds[Fd];
+    }
+
+    int32_t Insert(int HostFd);
+
+    io::IoBackend         &IO;
+    std::vector<FdEntry>  Fds;
+};
+
+// Registers the supported preview1 imports under ModuleName.
+void Register(host::HostRegistry &R);
+
+} // namespace wasi
+} // namespace runtime
+} // namespace wasmrt
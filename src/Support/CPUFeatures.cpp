@@ -0,0 +1,42 @@
+#include "CPUFeatures.h"
+
+#include <cpuid.h>
+
+namespace wasmrt {
+namespace support {
+namespace cpu {
+
+static CPUFeatures Detect() {
+    CPUFeatures F;
+    unsigned EAX, EBX, ECX, EDX;
+    if (!__get_cpuid(1, &EAX, &EBX, &ECX, &EDX))
+        return F;
+    F.SSE41  = ECX & bit_SSE4_1;
+    F.SSE42  = ECX & bit_SSE4_2;
+    F.POPCNT = ECX & bit_POPCNT;
+
+    bool OSXSave = ECX & bit_OSXSAVE;
+    if (OSXSave && (ECX & bit_AVX)) {
+        unsigned XCR0Lo, XCR0Hi;
+        asm("xgetbv" : "=a"(XCR0Lo), "=d"(XCR0Hi) : "c"(0));
+        F.AVX = (XCR0Lo & 0x6) == 0x6;   // XMM and YMM state enabled
+    }
+
+    if (__get_cpuid_count(7, 0, &EAX, &EBX, &ECX, &EDX)) {
+        F.BMI1 = EBX & bit_BMI;
+        F.BMI2 = EBX & bit_BMI2;
+        F.AVX2 = F.AVX && (EBX & bit_AVX2);
+    }
+    if (__get_cpuid(0x80000001, &EAX, &EBX, &ECX, &EDX))
+        F.LZCNT = ECX & bit_LZCNT;
+    return F;
+}
+
+const CPUFeatures &getCPUFeatures() {
+    static const CPUFeatures Features = Detect();
+    return Features;
+}
+
+} // namespace cpu
+} // namespace support
+} // namespace wasmrt
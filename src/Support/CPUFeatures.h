@@ -0,0 +1,23 @@
+#pragma once
+
+namespace wasmrt {
+namespace support {
+namespace cpu {
+
+struct CPUFeatures {
+    bool SSE41{false};
+    bool SSE42{false};
+    bool POPCNT{false};
+    bool LZCNT{false};
+    bool BMI1{false};
+    bool BMI2{false};
+    bool AVX{false};    // only when the OS saves the YMM state
+    bool AVX2{false};
+};
+
+// Detected once on first use.
+const CPUFeatures &getCPUFeatures();
+
+} // namespace cpu
+} // namespace support
+} // namespace wasmrt
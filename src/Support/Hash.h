@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace wasmrt {
+namespace support {
+namespace hash {
+
+inline uint64_t Mix(uint64_t A, uint64_t B) {
+    __uint128_t P = static_cast<__uint128_t>(A) * B;
+    return uint64_t(P) ^ uint64_t(P >> 64);
+}
+
+// Fast non-cryptographic 64-bit hash, eight bytes per step. Callers that
+// must never confuse two inputs compare the bytes on a match.
+inline uint64_t Hash64(const void *Data, size_t Len, uint64_t Seed = 0) {
+    constexpr uint64_t K0 = 0x9E3779B97F4A7C15ull, K1 = 0xC2B2AE3D27D4EB4Full;
+    auto *P = static_cast<const uint8_t *>(Data);
+    uint64_t H = Seed ^ Mix(Len, K0);
+    for (; Len >= 8; P += 8, Len -= 8) {
+        uint64_t V;
+        memcpy(&V, P, 8);
+        H = Mix(H ^ V, K1);
+    }
+    uint64_t Tail = 0;
+    memcpy(&Tail, P, Len);
+    return Mix(Mix(H ^ Tail, K1), K0);
+}
+
+} // namespace hash
+} // namespace support
+} // namespace wasmrt
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <variant>
+
+namespace wasmrt {
+namespace support {
+namespace result {
+
+// Why loading or linking a module failed. Reported to the embedder instead of
+// ending the process, since one bad module must not take down a server
+// running many others.
+struct Failure {
+    const char   *Function;
+    std::string  Message;
+};
+
+template <typename... Types>
+Failure MakeFailure(const char *Function, const char *Format, Types... Args) {
+    char Buf[256];
+    snprintf(Buf, sizeof(Buf), Format, Args...);
+    return {Function, Buf};
+}
+
+// A value or the Failure that prevented it.
+template <typename T>
+class Result {
+public:
+    Result(T &&Val) : V(std::move(Val)) {}
+    Result(Failure &&F) : V(std::move(F)) {}
+
+    inline bool ok() const { return V.index() == 0; }
+    inline explicit operator bool() const { return ok(); }
+
+    inline T &operator*() { return std::get<0>(V); }
+    inline T *operator->() { return &std::get<0>(V); }
+    inline T take() { return std::move(std::get<0>(V)); }
+    inline const Failure &getFailure() const { return std::get<1>(V); }
+
+private:
+    std::variant<T, Failure> V;
+};
+
+} // namespace result
+} // namespace support
+} // namespace wasmrt
@@ -0,0 +1,247 @@
+#include "CPUFeatures.h"
+#include "Utf8.h"
+
+#include <immintrin.h>
+
+#include <cstring>
+
+namespace wasmrt {
+namespace support {
+namespace utf8 {
+
+bool IsUtf8Scalar(const uint8_t *Data, size_t Len) {
+    size_t i = 0;
+    while (i < Len) {
+        // Eight ASCII bytes at a time.
+        if (Len - i >= 8) {
+            uint64_t Word;
+            memcpy(&Word, Data + i, 8);
+            if ((Word & 0x8080808080808080ull) == 0) {
+                i += 8;
+                continue;
+            }
+        }
+
+        uint8_t Lead = Data[i];
+        if (Lead < 0x80) {
+            ++i;
+            continue;
+        }
+
+        uint32_t N, Min, CP;
+        if ((Lead & 0xE0) == 0xC0)
+            N = 1, Min = 0x80, CP = Lead & 0x1F;
+        else if ((Lead & 0xF0) == 0xE0)
+            N = 2, Min = 0x800, CP = Lead & 0x0F;
+        else if ((Lead & 0xF8) == 0xF0)
+            N = 3, Min = 0x10000, CP = Lead & 0x07;
+        else
+            return false;
+        if (Len - i - 1 < N)
+            return false;
+        for (uint32_t k = 1; k <= N; ++k) {
+            uint8_t Cont = Data[i + k];
+            if ((Cont & 0xC0) != 0x80)
+                return false;
+            CP = (CP << 6) | (Cont & 0x3F);
+        }
+        if (CP < Min || CP > 0x10FFFF || (CP >= 0xD800 && CP <= 0xDFFF))
+            return false;
+        i += N + 1;
+    }
+    return true;
+}
+
+// The vector validators classify every byte pair by three 16-entry tables,
+// indexed by the high and low nibble of the first byte and the high nibble of
+// the second: each entry is the set of errors the pair may be part of, and
+// a pair is malformed when all three agree on one. Third and fourth bytes of
+// a sequence are checked separately against the leads two and three bytes
+// back. Blocks without a high bit only have to check that the previous block
+// did not end inside a sequence. See Keiser and Lemire, "Validating UTF-8 In
+// Less Than One Instruction Per Byte".
+namespace {
+
+constexpr uint8_t TooShort     = 1 << 0;   // lead followed by a lead or ASCII
+constexpr uint8_t TooLong      = 1 << 1;   // ASCII followed by a continuation
+constexpr uint8_t Overlong3    = 1 << 2;
+constexpr uint8_t TooLarge     = 1 << 3;
+constexpr uint8_t Surrogate    = 1 << 4;
+constexpr uint8_t Overlong2    = 1 << 5;
+constexpr uint8_t TooLarge1000 = 1 << 6;
+constexpr uint8_t Overlong4    = 1 << 6;
+constexpr uint8_t TwoConts     = 1 << 7;   // continuation after a continuation
+constexpr uint8_t Carry        = TooShort | TooLong | TwoConts;
+
+alignas(16) constexpr uint8_t Byte1High[16] = {
+    TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+    TwoConts, TwoConts, TwoConts, TwoConts,
+    TooShort | Overlong2,
+    TooShort,
+    TooShort | Overlong3 | Surrogate,
+    TooShort | TooLarge | TooLarge1000 | Overlong4,
+};
+
+alignas(16) constexpr uint8_t Byte1Low[16] = {
+    Carry | Overlong3 | Overlong2 | Overlong4,
+    Carry | Overlong2,
+    Carry,
+    Carry,
+    Carry | TooLarge,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000 | Surrogate,
+    Carry | TooLarge | TooLarge1000,
+    Carry | TooLarge | TooLarge1000,
+};
+
+alignas(16) constexpr uint8_t Byte2High[16] = {
+    TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+    TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+    TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+    TooShort, TooShort, TooShort, TooShort,
+};
+
+// Largest bytes that may end a block without cutting a sequence short.
+alignas(16) constexpr uint8_t MaxTail[16] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF,
+};
+
+inline __m128i Load(const uint8_t *Table) {
+    return _mm_load_si128(reinterpret_cast<const __m128i *>(Table));
+}
+
+struct StateSSSE3 {
+    __m128i  Error;
+    __m128i  Prev;
+    __m128i  Incomplete;    // non-zero if Prev ends inside a sequence
+};
+
+__attribute__((target("ssse3")))
+inline void Step(StateSSSE3 &S, __m128i In) {
+    if (_mm_movemask_epi8(In) == 0) {
+        S.Error = _mm_or_si128(S.Error, S.Incomplete);
+        return;
+    }
+    auto Nibble = _mm_set1_epi8(0x0F);
+    auto Prev1 = _mm_alignr_epi8(In, S.Prev, 15);
+    auto Prev2 = _mm_alignr_epi8(In, S.Prev, 14);
+    auto Prev3 = _mm_alignr_epi8(In, S.Prev, 13);
+
+    auto B1H = _mm_shuffle_epi8(Load(Byte1High), _mm_and_si128(_mm_srli_epi16(Prev1, 4), Nibble));
+    auto B1L = _mm_shuffle_epi8(Load(Byte1Low), _mm_and_si128(Prev1, Nibble));
+    auto B2H = _mm_shuffle_epi8(Load(Byte2High), _mm_and_si128(_mm_srli_epi16(In, 4), Nibble));
+    auto Special = _mm_and_si128(_mm_and_si128(B1H, B1L), B2H);
+
+    // Bytes two and three after a 3- and 4-byte lead must be continuations,
+    // which Special flagged as TwoConts.
+    auto Third = _mm_subs_epu8(Prev2, _mm_set1_epi8(char(0xE0 - 0x80)));
+    auto Fourth = _mm_subs_epu8(Prev3, _mm_set1_epi8(char(0xF0 - 0x80)));
+    auto Must23 = _mm_and_si128(_mm_or_si128(Third, Fourth), _mm_set1_epi8(char(0x80)));
+    S.Error = _mm_or_si128(S.Error, _mm_xor_si128(Must23, Special));
+    S.Incomplete = _mm_subs_epu8(In, Load(MaxTail));
+    S.Prev = In;
+}
+
+__attribute__((target("ssse3")))
+bool IsUtf8SSSE3(const uint8_t *Data, size_t Len) {
+    StateSSSE3 S{_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+    size_t i = 0;
+    for (; i + 16 <= Len; i += 16)
+        Step(S, _mm_loadu_si128(reinterpret_cast<const __m128i *>(Data + i)));
+    // The tail, padded with ASCII, which also catches a sequence cut off by
+    // the end of the input.
+    alignas(16) uint8_t Tail[16] = {};
+    memcpy(Tail, Data + i, Len - i);
+    Step(S, Load(Tail));
+    auto Error = _mm_or_si128(S.Error, S.Incomplete);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(Error, _mm_setzero_si128())) == 0xFFFF;
+}
+
+// The same over 32-byte blocks. Shifting in the previous block's bytes
+// crosses the 128-bit lanes, hence the permute.
+struct StateAVX2 {
+    __m256i  Error;
+    __m256i  Prev;
+    __m256i  Incomplete;
+};
+
+__attribute__((target("avx2")))
+inline __m256i Broadcast(const uint8_t *Table) {
+    return _mm256_broadcastsi128_si256(Load(Table));
+}
+
+__attribute__((target("avx2")))
+inline void Step(StateAVX2 &S, __m256i In) {
+    if (_mm256_movemask_epi8(In) == 0) {
+        S.Error = _mm256_or_si256(S.Error, S.Incomplete);
+        return;
+    }
+    auto Nibble = _mm256_set1_epi8(0x0F);
+    auto Shifted = _mm256_permute2x128_si256(S.Prev, In, 0x21);
+    auto Prev1 = _mm256_alignr_epi8(In, Shifted, 15);
+    auto Prev2 = _mm256_alignr_epi8(In, Shifted, 14);
+    auto Prev3 = _mm256_alignr_epi8(In, Shifted, 13);
+
+    auto B1H = _mm256_shuffle_epi8(Broadcast(Byte1High), _mm256_and_si256(_mm256_srli_epi16(Prev1, 4), Nibble));
+    auto B1L = _mm256_shuffle_epi8(Broadcast(Byte1Low), _mm256_and_si256(Prev1, Nibble));
+    auto B2H = _mm256_shuffle_epi8(Broadcast(Byte2High), _mm256_and_si256(_mm256_srli_epi16(In, 4), Nibble));
+    auto Special = _mm256_and_si256(_mm256_and_si256(B1H, B1L), B2H);
+
+    auto Third = _mm256_subs_epu8(Prev2, _mm256_set1_epi8(char(0xE0 - 0x80)));
+    auto Fourth = _mm256_subs_epu8(Prev3, _mm256_set1_epi8(char(0xF0 - 0x80)));
+    auto Must23 = _mm256_and_si256(_mm256_or_si256(Third, Fourth), _mm256_set1_epi8(char(0x80)));
+    S.Error = _mm256_or_si256(S.Error, _mm256_xor_si256(Must23, Special));
+    // Only the upper lane ends the block.
+    auto Max = _mm256_inserti128_si256(_mm256_set1_epi8(char(0xFF)), Load(MaxTail), 1);
+    S.Incomplete = _mm256_subs_epu8(In, Max);
+    S.Prev = In;
+}
+
+__attribute__((target("avx2")))
+bool IsUtf8AVX2(const uint8_t *Data, size_t Len) {
+    StateAVX2 S{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+    size_t i = 0;
+    for (; i + 32 <= Len; i += 32)
+        Step(S, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(Data + i)));
+    alignas(32) uint8_t Tail[32] = {};
+    memcpy(Tail, Data + i, Len - i);
+    Step(S, _mm256_load_si256(reinterpret_cast<const __m256i *>(Tail)));
+    auto Error = _mm256_or_si256(S.Error, S.Incomplete);
+    return _mm256_testz_si256(Error, Error);
+}
+
+using Validator = bool (*)(const uint8_t *, size_t);
+
+Validator Select() {
+    auto &F = cpu::getCPUFeatures();
+    if (F.AVX2)
+        return &IsUtf8AVX2;
+    // SSSE3 is implied by SSE4.1, the only level the features record.
+    if (F.SSE41)
+        return &IsUtf8SSSE3;
+    return &IsUtf8Scalar;
+}
+
+} // namespace
+
+bool IsUtf8(const uint8_t *Data, size_t Len) {
+    static const Validator Impl = Select();
+    // Most names are a handful of ASCII bytes; not worth a vector pass.
+    if (Len < 16)
+        return IsUtf8Scalar(Data, Len);
+    return Impl(Data, Len);
+}
+
+} // namespace utf8
+} // namespace support
+} // namespace wasmrt
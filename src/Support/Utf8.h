@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace wasmrt {
+namespace support {
+namespace utf8 {
+
+// Whether Data holds well-formed UTF-8: no overlong forms, surrogates or code
+// points past U+10FFFF, and no sequence cut off at the end. Picks an AVX2,
+// SSSE3 or scalar implementation once, from the CPU features.
+bool IsUtf8(const uint8_t *Data, size_t Len);
+
+// The scalar implementation, also used for inputs too short to vectorize.
+bool IsUtf8Scalar(const uint8_t *Data, size_t Len);
+
+} // namespace utf8
+} // namespace support
+} // namespace wasmrt
@@ -1,13 +0,0 @@
-#include "Assember.h"
-
-using namespace wasmrt;
-using namespace wasmrt::adt;
-
-namespace wasmrt {
-namespace target {
-namespace x86_64 {
-
-
-} // namespace x86_64
-} // namespace target
-} // namespace wasmrt
\ No newline at end of file
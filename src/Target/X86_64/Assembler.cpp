@@ -0,0 +1,612 @@
+#include "Support/Output.h"
+
+#include "Assembler.h"
+
+#include <cstring>
+
+using namespace wasmrt;
+using namespace wasmrt::adt;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+namespace {
+
+inline bool isInt8(int64_t V) { return V >= INT8_MIN && V <= INT8_MAX; }
+inline bool isInt32(int64_t V) { return V >= INT32_MIN && V <= INT32_MAX; }
+inline bool isByteReg(uint8_t Reg) { return Reg >= RSP && Reg <= RDI; }  // spl..dil need a REX
+
+inline uint8_t getScaleBits(uint8_t Scale) {
+    return Scale == 8 ? 3 : Scale == 4 ? 2 : Scale == 2 ? 1 : 0;
+}
+
+// The recommended multi-byte NOPs, by length.
+const uint8_t Nops[9][9] = {
+    {0x90},
+    {0x66, 0x90},
+    {0x0F, 0x1F, 0x00},
+    {0x0F, 0x1F, 0x40, 0x00},
+    {0x0F, 0x1F, 0x44, 0x00, 0x00},
+    {0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00},
+    {0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00},
+    {0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00},
+};
+
+} // namespace
+
+Assembler::Assembler(code_buffer::CodeBuffer &CB, size_t InitSize) : CB(CB) {
+    Bytes.reserve(InitSize);
+    Items.reserve(InitSize / 8);
+    Labels.reserve(InitSize / 16);
+}
+
+void Assembler::Reset() {
+    Bytes.clear();
+    Items.clear();
+    Labels.clear();
+    Relocs.clear();
+}
+
+void Assembler::Imm16(uint16_t V) {
+    Byte(V);
+    Byte(V >> 8);
+}
+
+void Assembler::Imm32(uint32_t V) {
+    for (int I = 0; I < 4; ++I)
+        Byte(V >> (I * 8));
+}
+
+void Assembler::Imm64(uint64_t V) {
+    for (int I = 0; I < 8; ++I)
+        Byte(V >> (I * 8));
+}
+
+// Labels and layout
+
+Label Assembler::NewLabel() {
+    Labels.push_back(UINT32_MAX);
+    return {uint32_t(Labels.size() - 1)};
+}
+
+void Assembler::Bind(Label L) {
+    Labels[L.Id] = Items.size();
+    Items.push_back({uint32_t(Bytes.size()), L.Id, ItemBind, CondO, false, 0});
+}
+
+void Assembler::Jmp(Label L) {
+    Items.push_back({uint32_t(Bytes.size()), L.Id, ItemJmp, CondO, false, 0});
+}
+
+void Assembler::Jcc(Cond C, Label L) {
+    Items.push_back({uint32_t(Bytes.size()), L.Id, ItemJcc, C, false, 0});
+}
+
+void Assembler::CallFunc(uint32_t Callee) {
+    Items.push_back({uint32_t(Bytes.size()), Callee, ItemCall, CondO, true, 0});
+}
+
+void Assembler::JmpFunc(uint32_t Callee) {
+    Items.push_back({uint32_t(Bytes.size()), Callee, ItemJmpFunc, CondO, true, 0});
+}
+
+void Assembler::Align(uint8_t Boundary) {
+    Items.push_back({uint32_t(Bytes.size()), Boundary, ItemAlign, CondO, false, 0});
+}
+
+void Assembler::WriteNops(uint8_t *Out, uint32_t Size) {
+    while (Size != 0) {
+        uint32_t N = Size < 9 ? Size : 9;
+        memcpy(Out, Nops[N - 1], N);
+        Out += N;
+        Size -= N;
+    }
+}
+
+void Assembler::Nop(uint32_t Size) {
+    Bytes.resize(Bytes.size() + Size);
+    WriteNops(Bytes.data() + Bytes.size() - Size, Size);
+}
+
+uint32_t Assembler::getItemSize(const Item &I) const {
+    switch (I.Kind) {
+        case ItemJmp: return I.Long ? 5 : 2;
+        case ItemJcc: return I.Long ? 6 : 2;
+        case ItemAlign: return -I.Addr & (I.Arg - 1);
+        case ItemCall:
+        case ItemJmpFunc: return 5;
+        default: return 0;
+    }
+}
+
+uint32_t Assembler::Layout() {
+    for (;;) {
+        uint32_t Addr = 0, Prev = 0;
+        for (auto &I : Items) {
+            Addr += I.Pos - Prev;
+            Prev = I.Pos;
+            I.Addr = Addr;
+            Addr += getItemSize(I);
+        }
+        bool Changed = false;
+        for (auto &I : Items) {
+            if ((I.Kind != ItemJmp && I.Kind != ItemJcc) || I.Long)
+                continue;
+            int64_t Disp = int64_t(Items[Labels[I.Arg]].Addr) - (I.Addr + 2);
+            if (!isInt8(Disp))
+                I.Long = Changed = true;
+        }
+        if (!Changed)
+            return Addr + (Bytes.size() - Prev);
+    }
+}
+
+code_buffer::CodeBlob Assembler::Finalize() {
+    for (auto &I : Items) {
+        if ((I.Kind == ItemJmp || I.Kind == ItemJcc) && Labels[I.Arg] == UINT32_MAX)
+            support::output::Error("Assembler::Finalize", "jump to unbound label %u\n", I.Arg);
+    }
+    auto Blob = CB.Allocate(Layout());
+    Relocs.clear();
+    if (Blob.Address == nullptr)
+        return Blob;
+
+    uint8_t *Out = Blob.Address;
+    uint32_t Prev = 0;
+    for (auto &I : Items) {
+        memcpy(Out, Bytes.data() + Prev, I.Pos - Prev);
+        Out += I.Pos - Prev;
+        Prev = I.Pos;
+        uint32_t Target = I.Kind == ItemJmp || I.Kind == ItemJcc ? Items[Labels[I.Arg]].Addr : 0;
+        switch (I.Kind) {
+            case ItemJmp:
+                if (I.Long) {
+                    int32_t Disp = Target - (I.Addr + 5);
+                    *Out++ = 0xE9;
+                    memcpy(Out, &Disp, 4);
+                    Out += 4;
+                } else {
+                    *Out++ = 0xEB;
+                    *Out++ = uint8_t(Target - (I.Addr + 2));
+                }
+                break;
+            case ItemJcc:
+                if (I.Long) {
+                    int32_t Disp = Target - (I.Addr + 6);
+                    *Out++ = 0x0F;
+                    *Out++ = 0x80 + I.CC;
+                    memcpy(Out, &Disp, 4);
+                    Out += 4;
+                } else {
+                    *Out++ = 0x70 + I.CC;
+                    *Out++ = uint8_t(Target - (I.Addr + 2));
+                }
+                break;
+            case ItemAlign:
+                WriteNops(Out, getItemSize(I));
+                Out += getItemSize(I);
+                break;
+            case ItemCall:
+            case ItemJmpFunc:
+                *Out++ = I.Kind == ItemCall ? 0xE8 : 0xE9;
+                Relocs.push_back({I.Addr + 1, I.Arg});
+                memset(Out, 0, 4);
+                Out += 4;
+                break;
+            default:
+                break;
+        }
+    }
+    memcpy(Out, Bytes.data() + Prev, Bytes.size() - Prev);
+    return Blob;
+}
+
+// Encoding
+
+void Assembler::Rex(bool W, uint8_t Reg, uint8_t Index, uint8_t Base, bool ByteRegs) {
+    uint8_t R = 0x40 | (W << 3) | ((Reg >> 3) << 2) | ((Index >> 3) << 1) | (Base >> 3);
+    if (R != 0x40 || ByteRegs)
+        Byte(R);
+}
+
+void Assembler::Rex(bool W, uint8_t Reg, const Mem &M, bool ByteRegs) {
+    Rex(W, Reg, M.HasIndex ? M.Index : 0, M.Base, ByteRegs);
+}
+
+void Assembler::ModRM(uint8_t Reg, uint8_t Rm) {
+    Byte(0xC0 | ((Reg & 7) << 3) | (Rm & 7));
+}
+
+void Assembler::ModRM(uint8_t Reg, const Mem &M) {
+    uint8_t Base = M.Base & 7;
+    // rbp/r13 as base have no disp-less form.
+    uint8_t Mod = (M.Disp == 0 && Base != RBP) ? 0x00 : isInt8(M.Disp) ? 0x40 : 0x80;
+    if (M.HasIndex || Base == RSP) {
+        Byte(Mod | ((Reg & 7) << 3) | 0x4);
+        Byte((getScaleBits(M.Scale) << 6) | ((M.HasIndex ? M.Index & 7 : 0x4) << 3) | Base);
+    } else {
+        Byte(Mod | ((Reg & 7) << 3) | Base);
+    }
+    if (Mod == 0x40)
+        Byte(M.Disp);
+    else if (Mod == 0x80)
+        Imm32(M.Disp);
+}
+
+void Assembler::EmitOp(Width W, uint8_t Opcode8, uint8_t Opcode, uint8_t Reg, GPR Rm, bool RegIsGPR) {
+    if (W == W16)
+        Byte(0x66);
+    Rex(W == W64, Reg, 0, Rm, W == W8 && (isByteReg(Rm) || (RegIsGPR && isByteReg(Reg))));
+    Byte(W == W8 ? Opcode8 : Opcode);
+    ModRM(Reg, Rm);
+}
+
+void Assembler::EmitOp(Width W, uint8_t Opcode8, uint8_t Opcode, uint8_t Reg, const Mem &M, bool RegIsGPR) {
+    if (W == W16)
+        Byte(0x66);
+    Rex(W == W64, Reg, M, W == W8 && RegIsGPR && isByteReg(Reg));
+    Byte(W == W8 ? Opcode8 : Opcode);
+    ModRM(Reg, M);
+}
+
+void Assembler::EmitOp0F(Width W, uint8_t Prefix, uint8_t Opcode, uint8_t Reg, GPR Rm, bool ByteRegs) {
+    if (W == W16)
+        Byte(0x66);
+    if (Prefix != 0)
+        Byte(Prefix);
+    Rex(W == W64, Reg, 0, Rm, ByteRegs);
+    Byte(0x0F);
+    Byte(Opcode);
+    ModRM(Reg, Rm);
+}
+
+void Assembler::EmitOp0F(Width W, uint8_t Prefix, uint8_t Opcode, uint8_t Reg, const Mem &M, bool ByteRegs) {
+    if (W == W16)
+        Byte(0x66);
+    if (Prefix != 0)
+        Byte(Prefix);
+    Rex(W == W64, Reg, M, ByteRegs);
+    Byte(0x0F);
+    Byte(Opcode);
+    ModRM(Reg, M);
+}
+
+// Moves
+
+void Assembler::Mov(Width W, GPR Dst, GPR Src) { EmitOp(W, 0x88, 0x89, Src, Dst); }
+void Assembler::Mov(Width W, GPR Dst, const Mem &Src) { EmitOp(W, 0x8A, 0x8B, Dst, Src); }
+void Assembler::Mov(Width W, const Mem &Dst, GPR Src) { EmitOp(W, 0x88, 0x89, Src, Dst); }
+
+void Assembler::Mov(Width W, const Mem &Dst, int32_t Imm) {
+    EmitOp(W, 0xC6, 0xC7, 0, Dst, false);
+    if (W == W8)
+        Byte(Imm);
+    else if (W == W16)
+        Imm16(Imm);
+    else
+        Imm32(Imm);
+}
+
+void Assembler::Mov(GPR Dst, uint64_t Imm) {
+    if (Imm <= UINT32_MAX) {
+        // Writing the 32-bit register zero extends.
+        Rex(false, 0, 0, Dst);
+        Byte(0xB8 + (Dst & 7));
+        Imm32(Imm);
+    } else if (isInt32(int64_t(Imm))) {
+        EmitOp(W64, 0xC6, 0xC7, 0, Dst, false);
+        Imm32(Imm);
+    } else {
+        Rex(true, 0, 0, Dst);
+        Byte(0xB8 + (Dst & 7));
+        Imm64(Imm);
+    }
+}
+
+void Assembler::Movzx(Width DstW, Width SrcW, GPR Dst, GPR Src) {
+    if (SrcW == W32)
+        return Mov(W32, Dst, Src);
+    EmitOp0F(DstW, 0, SrcW == W8 ? 0xB6 : 0xB7, Dst, Src, SrcW == W8 && isByteReg(Src));
+}
+
+void Assembler::Movzx(Width DstW, Width SrcW, GPR Dst, const Mem &Src) {
+    if (SrcW == W32)
+        return Mov(W32, Dst, Src);
+    EmitOp0F(DstW, 0, SrcW == W8 ? 0xB6 : 0xB7, Dst, Src);
+}
+
+void Assembler::Movsx(Width DstW, Width SrcW, GPR Dst, GPR Src) {
+    if (SrcW == W32)
+        return EmitOp(W64, 0x63, 0x63, Dst, Src);
+    EmitOp0F(DstW, 0, SrcW == W8 ? 0xBE : 0xBF, Dst, Src, SrcW == W8 && isByteReg(Src));
+}
+
+void Assembler::Movsx(Width DstW, Width SrcW, GPR Dst, const Mem &Src) {
+    if (SrcW == W32)
+        return EmitOp(W64, 0x63, 0x63, Dst, Src);
+    EmitOp0F(DstW, 0, SrcW == W8 ? 0xBE : 0xBF, Dst, Src);
+}
+
+void Assembler::Lea(Width W, GPR Dst, const Mem &Src) { EmitOp(W, 0x8D, 0x8D, Dst, Src); }
+
+void Assembler::Xchg(Width W, GPR Dst, GPR Src) {
+    // 0x90 + r, except for eax itself: 0x90 is nop and would not zero extend.
+    if (W != W8 && (Dst == RAX) != (Src == RAX)) {
+        GPR Other = Dst == RAX ? Src : Dst;
+        if (W == W16)
+            Byte(0x66);
+        Rex(W == W64, 0, 0, Other);
+        Byte(0x90 + (Other & 7));
+        return;
+    }
+    EmitOp(W, 0x86, 0x87, Src, Dst);
+}
+
+void Assembler::Cmov(Width W, Cond C, GPR Dst, GPR Src) { EmitOp0F(W, 0, 0x40 + C, Dst, Src); }
+void Assembler::Setcc(Cond C, GPR Dst) { EmitOp0F(W32, 0, 0x90 + C, 0, Dst, isByteReg(Dst)); }
+void Assembler::Zero(GPR Dst) { EmitOp(W32, 0x30, 0x31, Dst, Dst); }
+
+// Integer arithmetic
+
+void Assembler::Alu(AluOp Op, Width W, GPR Dst, GPR Src) { EmitOp(W, Op * 8, Op * 8 + 1, Src, Dst); }
+void Assembler::Alu(AluOp Op, Width W, GPR Dst, const Mem &Src) { EmitOp(W, Op * 8 + 2, Op * 8 + 3, Dst, Src); }
+void Assembler::Alu(AluOp Op, Width W, const Mem &Dst, GPR Src) { EmitOp(W, Op * 8, Op * 8 + 1, Src, Dst); }
+
+void Assembler::Alu(AluOp Op, Width W, GPR Dst, int32_t Imm) {
+    if (W != W8 && isInt8(Imm)) {
+        EmitOp(W, 0x83, 0x83, Op, Dst, false);
+        Byte(Imm);
+        return;
+    }
+    if (Dst == RAX) {
+        if (W == W16)
+            Byte(0x66);
+        Rex(W == W64, 0, 0, 0);
+        Byte(Op * 8 + (W == W8 ? 4 : 5));
+    } else {
+        EmitOp(W, 0x80, 0x81, Op, Dst, false);
+    }
+    if (W == W8)
+        Byte(Imm);
+    else if (W == W16)
+        Imm16(Imm);
+    else
+        Imm32(Imm);
+}
+
+void Assembler::Alu(AluOp Op, Width W, const Mem &Dst, int32_t Imm) {
+    if (W != W8 && isInt8(Imm)) {
+        EmitOp(W, 0x83, 0x83, Op, Dst, false);
+        Byte(Imm);
+        return;
+    }
+    EmitOp(W, 0x80, 0x81, Op, Dst, false);
+    if (W == W8)
+        Byte(Imm);
+    else if (W == W16)
+        Imm16(Imm);
+    else
+        Imm32(Imm);
+}
+
+void Assembler::Test(Width W, GPR Dst, GPR Src) { EmitOp(W, 0x84, 0x85, Src, Dst); }
+
+void Assembler::Test(Width W, GPR Dst, int32_t Imm) {
+    if (Dst == RAX) {
+        if (W == W16)
+            Byte(0x66);
+        Rex(W == W64, 0, 0, 0);
+        Byte(W == W8 ? 0xA8 : 0xA9);
+    } else {
+        EmitOp(W, 0xF6, 0xF7, 0, Dst, false);
+    }
+    if (W == W8)
+        Byte(Imm);
+    else if (W == W16)
+        Imm16(Imm);
+    else
+        Imm32(Imm);
+}
+
+void Assembler::Shift(ShiftOp Op, Width W, GPR Dst, uint8_t Imm) {
+    if (Imm == 1)
+        return EmitOp(W, 0xD0, 0xD1, Op, Dst, false);
+    EmitOp(W, 0xC0, 0xC1, Op, Dst, false);
+    Byte(Imm);
+}
+
+void Assembler::ShiftCL(ShiftOp Op, Width W, GPR Dst) { EmitOp(W, 0xD2, 0xD3, Op, Dst, false); }
+void Assembler::Imul(Width W, GPR Dst, GPR Src) { EmitOp0F(W, 0, 0xAF, Dst, Src); }
+
+void Assembler::Imul(Width W, GPR Dst, GPR Src, int32_t Imm) {
+    if (isInt8(Imm)) {
+        EmitOp(W, 0x6B, 0x6B, Dst, Src);
+        Byte(Imm);
+        return;
+    }
+    EmitOp(W, 0x69, 0x69, Dst, Src);
+    if (W == W16)
+        Imm16(Imm);
+    else
+        Imm32(Imm);
+}
+
+void Assembler::Not(Width W, GPR Dst) { EmitOp(W, 0xF6, 0xF7, 2, Dst, false); }
+void Assembler::Neg(Width W, GPR Dst) { EmitOp(W, 0xF6, 0xF7, 3, Dst, false); }
+void Assembler::Div(Width W, GPR Src) { EmitOp(W, 0xF6, 0xF7, 6, Src, false); }
+void Assembler::Idiv(Width W, GPR Src) { EmitOp(W, 0xF6, 0xF7, 7, Src, false); }
+
+void Assembler::Cdq(Width W) {
+    if (W == W64)
+        Byte(0x48);
+    Byte(0x99);
+}
+
+void Assembler::Lzcnt(Width W, GPR Dst, GPR Src) { EmitOp0F(W, 0xF3, 0xBD, Dst, Src); }
+void Assembler::Tzcnt(Width W, GPR Dst, GPR Src) { EmitOp0F(W, 0xF3, 0xBC, Dst, Src); }
+void Assembler::Popcnt(Width W, GPR Dst, GPR Src) { EmitOp0F(W, 0xF3, 0xB8, Dst, Src); }
+
+// Atomics
+
+void Assembler::Lock() { Byte(0xF0); }
+
+void Assembler::Xadd(Width W, const Mem &Dst, GPR Src) {
+    EmitOp0F(W, 0, W == W8 ? 0xC0 : 0xC1, Src, Dst, W == W8 && isByteReg(Src));
+}
+
+void Assembler::Cmpxchg(Width W, const Mem &Dst, GPR Src) {
+    EmitOp0F(W, 0, W == W8 ? 0xB0 : 0xB1, Src, Dst, W == W8 && isByteReg(Src));
+}
+
+// Locked implicitly.
+void Assembler::Xchg(Width W, const Mem &Dst, GPR Src) { EmitOp(W, 0x86, 0x87, Src, Dst); }
+
+void Assembler::Mfence() {
+    Byte(0x0F);
+    Byte(0xAE);
+    Byte(0xF0);
+}
+
+// Control flow and stack
+
+void Assembler::Push(GPR Src) {
+    Rex(false, 0, 0, Src);
+    Byte(0x50 + (Src & 7));
+}
+
+void Assembler::Pop(GPR Dst) {
+    Rex(false, 0, 0, Dst);
+    Byte(0x58 + (Dst & 7));
+}
+
+void Assembler::Push(int32_t Imm) {
+    if (isInt8(Imm)) {
+        Byte(0x6A);
+        Byte(Imm);
+    } else {
+        Byte(0x68);
+        Imm32(Imm);
+    }
+}
+
+// Near calls and jumps are 64-bit without REX.W.
+void Assembler::Call(GPR Target) { EmitOp(W32, 0xFF, 0xFF, 2, Target, false); }
+void Assembler::Call(const Mem &Target) { EmitOp(W32, 0xFF, 0xFF, 2, Target, false); }
+void Assembler::Jmp(GPR Target) { EmitOp(W32, 0xFF, 0xFF, 4, Target, false); }
+void Assembler::Jmp(const Mem &Target) { EmitOp(W32, 0xFF, 0xFF, 4, Target, false); }
+
+void Assembler::Ret(uint16_t PopBytes) {
+    if (PopBytes == 0)
+        return Byte(0xC3);
+    Byte(0xC2);
+    Imm16(PopBytes);
+}
+
+void Assembler::Ud2() {
+    Byte(0x0F);
+    Byte(0x0B);
+}
+
+// SSE and AVX
+
+void Assembler::ImmOpt(int16_t Imm) {
+    if (Imm >= 0)
+        Byte(Imm);
+}
+
+void Assembler::SsePrefix(SimdPrefix P, bool W, uint8_t Reg, uint8_t Index, uint8_t Base,
+                          OpcodeMap Map, uint8_t Opcode) {
+    static const uint8_t Prefixes[] = {0x00, 0x66, 0xF3, 0xF2};
+    if (P != PrefixNone)
+        Byte(Prefixes[P]);
+    Rex(W, Reg, Index, Base);
+    Byte(0x0F);
+    if (Map == Map0F38)
+        Byte(0x38);
+    else if (Map == Map0F3A)
+        Byte(0x3A);
+    Byte(Opcode);
+}
+
+void Assembler::Sse(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src, int16_t Imm, bool W) {
+    SseReg(P, Map, Opcode, Dst, Src, Imm, W);
+}
+
+void Assembler::SseReg(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, uint8_t Reg, uint8_t Rm, int16_t Imm, bool W) {
+    SsePrefix(P, W, Reg, 0, Rm, Map, Opcode);
+    ModRM(Reg, Rm);
+    ImmOpt(Imm);
+}
+
+void Assembler::Sse(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, const Mem &Src, int16_t Imm, bool W) {
+    SsePrefix(P, W, Dst, Src.HasIndex ? Src.Index : 0, Src.Base, Map, Opcode);
+    ModRM(Dst, Src);
+    ImmOpt(Imm);
+}
+
+// R, X, B and vvvv are stored inverted.
+void Assembler::VexPrefix(SimdPrefix P, OpcodeMap Map, bool W, bool L256, uint8_t Reg, uint8_t Vvvv,
+                          uint8_t Index, uint8_t Base) {
+    uint8_t Tail = ((~Vvvv & 0xF) << 3) | (L256 << 2) | P;
+    if (Map == Map0F && !W && (Index >> 3) == 0 && (Base >> 3) == 0) {
+        Byte(0xC5);
+        Byte((((~Reg >> 3) & 1) << 7) | Tail);
+        return;
+    }
+    Byte(0xC4);
+    Byte((((~Reg >> 3) & 1) << 7) | (((~Index >> 3) & 1) << 6) | (((~Base >> 3) & 1) << 5) | Map);
+    Byte((W << 7) | Tail);
+}
+
+void Assembler::Vex(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src1, XMM Src2,
+                    int16_t Imm, bool W, bool L256) {
+    VexPrefix(P, Map, W, L256, Dst, Src1, 0, Src2);
+    Byte(Opcode);
+    ModRM(Dst, Src2);
+    ImmOpt(Imm);
+}
+
+void Assembler::Vex(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src1, const Mem &Src2,
+                    int16_t Imm, bool W, bool L256) {
+    VexPrefix(P, Map, W, L256, Dst, Src1, Src2.HasIndex ? Src2.Index : 0, Src2.Base);
+    Byte(Opcode);
+    ModRM(Dst, Src2);
+    ImmOpt(Imm);
+}
+
+// With SSE the destination doubles as the first x86 source, so it may alias
+// that operand but not the second one.
+void Assembler::Simd(const SimdEncoding &E, XMM Dst, XMM Lhs, XMM Rhs, bool UseAVX) {
+    if (E.Unary) {
+        if (UseAVX)
+            return Vex(E.Prefix, E.Map, E.Opcode, Dst, XMM0, Lhs, E.Imm);
+        return Sse(E.Prefix, E.Map, E.Opcode, Dst, Lhs, E.Imm);
+    }
+    XMM First = E.Swap ? Rhs : Lhs, Second = E.Swap ? Lhs : Rhs;
+    if (UseAVX)
+        return Vex(E.Prefix, E.Map, E.Opcode, Dst, First, Second, E.Imm);
+    if (Dst != First) {
+        if (Dst == Second)
+            support::output::Error("Assembler::Simd", "destination aliases the second source\n");
+        Movaps(Dst, First);
+    }
+    Sse(E.Prefix, E.Map, E.Opcode, Dst, Second, E.Imm);
+}
+
+void Assembler::Movd(XMM Dst, GPR Src) { SseReg(Prefix66, Map0F, 0x6E, Dst, Src); }
+void Assembler::Movd(GPR Dst, XMM Src) { SseReg(Prefix66, Map0F, 0x7E, Src, Dst); }
+void Assembler::Movq(XMM Dst, GPR Src) { SseReg(Prefix66, Map0F, 0x6E, Dst, Src, -1, true); }
+void Assembler::Movq(GPR Dst, XMM Src) { SseReg(Prefix66, Map0F, 0x7E, Src, Dst, -1, true); }
+void Assembler::Movss(XMM Dst, const Mem &Src) { Sse(PrefixF3, Map0F, 0x10, Dst, Src); }
+void Assembler::Movss(const Mem &Dst, XMM Src) { Sse(PrefixF3, Map0F, 0x11, Src, Dst); }
+void Assembler::Movsd(XMM Dst, const Mem &Src) { Sse(PrefixF2, Map0F, 0x10, Dst, Src); }
+void Assembler::Movsd(const Mem &Dst, XMM Src) { Sse(PrefixF2, Map0F, 0x11, Src, Dst); }
+void Assembler::Movaps(XMM Dst, XMM Src) { Sse(PrefixNone, Map0F, 0x28, Dst, Src); }
+void Assembler::Movdqu(XMM Dst, const Mem &Src) { Sse(PrefixF3, Map0F, 0x6F, Dst, Src); }
+void Assembler::Movdqu(const Mem &Dst, XMM Src) { Sse(PrefixF3, Map0F, 0x7F, Src, Dst); }
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
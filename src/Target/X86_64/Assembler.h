@@ -2,6 +2,11 @@
 
 #include "ADT/CodeBuffer.h"
 
+#include "Registers.h"
+
+#include <cstdint>
+#include <vector>
+
 using namespace wasmrt;
 using namespace wasmrt::adt;
 
@@ -9,20 +14,223 @@ namespace wasmrt {
 namespace target {
 namespace x86_64 {
 
+// Values match the VEX pp and mmmmm fields, so one encoding serves both the
+// legacy SSE form and the 3-operand AVX one.
+enum SimdPrefix : uint8_t { PrefixNone = 0, Prefix66 = 1, PrefixF3 = 2, PrefixF2 = 3 };
+enum OpcodeMap  : uint8_t { Map0F = 1, Map0F38 = 2, Map0F3A = 3 };
+
+// An xmm instruction computing Dst = Lhs op Rhs, or op Lhs; the wasm SIMD
+// ops are lowered to these by a table (SimdLowering.h).
+struct SimdEncoding {
+    SimdPrefix  Prefix;
+    OpcodeMap   Map;
+    uint8_t     Opcode;
+    int16_t     Imm;     // imm8 operand, -1 if none
+    bool        Unary;
+    bool        Swap;    // the operand order is the reverse of x86's
+};
+
+// Operand size of integer instructions, in bytes.
+enum Width : uint8_t { W8 = 1, W16 = 2, W32 = 4, W64 = 8 };
+
+// Condition codes, in tttn encoding order.
+enum Cond : uint8_t {
+    CondO = 0, CondNO, CondB, CondAE, CondE, CondNE, CondBE, CondA,
+    CondS, CondNS, CondP, CondNP, CondL, CondGE, CondLE, CondG
+};
+
+inline Cond Invert(Cond C) { return Cond(C ^ 1); }
+
+// Reg field of the group 1 (0x80-0x83) and shift (0xC1/0xD1/0xD3) opcodes.
+enum AluOp : uint8_t { AluAdd = 0, AluOr, AluAdc, AluSbb, AluAnd, AluSub, AluXor, AluCmp };
+enum ShiftOp : uint8_t { ShiftRol = 0, ShiftRor, ShiftRcl, ShiftRcr, ShiftShl, ShiftShr, ShiftSal, ShiftSar };
+
+// [Base + Index * Scale + Disp].
+struct Mem {
+    Mem(GPR Base, int32_t Disp = 0)
+        : Base(Base), Index(RSP), Scale(1), Disp(Disp), HasIndex(false) {}
+    Mem(GPR Base, GPR Index, uint8_t Scale, int32_t Disp = 0)
+        : Base(Base), Index(Index), Scale(Scale), Disp(Disp), HasIndex(true) {}
+
+    GPR      Base;
+    GPR      Index;    // never RSP, which encodes "no index"
+    uint8_t  Scale;    // 1, 2, 4 or 8
+    int32_t  Disp;
+    bool     HasIndex;
+};
+
+struct Label {
+    uint32_t Id;
+};
+
+// A direct call or tail jump to another wasm function, patched once every
+// function of the module has an address: rel32 at Offset into the blob.
+struct CallReloc {
+    uint32_t  Offset;
+    uint32_t  Callee;
+};
+
+// x86-64 encoder. Instructions always get their shortest encoding: REX only
+// when an operand needs it, 2-byte VEX where the 3-byte form is not needed,
+// disp8 and imm8 whenever the value fits.
+//
+// Code is built in a scratch stream, with jumps to labels and alignment
+// padding kept aside as items. Finalize() lays them out, starting every
+// jump short and growing the ones whose target ends up out of rel8 range
+// until nothing changes (growing is the only way a jump changes, so this
+// terminates), and copies the result into a blob. The stream and the item
+// lists keep their capacity across Reset(), so once an assembler has seen a
+// function of a given size, emitting code allocates nothing.
 class Assembler {
 public:
-    Assembler(code_buffer::CodeBuffer &CB, size_t InitSize)
-        : Blob(CB.Allocate(InitSize)) {}
+    Assembler(code_buffer::CodeBuffer &CB, size_t InitSize);
+
+    // Lays out the code and copies it into a newly allocated blob, or returns
+    // one without an Address when the code buffer has no room for it.
+    code_buffer::CodeBlob Finalize();
+    // Starts the next function, keeping the buffers' capacity.
+    void Reset();
+
+    inline size_t getSize() const { return Bytes.size(); }
+    // Call sites emitted with CallFunc, valid after Finalize().
+    inline const std::vector<CallReloc> &getRelocs() const { return Relocs; }
+
+    // Labels.
+    Label NewLabel();
+    void Bind(Label L);
+    void Jmp(Label L);
+    void Jcc(Cond C, Label L);
+    // Pads with multi-byte NOPs up to a multiple of Boundary (a power of two
+    // up to 64, the alignment of blobs), for loop heads.
+    void Align(uint8_t Boundary);
+    void Nop(uint32_t Size);
+
+    // Moves.
+    void Mov(Width W, GPR Dst, GPR Src);
+    void Mov(Width W, GPR Dst, const Mem &Src);
+    void Mov(Width W, const Mem &Dst, GPR Src);
+    void Mov(Width W, const Mem &Dst, int32_t Imm);
+    void Mov(GPR Dst, uint64_t Imm);          // picks mov r32, mov r/m64 imm32 or movabs
+    void Movzx(Width DstW, Width SrcW, GPR Dst, GPR Src);
+    void Movzx(Width DstW, Width SrcW, GPR Dst, const Mem &Src);
+    void Movsx(Width DstW, Width SrcW, GPR Dst, GPR Src);
+    void Movsx(Width DstW, Width SrcW, GPR Dst, const Mem &Src);
+    void Lea(Width W, GPR Dst, const Mem &Src);
+    void Xchg(Width W, GPR Dst, GPR Src);
+    void Cmov(Width W, Cond C, GPR Dst, GPR Src);
+    void Setcc(Cond C, GPR Dst);
+    void Zero(GPR Dst);                       // xor r32, r32; clobbers flags
+
+    // Integer arithmetic.
+    void Alu(AluOp Op, Width W, GPR Dst, GPR Src);
+    void Alu(AluOp Op, Width W, GPR Dst, const Mem &Src);
+    void Alu(AluOp Op, Width W, const Mem &Dst, GPR Src);
+    void Alu(AluOp Op, Width W, GPR Dst, int32_t Imm);
+    void Alu(AluOp Op, Width W, const Mem &Dst, int32_t Imm);
+    void Test(Width W, GPR Dst, GPR Src);
+    void Test(Width W, GPR Dst, int32_t Imm);
+    void Shift(ShiftOp Op, Width W, GPR Dst, uint8_t Imm);
+    void ShiftCL(ShiftOp Op, Width W, GPR Dst);
+    void Imul(Width W, GPR Dst, GPR Src);
+    void Imul(Width W, GPR Dst, GPR Src, int32_t Imm);
+    void Not(Width W, GPR Dst);
+    void Neg(Width W, GPR Dst);
+    void Div(Width W, GPR Src);               // rdx:rax / src
+    void Idiv(Width W, GPR Src);
+    void Cdq(Width W);                        // cdq / cqo
+    void Lzcnt(Width W, GPR Dst, GPR Src);
+    void Tzcnt(Width W, GPR Dst, GPR Src);
+    void Popcnt(Width W, GPR Dst, GPR Src);
+
+    // Atomics. Lock prefixes the next instruction.
+    void Lock();
+    void Xadd(Width W, const Mem &Dst, GPR Src);
+    void Cmpxchg(Width W, const Mem &Dst, GPR Src);
+    void Xchg(Width W, const Mem &Dst, GPR Src);
+    void Mfence();
+
+    // Control flow and stack.
+    void Push(GPR Src);
+    void Pop(GPR Dst);
+    void Push(int32_t Imm);
+    void CallFunc(uint32_t Callee);           // call rel32, see CallReloc
+    void JmpFunc(uint32_t Callee);            // jmp rel32, for return_call
+    void Call(GPR Target);
+    void Call(const Mem &Target);
+    void Jmp(GPR Target);
+    void Jmp(const Mem &Target);
+    void Ret(uint16_t PopBytes = 0);
+    void Ud2();
+
+    // SSE, legacy encoded. Dst is also the first source.
+    void Sse(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src, int16_t Imm = -1, bool W = false);
+    void Sse(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, const Mem &Src, int16_t Imm = -1, bool W = false);
+    // Register-direct form for ops mixing GPRs and XMMs (movd, pextr, cvt).
+    void SseReg(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, uint8_t Reg, uint8_t Rm, int16_t Imm = -1, bool W = false);
+    // AVX, VEX encoded with the non-destructive first source in vvvv.
+    void Vex(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src1, XMM Src2,
+             int16_t Imm = -1, bool W = false, bool L256 = false);
+    void Vex(SimdPrefix P, OpcodeMap Map, uint8_t Opcode, XMM Dst, XMM Src1, const Mem &Src2,
+             int16_t Imm = -1, bool W = false, bool L256 = false);
+    // Dst = Lhs op Rhs (Rhs ignored for unary ops).
+    void Simd(const SimdEncoding &E, XMM Dst, XMM Lhs, XMM Rhs, bool UseAVX);
+
+    void Movd(XMM Dst, GPR Src);
+    void Movd(GPR Dst, XMM Src);
+    void Movq(XMM Dst, GPR Src);
+    void Movq(GPR Dst, XMM Src);
+    void Movss(XMM Dst, const Mem &Src);
+    void Movss(const Mem &Dst, XMM Src);
+    void Movsd(XMM Dst, const Mem &Src);
+    void Movsd(const Mem &Dst, XMM Src);
+    void Movaps(XMM Dst, XMM Src);
+    void Movdqu(XMM Dst, const Mem &Src);
+    void Movdqu(const Mem &Dst, XMM Src);
+
+private:
+    enum ItemKind : uint8_t { ItemBind, ItemJmp, ItemJcc, ItemAlign, ItemCall, ItemJmpFunc };
+
+    // Placed before the stream byte at Pos.
+    struct Item {
+        uint32_t  Pos;
+        uint32_t  Arg;      // label of jumps and binds, boundary of aligns, callee of calls and tail jumps
+        ItemKind  Kind;
+        Cond      CC;
+        bool      Long;
+        uint32_t  Addr;     // final address, set by layout
+    };
 
-    inline code_buffer::CodeBlob Expand() {
-        return CB.Expand(Blob)
-    }
+    inline void Byte(uint8_t B) { Bytes.push_back(B); }
+    void Imm16(uint16_t V);
+    void Imm32(uint32_t V);
+    void Imm64(uint64_t V);
+    void Rex(bool W, uint8_t Reg, uint8_t Index, uint8_t Base, bool ByteRegs = false);
+    void Rex(bool W, uint8_t Reg, const Mem &M, bool ByteRegs = false);
+    void ModRM(uint8_t Reg, uint8_t Rm);
+    void ModRM(uint8_t Reg, const Mem &M);
+    // One-byte opcode map; Opcode8 is the byte-sized variant. RegIsGPR is
+    // false when Reg is an opcode extension (/n).
+    void EmitOp(Width W, uint8_t Opcode8, uint8_t Opcode, uint8_t Reg, GPR Rm, bool RegIsGPR = true);
+    void EmitOp(Width W, uint8_t Opcode8, uint8_t Opcode, uint8_t Reg, const Mem &M, bool RegIsGPR = true);
+    // Two-byte opcode map, after an optional mandatory prefix.
+    void EmitOp0F(Width W, uint8_t Prefix, uint8_t Opcode, uint8_t Reg, GPR Rm, bool ByteRegs = false);
+    void EmitOp0F(Width W, uint8_t Prefix, uint8_t Opcode, uint8_t Reg, const Mem &M, bool ByteRegs = false);
+    static void WriteNops(uint8_t *Out, uint32_t Size);
+    void SsePrefix(SimdPrefix P, bool W, uint8_t Reg, uint8_t Index, uint8_t Base, OpcodeMap Map, uint8_t Opcode);
+    void VexPrefix(SimdPrefix P, OpcodeMap Map, bool W, bool L256, uint8_t Reg, uint8_t Vvvv,
+                   uint8_t Index, uint8_t Base);
+    void ImmOpt(int16_t Imm);
+    uint32_t getItemSize(const Item &I) const;
+    // Final addresses of all items; returns the code size.
+    uint32_t Layout();
 
-    size_t Idx{0};
     code_buffer::CodeBuffer &CB;
-    code_buffer::CodeBlob Blob;
+    std::vector<uint8_t>    Bytes;
+    std::vector<Item>       Items;
+    std::vector<uint32_t>   Labels;     // item index of each label's bind
+    std::vector<CallReloc>  Relocs;
 };
 
 } // namespace x86_64
 } // namespace target
-} // namespace wasmrt
\ No newline at end of file
+} // namespace wasmrt
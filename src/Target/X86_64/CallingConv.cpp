@@ -0,0 +1,38 @@
+#include "CallingConv.h"
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+template <size_t NG, size_t NX>
+static uint32_t Assign(const std::vector<ValType> &Types, const GPR (&GPRs)[NG],
+                       const XMM (&XMMs)[NX], std::vector<ValueLoc> &Locs) {
+    size_t G = 0, X = 0;
+    uint32_t Offset = 0;
+    Locs.reserve(Types.size());
+    for (auto Type : Types) {
+        bool Vec = isFloatOrVector(Type);
+        if (Vec && X < NX) {
+            Locs.push_back({true, XMMs[X++], 0});
+        } else if (!Vec && G < NG) {
+            Locs.push_back({true, GPRs[G++], 0});
+        } else {
+            uint32_t Size = Type == ValTypeV128 ? 16 : 8;
+            Offset = (Offset + Size - 1) & ~(Size - 1);
+            Locs.push_back({false, 0, Offset});
+            Offset += Size;
+        }
+    }
+    return (Offset + 15) & ~15u;
+}
+
+CallSignature getCallSignature(const FuncType &Type) {
+    CallSignature Sig;
+    Sig.StackParamSize = Assign(Type.ParamTypes, ParamGPRs, ParamXMMs, Sig.Params);
+    Sig.StackResultSize = Assign(Type.ResultTypes, ResultGPRs, ResultXMMs, Sig.Results);
+    return Sig;
+}
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,69 @@
+#pragma once
+
+#include "Parser/Type.h"
+
+#include "Registers.h"
+
+#include <cstdint>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Convention for calls between wasm functions. Parameters follow SysV: up to
+// six integers in GPRs and eight floats/vectors in XMMs. Results come back in
+// registers too, up to four integers and four floats/vectors, so returning a
+// small tuple costs no memory traffic. The rest go to a result area the
+// caller reserves right above its outgoing stack parameters.
+//
+// Unlike SysV, the callee pops its stack parameters (ret imm16). That is what
+// makes return_call run in constant stack: the tail callee's arguments are
+// written over the caller's incoming ones, whatever their size, the return
+// address is moved down to sit right below them and the callee is entered
+// with a jmp. The result area does not move, since validation guarantees
+// that caller and callee return the same types. A tail call into another
+// instance is made as a plain call instead, since its callee would return
+// with the wrong context loaded.
+//
+// ContextReg, MemBaseReg and MemBoundReg hold the callee instance's values on
+// entry. Calls within an instance leave them alone; a call through a
+// FuncEntry, which may be another instance's, loads them from the entry's
+// Context first and the caller reloads its own once the call returns. Host
+// code enters wasm through an entry stub (EntryStub.h), which loads all three.
+struct ValueLoc {
+    bool      InReg;
+    uint8_t   Reg;      // GPR for i32/i64, XMM for f32/f64/v128
+    uint32_t  Offset;   // from the start of the stack parameter or result area
+};
+
+struct CallSignature {
+    std::vector<ValueLoc>  Params;
+    std::vector<ValueLoc>  Results;
+    uint32_t               StackParamSize{0};
+    uint32_t               StackResultSize{0};
+};
+
+inline constexpr GPR ParamGPRs[] = {RDI, RSI, RDX, RCX, R8, R9};
+inline constexpr XMM ParamXMMs[] = {XMM0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7};
+inline constexpr GPR ResultGPRs[] = {RAX, RDX, RCX, R8};
+inline constexpr XMM ResultXMMs[] = {XMM0, XMM1, XMM2, XMM3};
+
+inline bool isFloatOrVector(ValType Type) {
+    return Type == ValTypeF32 || Type == ValTypeF64 || Type == ValTypeV128;
+}
+
+CallSignature getCallSignature(const FuncType &Type);
+
+// How far a return_call moves the return address towards higher addresses;
+// negative when the callee takes more stack parameters than the caller.
+inline int32_t getTailCallShift(const CallSignature &Caller, const CallSignature &Callee) {
+    return int32_t(Caller.StackParamSize) - int32_t(Callee.StackParamSize);
+}
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
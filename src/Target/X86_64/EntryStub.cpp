@@ -0,0 +1,129 @@
+#include "Assembler.h"
+#include "CallingConv.h"
+#include "EntryStub.h"
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Offset of each value in the slot array.
+static std::vector<int32_t> getSlotOffsets(const std::vector<ValType> &Types) {
+    std::vector<int32_t> Offsets;
+    int32_t Offset = 0;
+    for (auto Type : Types) {
+        Offsets.push_back(Offset);
+        Offset += Type == ValTypeV128 ? 16 : 8;
+    }
+    return Offsets;
+}
+
+// Slots only hold what the value needs, so scalars move 8 bytes at a time.
+static void Load(Assembler &ASM, ValType Type, const ValueLoc &Loc, const Mem &Src) {
+    if (!Loc.InReg)
+        return;
+    if (Type == ValTypeV128)
+        ASM.Movdqu(XMM(Loc.Reg), Src);
+    else if (isFloatOrVector(Type))
+        ASM.Movsd(XMM(Loc.Reg), Src);
+    else
+        ASM.Mov(W64, GPR(Loc.Reg), Src);
+}
+
+// r11 and xmm15 carry neither arguments nor results.
+static void Copy(Assembler &ASM, ValType Type, const Mem &Dst, const Mem &Src) {
+    if (Type == ValTypeV128) {
+        ASM.Movdqu(XMM15, Src);
+        ASM.Movdqu(Dst, XMM15);
+    } else {
+        ASM.Mov(W64, R11, Src);
+        ASM.Mov(W64, Dst, R11);
+    }
+}
+
+static void Store(Assembler &ASM, ValType Type, const ValueLoc &Loc, const Mem &Dst) {
+    if (Type == ValTypeV128)
+        ASM.Movdqu(Dst, XMM(Loc.Reg));
+    else if (isFloatOrVector(Type))
+        ASM.Movsd(Dst, XMM(Loc.Reg));
+    else
+        ASM.Mov(W64, Dst, GPR(Loc.Reg));
+}
+
+// rbx keeps Slots and r12 the code across the call; together with r13-r15
+// and rbp they are what the stub saves for the host. Six pushes after the
+// return address leave rsp 8 off alignment, which the outgoing area makes up.
+static code_buffer::CodeBlob Generate(code_buffer::CodeBuffer &CB, const FuncType &Type) {
+    static constexpr GPR Saved[] = {RBX, R12, R13, R14, R15};
+    auto CS = getCallSignature(Type);
+    auto ParamOffsets = getSlotOffsets(Type.ParamTypes);
+    auto ResultOffsets = getSlotOffsets(Type.ResultTypes);
+    int32_t Area = CS.StackParamSize + CS.StackResultSize + 8;
+
+    Assembler ASM(CB, 1024);
+    ASM.Push(RBP);
+    ASM.Mov(W64, RBP, RSP);
+    for (auto Reg : Saved)
+        ASM.Push(Reg);
+    ASM.Alu(AluSub, W64, RSP, Area);
+    ASM.Mov(W64, RBX, RDX);
+    ASM.Mov(W64, R12, RSI);
+    ASM.Mov(W64, ContextReg, RDI);
+    ASM.Mov(W64, MemBaseReg, Mem(ContextReg, offsetof(runtime::InstanceContext, MemBase)));
+    ASM.Mov(W64, MemBoundReg, Mem(ContextReg, offsetof(runtime::InstanceContext, MemBound)));
+
+    auto &Params = Type.ParamTypes;
+    for (size_t i = 0; i < Params.size(); ++i) {
+        if (!CS.Params[i].InReg)
+            Copy(ASM, Params[i], Mem(RSP, CS.Params[i].Offset), Mem(RBX, ParamOffsets[i]));
+    }
+    for (size_t i = 0; i < Params.size(); ++i)
+        Load(ASM, Params[i], CS.Params[i], Mem(RBX, ParamOffsets[i]));
+    ASM.Call(R12);
+
+    // The callee popped its stack parameters, so the result area is at rsp.
+    auto &Results = Type.ResultTypes;
+    for (size_t i = 0; i < Results.size(); ++i) {
+        if (!CS.Results[i].InReg)
+            Copy(ASM, Results[i], Mem(RBX, ResultOffsets[i]), Mem(RSP, CS.Results[i].Offset));
+    }
+    for (size_t i = 0; i < Results.size(); ++i) {
+        if (CS.Results[i].InReg)
+            Store(ASM, Results[i], CS.Results[i], Mem(RBX, ResultOffsets[i]));
+    }
+
+    ASM.Lea(W64, RSP, Mem(RBP, -8 * int32_t(std::size(Saved))));
+    for (size_t i = std::size(Saved); i-- > 0;)
+        ASM.Pop(Saved[i]);
+    ASM.Pop(RBP);
+    ASM.Ret();
+    return ASM.Finalize();
+}
+
+EntryStub getEntryStub(const FuncType &Type) {
+    static std::mutex Lock;
+    static code_buffer::CodeBuffer CB;
+    static std::unordered_map<std::string, EntryStub> Stubs;
+
+    std::string Key(Type.ParamTypes.begin(), Type.ParamTypes.end());
+    Key.push_back(0);
+    Key.append(Type.ResultTypes.begin(), Type.ResultTypes.end());
+    std::lock_guard<std::mutex> Guard(Lock);
+    auto &Stub = Stubs[Key];
+    if (Stub == nullptr)
+        Stub = reinterpret_cast<EntryStub>(const_cast<uint8_t *>(Generate(CB, Type).Entry));
+    return Stub;
+}
+
+std::optional<runtime::trap::Trap> Invoke(const runtime::FuncEntry &Entry, const FuncType &Type, uint64_t *Slots) {
+    auto Stub = getEntryStub(Type);
+    return runtime::trap::Call([&] { Stub(Entry.Context, Entry.Code, Slots); });
+}
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Parser/Type.h"
+#include "Runtime/InstanceContext.h"
+#include "Runtime/Trap.h"
+
+#include <cstdint>
+#include <optional>
+
+using namespace wasmrt;
+using namespace wasmrt::parser::type;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Host-to-wasm transition for one signature, called with the SysV ABI. It
+// saves the host's callee-saved registers, loads ContextReg, MemBaseReg and
+// MemBoundReg from Ctx, moves the arguments from Slots to where the wasm
+// convention wants them, calls Code and stores the results back into Slots
+// from the first one on. Slots are 64 bits wide, v128 takes two, and the
+// caller reserves room for whichever of params and results needs more.
+using EntryStub = void (*)(runtime::InstanceContext *Ctx, const void *Code, uint64_t *Slots);
+
+// Generated on the first request for a signature and kept for the process.
+EntryStub getEntryStub(const FuncType &Type);
+
+// Runs Entry's function with the arguments in Slots, leaving the results
+// there, and returns the trap that ended it, if any.
+std::optional<runtime::trap::Trap> Invoke(const runtime::FuncEntry &Entry, const FuncType &Type, uint64_t *Slots);
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,111 @@
+#include "Assembler.h"
+#include "CallingConv.h"
+#include "HostThunk.h"
+
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// SysV assigns registers and stack slots the way the wasm convention does,
+// so the host's locations are those of a wasm signature with the leading
+// pointers added: every integer argument moves up by as many registers, and
+// those pushed out of R9 go to the stack in front of the ones already there.
+// Floats keep their registers. Host functions take no v128, so every value
+// is 8 bytes wide.
+static code_buffer::CodeBlob Generate(code_buffer::CodeBuffer &CB, const runtime::host::HostFunction &HF) {
+    auto &Params = HF.Type.ParamTypes;
+    auto &Results = HF.Type.ResultTypes;
+    bool Multi = Results.size() > 1;
+    std::vector<ValType> HostParams(Multi ? 2 : 1, ValTypeI64);
+    HostParams.insert(HostParams.end(), Params.begin(), Params.end());
+    size_t Shift = HostParams.size() - Params.size();
+    auto CS = getCallSignature(HF.Type);
+    auto HS = getCallSignature(FuncType(FtTag, std::move(HostParams), std::vector<ValType>{}));
+    // Below the outgoing stack arguments, the slots a multi-result adapter
+    // stores to. rsp is aligned after the push of rbp and stays so.
+    int32_t Buffer = Multi ? (8 * Results.size() + 15) & ~15 : 0;
+    int32_t Frame = HS.StackParamSize + Buffer;
+
+    Assembler ASM(CB, 512);
+    ASM.Push(RBP);
+    ASM.Mov(W64, RBP, RSP);
+    if (Frame != 0)
+        ASM.Alu(AluSub, W64, RSP, Frame);
+
+    // Stack arguments first, while the registers still hold the wasm ones.
+    for (size_t i = 0; i < Params.size(); ++i) {
+        auto &From = CS.Params[i];
+        auto &To = HS.Params[i + Shift];
+        if (To.InReg)
+            continue;
+        Mem Dst(RSP, To.Offset);
+        if (!From.InReg) {
+            ASM.Mov(W64, R11, Mem(RBP, 16 + From.Offset));
+            ASM.Mov(W64, Dst, R11);
+        } else if (isFloatOrVector(Params[i])) {
+            ASM.Movsd(Dst, XMM(From.Reg));
+        } else {
+            ASM.Mov(W64, Dst, GPR(From.Reg));
+        }
+    }
+    // An integer that stays in a register moves to a higher one, so going
+    // down from the last never overwrites one still to be moved.
+    for (size_t i = Params.size(); i-- > 0;) {
+        if (HS.Params[i + Shift].InReg && !isFloatOrVector(Params[i]))
+            ASM.Mov(W64, GPR(HS.Params[i + Shift].Reg), GPR(CS.Params[i].Reg));
+    }
+    if (Multi)
+        ASM.Lea(W64, RSI, Mem(RSP, HS.StackParamSize));
+    ASM.Mov(W64, RDI, Mem(ContextReg, offsetof(runtime::InstanceContext, Instance)));
+    ASM.Mov(RAX, uint64_t(reinterpret_cast<uintptr_t>(HF.Entry)));
+    ASM.Call(RAX);
+
+    if (Multi) {
+        // r11 carries no result.
+        int32_t ResultBase = 16 + CS.StackParamSize;
+        for (size_t i = 0; i < Results.size(); ++i) {
+            Mem Src(RSP, HS.StackParamSize + 8 * i);
+            auto &Loc = CS.Results[i];
+            if (!Loc.InReg) {
+                ASM.Mov(W64, R11, Src);
+                ASM.Mov(W64, Mem(RBP, ResultBase + Loc.Offset), R11);
+            } else if (isFloatOrVector(Results[i])) {
+                ASM.Movsd(XMM(Loc.Reg), Src);
+            } else {
+                ASM.Mov(W64, GPR(Loc.Reg), Src);
+            }
+        }
+    } else if (!Results.empty() && Results[0] == ValTypeI32) {
+        // SysV leaves the upper half undefined; wasm code expects it zero.
+        ASM.Mov(W32, RAX, RAX);
+    }
+
+    ASM.Mov(W64, RSP, RBP);
+    ASM.Pop(RBP);
+    ASM.Ret(CS.StackParamSize);
+    return ASM.Finalize();
+}
+
+runtime::FuncEntry getHostEntry(const runtime::host::HostFunction &HF) {
+    static std::mutex Lock;
+    static code_buffer::CodeBuffer CB;
+    static std::unordered_map<const void *, const void *> Thunks;
+
+    const void *Code;
+    {
+        std::lock_guard<std::mutex> Guard(Lock);
+        auto &Thunk = Thunks[HF.Entry];
+        if (Thunk == nullptr)
+            Thunk = Generate(CB, HF).Entry;
+        Code = Thunk;
+    }
+    return {runtime::getSignatureId(HF.Type), Code, nullptr, nullptr};
+}
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
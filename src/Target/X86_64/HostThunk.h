@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Runtime/HostFunction.h"
+#include "Runtime/Table.h"
+
+using namespace wasmrt;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Wasm-to-host transition for one host function. Its thunk takes the
+// arguments where the wasm convention (CallingConv.h) put them, passes
+// ContextReg's Instance in front of them and calls HF.Entry with the SysV
+// ABI, which keeps ContextReg, MemBaseReg and MemBoundReg; the results go
+// back where wasm callers expect them. Thunks are generated on the first
+// request for a function and kept for the process.
+//
+// The entry has no instance: runtime::Module binds it to the importing one
+// when it is linked through InstanceImports::Funcs, so that the function
+// sees the instance calling it.
+runtime::FuncEntry getHostEntry(const runtime::host::HostFunction &HF);
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Values are the hardware encodings; bit 3 goes into REX/VEX.
+enum GPR : uint8_t {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+enum XMM : uint8_t {
+    XMM0 = 0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15
+};
+
+// Pinned in all generated code. All three are callee-saved under SysV, so
+// they survive calls into the runtime and host functions untouched.
+inline constexpr GPR ContextReg  = R15;    // the instance's InstanceContext
+inline constexpr GPR MemBaseReg  = R14;    // InstanceContext::MemBase
+inline constexpr GPR MemBoundReg = R13;    // InstanceContext::MemBound, for explicit bounds checks
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,128 @@
+#include "SimdLowering.h"
+
+#include <array>
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// roundps/roundpd immediates set bit 3 to suppress precision exceptions;
+// cmpps/cmppd take the predicate (eq, lt, le, neq) as immediate. gt and ge
+// are lt and le with swapped operands, as are the pmin/pmax, lt_s and andnot
+// forms.
+static const SimdLowering Lowerings[] = {
+    {bytecode::I8x16Add, {Prefix66, Map0F, 0xFC, -1, false, false}, ISASSE2},
+    {bytecode::I16x8Add, {Prefix66, Map0F, 0xFD, -1, false, false}, ISASSE2},
+    {bytecode::I32x4Add, {Prefix66, Map0F, 0xFE, -1, false, false}, ISASSE2},
+    {bytecode::I64x2Add, {Prefix66, Map0F, 0xD4, -1, false, false}, ISASSE2},
+    {bytecode::I8x16Sub, {Prefix66, Map0F, 0xF8, -1, false, false}, ISASSE2},
+    {bytecode::I16x8Sub, {Prefix66, Map0F, 0xF9, -1, false, false}, ISASSE2},
+    {bytecode::I32x4Sub, {Prefix66, Map0F, 0xFA, -1, false, false}, ISASSE2},
+    {bytecode::I64x2Sub, {Prefix66, Map0F, 0xFB, -1, false, false}, ISASSE2},
+    {bytecode::I8x16AddSatS, {Prefix66, Map0F, 0xEC, -1, false, false}, ISASSE2},
+    {bytecode::I16x8AddSatS, {Prefix66, Map0F, 0xED, -1, false, false}, ISASSE2},
+    {bytecode::I8x16AddSatU, {Prefix66, Map0F, 0xDC, -1, false, false}, ISASSE2},
+    {bytecode::I16x8AddSatU, {Prefix66, Map0F, 0xDD, -1, false, false}, ISASSE2},
+    {bytecode::I8x16SubSatS, {Prefix66, Map0F, 0xE8, -1, false, false}, ISASSE2},
+    {bytecode::I16x8SubSatS, {Prefix66, Map0F, 0xE9, -1, false, false}, ISASSE2},
+    {bytecode::I8x16SubSatU, {Prefix66, Map0F, 0xD8, -1, false, false}, ISASSE2},
+    {bytecode::I16x8SubSatU, {Prefix66, Map0F, 0xD9, -1, false, false}, ISASSE2},
+    {bytecode::I16x8Mul, {Prefix66, Map0F, 0xD5, -1, false, false}, ISASSE2},
+    {bytecode::I32x4Mul, {Prefix66, Map0F38, 0x40, -1, false, false}, ISASSE41},
+    {bytecode::I8x16MinS, {Prefix66, Map0F38, 0x38, -1, false, false}, ISASSE41},
+    {bytecode::I16x8MinS, {Prefix66, Map0F, 0xEA, -1, false, false}, ISASSE2},
+    {bytecode::I32x4MinS, {Prefix66, Map0F38, 0x39, -1, false, false}, ISASSE41},
+    {bytecode::I8x16MinU, {Prefix66, Map0F, 0xDA, -1, false, false}, ISASSE2},
+    {bytecode::I16x8MinU, {Prefix66, Map0F38, 0x3A, -1, false, false}, ISASSE41},
+    {bytecode::I32x4MinU, {Prefix66, Map0F38, 0x3B, -1, false, false}, ISASSE41},
+    {bytecode::I8x16MaxS, {Prefix66, Map0F38, 0x3C, -1, false, false}, ISASSE41},
+    {bytecode::I16x8MaxS, {Prefix66, Map0F, 0xEE, -1, false, false}, ISASSE2},
+    {bytecode::I32x4MaxS, {Prefix66, Map0F38, 0x3D, -1, false, false}, ISASSE41},
+    {bytecode::I8x16MaxU, {Prefix66, Map0F, 0xDE, -1, false, false}, ISASSE2},
+    {bytecode::I16x8MaxU, {Prefix66, Map0F38, 0x3E, -1, false, false}, ISASSE41},
+    {bytecode::I32x4MaxU, {Prefix66, Map0F38, 0x3F, -1, false, false}, ISASSE41},
+    {bytecode::I8x16AvgrU, {Prefix66, Map0F, 0xE0, -1, false, false}, ISASSE2},
+    {bytecode::I16x8AvgrU, {Prefix66, Map0F, 0xE3, -1, false, false}, ISASSE2},
+    {bytecode::I8x16Eq, {Prefix66, Map0F, 0x74, -1, false, false}, ISASSE2},
+    {bytecode::I16x8Eq, {Prefix66, Map0F, 0x75, -1, false, false}, ISASSE2},
+    {bytecode::I32x4Eq, {Prefix66, Map0F, 0x76, -1, false, false}, ISASSE2},
+    {bytecode::I64x2Eq, {Prefix66, Map0F38, 0x29, -1, false, false}, ISASSE41},
+    {bytecode::I8x16GtS, {Prefix66, Map0F, 0x64, -1, false, false}, ISASSE2},
+    {bytecode::I16x8GtS, {Prefix66, Map0F, 0x65, -1, false, false}, ISASSE2},
+    {bytecode::I32x4GtS, {Prefix66, Map0F, 0x66, -1, false, false}, ISASSE2},
+    {bytecode::I64x2GtS, {Prefix66, Map0F38, 0x37, -1, false, false}, ISASSE42},
+    {bytecode::I8x16LtS, {Prefix66, Map0F, 0x64, -1, false, true}, ISASSE2},
+    {bytecode::I16x8LtS, {Prefix66, Map0F, 0x65, -1, false, true}, ISASSE2},
+    {bytecode::I32x4LtS, {Prefix66, Map0F, 0x66, -1, false, true}, ISASSE2},
+    {bytecode::I64x2LtS, {Prefix66, Map0F38, 0x37, -1, false, true}, ISASSE42},
+    {bytecode::V128And, {Prefix66, Map0F, 0xDB, -1, false, false}, ISASSE2},
+    {bytecode::V128Or, {Prefix66, Map0F, 0xEB, -1, false, false}, ISASSE2},
+    {bytecode::V128Xor, {Prefix66, Map0F, 0xEF, -1, false, false}, ISASSE2},
+    {bytecode::V128Andnot, {Prefix66, Map0F, 0xDF, -1, false, true}, ISASSE2},
+    {bytecode::I32x4DotI16x8S, {Prefix66, Map0F, 0xF5, -1, false, false}, ISASSE2},
+    {bytecode::I8x16NarrowI16x8S, {Prefix66, Map0F, 0x63, -1, false, false}, ISASSE2},
+    {bytecode::I8x16NarrowI16x8U, {Prefix66, Map0F, 0x67, -1, false, false}, ISASSE2},
+    {bytecode::I16x8NarrowI32x4S, {Prefix66, Map0F, 0x6B, -1, false, false}, ISASSE2},
+    {bytecode::I16x8NarrowI32x4U, {Prefix66, Map0F38, 0x2B, -1, false, false}, ISASSE41},
+    {bytecode::I8x16Abs, {Prefix66, Map0F38, 0x1C, -1, true, false}, ISASSSE3},
+    {bytecode::I16x8Abs, {Prefix66, Map0F38, 0x1D, -1, true, false}, ISASSSE3},
+    {bytecode::I32x4Abs, {Prefix66, Map0F38, 0x1E, -1, true, false}, ISASSSE3},
+    {bytecode::I16x8ExtendLowI8x16S, {Prefix66, Map0F38, 0x20, -1, true, false}, ISASSE41},
+    {bytecode::I16x8ExtendLowI8x16U, {Prefix66, Map0F38, 0x30, -1, true, false}, ISASSE41},
+    {bytecode::I32x4ExtendLowI16x8S, {Prefix66, Map0F38, 0x23, -1, true, false}, ISASSE41},
+    {bytecode::I32x4ExtendLowI16x8U, {Prefix66, Map0F38, 0x33, -1, true, false}, ISASSE41},
+    {bytecode::I64x2ExtendLowI32x4S, {Prefix66, Map0F38, 0x25, -1, true, false}, ISASSE41},
+    {bytecode::I64x2ExtendLowI32x4U, {Prefix66, Map0F38, 0x35, -1, true, false}, ISASSE41},
+    {bytecode::F32x4Add, {PrefixNone, Map0F, 0x58, -1, false, false}, ISASSE2},
+    {bytecode::F32x4Sub, {PrefixNone, Map0F, 0x5C, -1, false, false}, ISASSE2},
+    {bytecode::F32x4Mul, {PrefixNone, Map0F, 0x59, -1, false, false}, ISASSE2},
+    {bytecode::F32x4Div, {PrefixNone, Map0F, 0x5E, -1, false, false}, ISASSE2},
+    {bytecode::F32x4Sqrt, {PrefixNone, Map0F, 0x51, -1, true, false}, ISASSE2},
+    {bytecode::F64x2Add, {Prefix66, Map0F, 0x58, -1, false, false}, ISASSE2},
+    {bytecode::F64x2Sub, {Prefix66, Map0F, 0x5C, -1, false, false}, ISASSE2},
+    {bytecode::F64x2Mul, {Prefix66, Map0F, 0x59, -1, false, false}, ISASSE2},
+    {bytecode::F64x2Div, {Prefix66, Map0F, 0x5E, -1, false, false}, ISASSE2},
+    {bytecode::F64x2Sqrt, {Prefix66, Map0F, 0x51, -1, true, false}, ISASSE2},
+    {bytecode::F32x4Pmin, {PrefixNone, Map0F, 0x5D, -1, false, true}, ISASSE2},
+    {bytecode::F32x4Pmax, {PrefixNone, Map0F, 0x5F, -1, false, true}, ISASSE2},
+    {bytecode::F64x2Pmin, {Prefix66, Map0F, 0x5D, -1, false, true}, ISASSE2},
+    {bytecode::F64x2Pmax, {Prefix66, Map0F, 0x5F, -1, false, true}, ISASSE2},
+    {bytecode::F32x4Eq, {PrefixNone, Map0F, 0xC2, 0, false, false}, ISASSE2},
+    {bytecode::F32x4Lt, {PrefixNone, Map0F, 0xC2, 1, false, false}, ISASSE2},
+    {bytecode::F32x4Le, {PrefixNone, Map0F, 0xC2, 2, false, false}, ISASSE2},
+    {bytecode::F32x4Ne, {PrefixNone, Map0F, 0xC2, 4, false, false}, ISASSE2},
+    {bytecode::F32x4Gt, {PrefixNone, Map0F, 0xC2, 1, false, true}, ISASSE2},
+    {bytecode::F32x4Ge, {PrefixNone, Map0F, 0xC2, 2, false, true}, ISASSE2},
+    {bytecode::F64x2Eq, {Prefix66, Map0F, 0xC2, 0, false, false}, ISASSE2},
+    {bytecode::F64x2Lt, {Prefix66, Map0F, 0xC2, 1, false, false}, ISASSE2},
+    {bytecode::F64x2Le, {Prefix66, Map0F, 0xC2, 2, false, false}, ISASSE2},
+    {bytecode::F64x2Ne, {Prefix66, Map0F, 0xC2, 4, false, false}, ISASSE2},
+    {bytecode::F64x2Gt, {Prefix66, Map0F, 0xC2, 1, false, true}, ISASSE2},
+    {bytecode::F64x2Ge, {Prefix66, Map0F, 0xC2, 2, false, true}, ISASSE2},
+    {bytecode::F32x4Ceil, {Prefix66, Map0F3A, 0x08, 0xA, true, false}, ISASSE41},
+    {bytecode::F32x4Floor, {Prefix66, Map0F3A, 0x08, 0x9, true, false}, ISASSE41},
+    {bytecode::F32x4Trunc, {Prefix66, Map0F3A, 0x08, 0xB, true, false}, ISASSE41},
+    {bytecode::F32x4Nearest, {Prefix66, Map0F3A, 0x08, 0x8, true, false}, ISASSE41},
+    {bytecode::F64x2Ceil, {Prefix66, Map0F3A, 0x09, 0xA, true, false}, ISASSE41},
+    {bytecode::F64x2Floor, {Prefix66, Map0F3A, 0x09, 0x9, true, false}, ISASSE41},
+    {bytecode::F64x2Trunc, {Prefix66, Map0F3A, 0x09, 0xB, true, false}, ISASSE41},
+    {bytecode::F64x2Nearest, {Prefix66, Map0F3A, 0x09, 0x8, true, false}, ISASSE41},
+    {bytecode::F32x4ConvertI32x4S, {PrefixNone, Map0F, 0x5B, -1, true, false}, ISASSE2},
+    {bytecode::F64x2ConvertLowI32x4S, {PrefixF3, Map0F, 0xE6, -1, true, false}, ISASSE2},
+    {bytecode::F64x2PromoteLowF32x4, {PrefixNone, Map0F, 0x5A, -1, true, false}, ISASSE2},
+    {bytecode::F32x4DemoteF64x2Zero, {Prefix66, Map0F, 0x5A, -1, true, false}, ISASSE2},
+};
+
+const SimdLowering *getSimdLowering(bytecode::SimdOp Op) {
+    static const auto Index = [] {
+        std::array<const SimdLowering *, 256> Index{};
+        for (auto &L : Lowerings)
+            Index[L.Op] = &L;
+        return Index;
+    }();
+    return uint32_t(Op) < Index.size() ? Index[Op] : nullptr;
+}
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
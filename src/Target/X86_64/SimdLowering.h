@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Parser/Bytecode.h"
+
+#include "Assembler.h"
+
+#include <cstdint>
+
+using namespace wasmrt;
+using namespace wasmrt::parser;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+enum SimdISA : uint8_t { ISASSE2 = 0, ISASSSE3, ISASSE41, ISASSE42 };
+
+// A SIMD op that lowers to a single xmm instruction.
+struct SimdLowering {
+    bytecode::SimdOp  Op;
+    SimdEncoding      Enc;
+    SimdISA           ISA;
+};
+
+// nullptr for ops that need a multi-instruction sequence.
+const SimdLowering *getSimdLowering(bytecode::SimdOp Op);
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -1,7 +1,25 @@
 #include "Interpreter/TemplateInterpreter.h"
+#include "Runtime/BoundsCheck.h"
+#include "Runtime/BulkMemory.h"
+#include "Runtime/Epoch.h"
+#include "Runtime/Fuel.h"
+#include "Runtime/InlineCache.h"
+#include "Runtime/InstanceContext.h"
+#include "Runtime/Trap.h"
+#include "Support/CPUFeatures.h"
 #include "Support/Output.h"
 
 #include "Assembler.h"
+#include "CallingConv.h"
+#include "Registers.h"
+#include "SimdLowering.h"
+#include "TemplateInterpreter.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <optional>
 
 using namespace wasmrt;
 using namespace wasmrt::adt;
@@ -11,43 +29,855 @@ namespace wasmrt {
 namespace target {
 namespace x86_64 {
 
+// Imported memories take the first indices.
+static bool isMemory64(const parser::module::Module &M) {
+    for (auto &Import : M.ImportSec) {
+        if (Import.Desc.Tag == parser::module::ImportTagMem)
+            return Import.Desc.Idx.Mem.is64();
+    }
+    return !M.MemSec.empty() && M.MemSec[0].is64();
+}
+
 class X86_64TemplateInterpreter : public TemplateInterpreter {
 public:
-    X86_64TemplateInterpreter(runtime::Function &Func, code_buffer::CodeBuffer &CB)
-        : ASM(CB, ExpectInterpretSIze(Func)) {}
+    X86_64TemplateInterpreter(runtime::Function &Func, Assembler &ASM)
+        : Func(Func), ASM(ASM),
+          Sig(getCallSignature(Func.Type)),
+          NumLocals(Func.Type.ParamTypes.size() + Func.Code.getLocalCount()),
+          SavesContext(Func.Code.CallIndirectSites != 0 || Func.Parent.NumImportedFuncs != 0),
+          Memory64(isMemory64(Func.Parent)),
+          UseAVX(support::cpu::getCPUFeatures().AVX) {}
 
-    size_t ExpectInterpretSIze(runtime::Function &Func);
-    void RuntimeCall();
+    void Push(GPR Src);
+    void Pop(GPR Dst);
+    void PushXmm(XMM Src);
+    void PopXmm(XMM Dst);
+    void RuntimeCall(const void *Entry, uintptr_t Arg);
+    void RuntimeCall(const void *Entry);
+    void LoadMemoryRegs();
+    void EnterCallee();
+    void ReturnFromCallee();
+    void EmitTrapUnless(Cond C, runtime::trap::TrapKind Kind);
+    int32_t PassArgs(const FuncType &Type, const CallSignature &CS);
+    void TakeResults(const FuncType &Type, const CallSignature &CS, int32_t Reserved);
+    void EmitCall(const bytecode::WithArgInst &Inst);
+    void ResolveIndirect(const bytecode::CallIndirectInst &Inst);
+    void EmitCallIndirect(const bytecode::CallIndirectInst &Inst);
+    void PassTailArgs(const FuncType &Type);
+    void EmitFuelCharge(const runtime::fuel::Charge &C);
+    void EmitEpochCheck();
+    void AllocateFrame(int32_t Size);
+    void EmitPrologue();
+    void EmitReturn();
+    void LoadAddress(int32_t Depth, uint64_t Extent);
+    void CheckEnd();
+    void EmitBoundsCheck(const bytecode::MemoryInst &Inst);
+    void EmitMemoryGrow();
+    void EmitTailCallEntry(const FuncType &Type);
+    void EmitReturnCall(const bytecode::WithArgInst &Inst);
+    void EmitReturnCallIndirect(const bytecode::CallIndirectInst &Inst);
+    void LoadAtomicAddress(const bytecode::AtomicInst &Inst, int32_t Depth, uint32_t Size);
+    void EmitAtomic(const bytecode::AtomicInst &Inst);
+    void BulkCall(const void *Entry, std::initializer_list<uint32_t> Imms, std::initializer_list<Width> Operands);
+    void EmitMisc(const bytecode::MiscInst &Inst);
+    void EmitTableAccess(const bytecode::WithArgInst &Inst);
+    void EmitSimd(const bytecode::SimdInst &Inst);
     code_buffer::CodeBlob CodeGen() final;
 
-    Assembler ASM;
+    static constexpr uint8_t LoopAlign = 16;
+    static constexpr int32_t SlotSize = 16;
+    static constexpr int32_t PageSize = 4096;   // the smallest guard page
+
+    // Where the caller's stack parameters start, above the saved rbp and the
+    // return address.
+    static constexpr int32_t StackParamBase = 16;
+    inline Mem Local(uint32_t Idx) const { return Mem(RBP, -SlotSize * int32_t(Idx + 1)); }
+    inline Mem SavedContext() const { return Local(NumLocals); }
+
+    runtime::Function &Func;
+    Assembler &ASM;
+    CallSignature Sig;
+    uint32_t NumLocals;     // parameters included
+    bool SavesContext;      // may call into another instance, see EnterCallee
+    bool Memory64;          // memory 0 takes i64 addresses
+    bool UseAVX;    // VEX encode SIMD templates, saving the register copies
+    std::optional<result::Failure> Failed;  // why the function cannot be compiled
+}
+
+// Frame layout. rbp points at the caller's rbp, with the return address and
+// the stack parameters above it, and the result area (see CallingConv.h)
+// above those. Every local, parameters first, takes a 16-byte slot below rbp,
+// and the operand stack grows below the locals, one 16-byte slot per value
+// whatever its type. Functions that may call into another instance keep
+// their ContextReg in one more slot between the two. rsp is 16-byte aligned
+// on entry to every instruction.
+//
+//   [rbp + 16 + StackParamSize]   result area
+//   [rbp + 16]                    stack parameters
+//   [rbp + 8]                     return address
+//   [rbp - 16 * (i + 1)]          local i
+//   [rbp - 16 * (NumLocals + 1)]  saved ContextReg
+//   [rsp]                         top of the operand stack
+void X86_64TemplateInterpreter::Push(GPR Src) {
+    ASM.Lea(W64, RSP, Mem(RSP, -SlotSize));
+    ASM.Mov(W64, Mem(RSP), Src);
+}
+
+// lea leaves the flags alone, so templates may pop between a compare and its
+// branch.
+void X86_64TemplateInterpreter::Pop(GPR Dst) {
+    ASM.Mov(W64, Dst, Mem(RSP));
+    ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+}
+
+void X86_64TemplateInterpreter::PushXmm(XMM Src) {
+    ASM.Lea(W64, RSP, Mem(RSP, -SlotSize));
+    ASM.Movdqu(Mem(RSP), Src);
+}
+
+void X86_64TemplateInterpreter::PopXmm(XMM Dst) {
+    ASM.Movdqu(Dst, Mem(RSP));
+    ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+}
+
+// Operands live in the frame across runtime calls, and the frame keeps rsp
+// 16-byte aligned between instructions, so a call needs no spilling or
+// realignment here.
+void X86_64TemplateInterpreter::RuntimeCall(const void *Entry, uintptr_t Arg) {
+    ASM.Mov(RDI, uint64_t(Arg));
+    ASM.Mov(RAX, uint64_t(reinterpret_cast<uintptr_t>(Entry)));
+    ASM.Call(RAX);
+}
+
+// Passes the running instance, read from the context rather than baked in,
+// so that the code can be shared by all instances of the module.
+void X86_64TemplateInterpreter::RuntimeCall(const void *Entry) {
+    ASM.Mov(W64, RDI, Mem(ContextReg, offsetof(runtime::InstanceContext, Instance)));
+    ASM.Mov(RAX, uint64_t(reinterpret_cast<uintptr_t>(Entry)));
+    ASM.Call(RAX);
+}
+
+// Traps are rare enough that the check falls through to the trap and the
+// common case branches over it.
+void X86_64TemplateInterpreter::EmitTrapUnless(Cond C, runtime::trap::TrapKind Kind) {
+    auto Ok = ASM.NewLabel();
+    ASM.Jcc(C, Ok);
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::trap::RaiseFromCode), Kind);
+    ASM.Bind(Ok);
+}
+
+void X86_64TemplateInterpreter::LoadMemoryRegs() {
+    ASM.Mov(W64, MemBaseReg, Mem(ContextReg, offsetof(runtime::InstanceContext, MemBase)));
+    ASM.Mov(W64, MemBoundReg, Mem(ContextReg, offsetof(runtime::InstanceContext, MemBound)));
+}
+
+// Calls through a FuncEntry (in rax) may leave the instance: imported
+// functions and call_indirect targets. The callee is entered with its own
+// context and the caller's is restored from the frame once it returns; the
+// bound is reloaded either way, which also picks up growth by the callee.
+void X86_64TemplateInterpreter::EnterCallee() {
+    ASM.Mov(W64, ContextReg, Mem(RAX, offsetof(runtime::FuncEntry, Context)));
+    LoadMemoryRegs();
+}
+
+void X86_64TemplateInterpreter::ReturnFromCallee() {
+    ASM.Mov(W64, ContextReg, SavedContext());
+    LoadMemoryRegs();
+}
+
+void X86_64TemplateInterpreter::EmitEpochCheck() {
+    auto Ok = ASM.NewLabel();
+    ASM.Mov(RAX, uint64_t(reinterpret_cast<uintptr_t>(&runtime::epoch::Epoch)));
+    ASM.Mov(W64, RAX, Mem(RAX));
+    ASM.Alu(AluCmp, W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, EpochDeadline)));
+    ASM.Jcc(CondB, Ok);
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::epoch::OnDeadline));
+    ASM.Bind(Ok);
+}
+
+// One sub on the context per basic block; only blocks that need the check
+// branch on its sign.
+void X86_64TemplateInterpreter::EmitFuelCharge(const runtime::fuel::Charge &C) {
+    if (C.Cost == 0 && !C.Check)
+        return;
+    ASM.Alu(AluSub, W64, Mem(ContextReg, offsetof(runtime::InstanceContext, Fuel)), int32_t(C.Cost));
+    if (!C.Check)
+        return;
+    auto Ok = ASM.NewLabel();
+    ASM.Jcc(CondNS, Ok);
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::fuel::OnExhausted));
+    ASM.Bind(Ok);
+}
+
+// rax = the address Depth slots below the top plus Extent. The sum is
+// computed in 64 bits, where a 32-bit address plus offset cannot wrap; a
+// 64-bit one traps if it does.
+void X86_64TemplateInterpreter::LoadAddress(int32_t Depth, uint64_t Extent) {
+    ASM.Mov(Memory64 ? W64 : W32, RAX, Mem(RSP, SlotSize * Depth));
+    if (Extent == 0)
+        return;
+    if (Extent <= INT32_MAX) {
+        ASM.Alu(AluAdd, W64, RAX, int32_t(Extent));
+    } else {
+        ASM.Mov(R11, Extent);
+        ASM.Alu(AluAdd, W64, RAX, R11);
+    }
+    if (Memory64)
+        EmitTrapUnless(CondAE, runtime::trap::TrapOutOfBounds);
+}
+
+// Traps unless rax, the end of an access, is within the memory. Misses first
+// reload MemBoundReg, which may be stale after the memory grew (see
+// RefreshMemoryBound), keeping the end in a slot meanwhile.
+void X86_64TemplateInterpreter::CheckEnd() {
+    auto Ok = ASM.NewLabel();
+    ASM.Alu(AluCmp, W64, RAX, MemBoundReg);
+    ASM.Jcc(CondBE, Ok);
+    Push(RAX);
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::RefreshMemoryBound));
+    ASM.Mov(W64, MemBoundReg, RAX);
+    Pop(RAX);
+    ASM.Alu(AluCmp, W64, RAX, MemBoundReg);
+    EmitTrapUnless(CondBE, runtime::trap::TrapOutOfBounds);
+    ASM.Bind(Ok);
+}
+
+// The address is the top operand of loads and the one below the value of
+// stores.
+void X86_64TemplateInterpreter::EmitBoundsCheck(const bytecode::MemoryInst &Inst) {
+    auto Op = Inst.getOpcode();
+    uint64_t Size = runtime::bounds::getAccessSize(Op);
+    if (Inst.Offset > UINT64_MAX - Size) {
+        RuntimeCall(reinterpret_cast<const void *>(&runtime::trap::RaiseFromCode), runtime::trap::TrapOutOfBounds);
+        return;
+    }
+    bool IsStore = Op >= bytecode::I32Store && Op <= bytecode::I64Store32;
+    LoadAddress(IsStore ? 1 : 0, Inst.Offset + Size);
+    CheckEnd();
+}
+
+// The delta, unsigned and as wide as the memory's addresses, replaced by the
+// old size or -1. The bound changed if the memory grew; reloading it here
+// spares the following accesses the refresh path.
+void X86_64TemplateInterpreter::EmitMemoryGrow() {
+    ASM.Mov(Memory64 ? W64 : W32, RSI, Mem(RSP));
+    ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::MemoryGrow));
+    Push(RAX);
+    ASM.Mov(W64, MemBoundReg, Mem(ContextReg, offsetof(runtime::InstanceContext, MemBound)));
+}
+
+// Access widths of the atomic loads, stores and read-modify-writes, which
+// come in groups of seven from I32AtomicLoad on: i32, i64, i32 8u, i32 16u,
+// i64 8u, i64 16u and i64 32u.
+static constexpr uint8_t AtomicSizes[7] = {4, 8, 1, 2, 1, 2, 4};
+
+// Narrow results are zero-extended to the slot.
+static void ZeroExtend(Assembler &ASM, Width W, GPR R) {
+    if (W == W64)
+        return;
+    if (W == W32)
+        ASM.Mov(W32, R, R);
+    else
+        ASM.Movzx(W32, W, R, R);
+}
+
+// rax = the effective address of an atomic access whose address is Depth
+// slots below the top. Misaligned atomics trap, so the alignment is checked
+// even where the guard region spares the bounds check.
+void X86_64TemplateInterpreter::LoadAtomicAddress(const bytecode::AtomicInst &Inst, int32_t Depth, uint32_t Size) {
+    if (Inst.Offset > UINT64_MAX - Size) {
+        RuntimeCall(reinterpret_cast<const void *>(&runtime::trap::RaiseFromCode), runtime::trap::TrapOutOfBounds);
+        return;
+    }
+    if (Func.Bounds != nullptr) {
+        LoadAddress(Depth, Inst.Offset + Size);
+        CheckEnd();
+        ASM.Lea(W64, RAX, Mem(RAX, -int32_t(Size)));
+    } else {
+        LoadAddress(Depth, Inst.Offset);
+    }
+    if (Size > 1) {
+        ASM.Test(W32, RAX, int32_t(Size - 1));
+        EmitTrapUnless(CondE, runtime::trap::TrapUnalignedAtomic);
+    }
+}
+
+// Loads are plain movs: x86 orders them, and the stores take xchg, which is
+// locked implicitly and drains the store buffer, so every access is
+// sequentially consistent. Add and sub are a lock xadd; and, or and xor have
+// no fetching form and retry a lock cmpxchg until no other store intervenes.
+// Wait and notify check their address in the runtime, which also traps on
+// waits on unshared memories.
+void X86_64TemplateInterpreter::EmitAtomic(const bytecode::AtomicInst &Inst) {
+    using namespace bytecode;
+    switch (Inst.SubOp) {
+        case AtomicFence:
+            ASM.Mfence();
+            return;
+        case AtomicNotify:
+            LoadAddress(1, Inst.Offset);
+            ASM.Mov(W64, RSI, RAX);
+            ASM.Mov(W32, RDX, Mem(RSP));
+            RuntimeCall(reinterpret_cast<const void *>(&runtime::MemoryNotify));
+            ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+            ASM.Mov(W32, RAX, RAX);
+            ASM.Mov(W64, Mem(RSP), RAX);
+            return;
+        case AtomicWait32:
+        case AtomicWait64:
+            LoadAddress(2, Inst.Offset);
+            ASM.Mov(W64, RSI, RAX);
+            ASM.Mov(Inst.SubOp == AtomicWait32 ? W32 : W64, RDX, Mem(RSP, SlotSize));
+            ASM.Mov(W64, RCX, Mem(RSP));
+            if (Inst.SubOp == AtomicWait32)
+                RuntimeCall(reinterpret_cast<const void *>(&runtime::MemoryWait32));
+            else
+                RuntimeCall(reinterpret_cast<const void *>(&runtime::MemoryWait64));
+            ASM.Lea(W64, RSP, Mem(RSP, 2 * SlotSize));
+            ASM.Mov(W32, RAX, RAX);
+            ASM.Mov(W64, Mem(RSP), RAX);
+            return;
+        default:
+            break;
+    }
+
+    uint32_t Idx = Inst.SubOp - I32AtomicLoad;
+    uint32_t Size = AtomicSizes[Idx % 7];
+    auto W = Width(Size);
+    uint32_t Group = Idx / 7;
+    if (Group == 0) {
+        LoadAtomicAddress(Inst, 0, Size);
+        if (Size < 4)
+            ASM.Movzx(W32, W, RCX, Mem(MemBaseReg, RAX, 1));
+        else
+            ASM.Mov(W, RCX, Mem(MemBaseReg, RAX, 1));
+        ASM.Mov(W64, Mem(RSP), RCX);
+        return;
+    }
+    if (Group == 1) {
+        LoadAtomicAddress(Inst, 1, Size);
+        ASM.Mov(W64, RCX, Mem(RSP));
+        ASM.Xchg(W, Mem(MemBaseReg, RAX, 1), RCX);
+        ASM.Lea(W64, RSP, Mem(RSP, 2 * SlotSize));
+        return;
+    }
+    if (Inst.SubOp >= I32AtomicRmwCmpxchg) {
+        // Only the low bytes of the expected value take part in the compare,
+        // which is the wrapping the narrow forms ask for.
+        LoadAtomicAddress(Inst, 2, Size);
+        ASM.Mov(W64, RDX, RAX);
+        ASM.Mov(W64, RAX, Mem(RSP, SlotSize));
+        ASM.Mov(W64, RCX, Mem(RSP));
+        ASM.Lock();
+        ASM.Cmpxchg(W, Mem(MemBaseReg, RDX, 1), RCX);
+        ZeroExtend(ASM, W, RAX);
+        ASM.Lea(W64, RSP, Mem(RSP, 2 * SlotSize));
+        ASM.Mov(W64, Mem(RSP), RAX);
+        return;
+    }
+
+    LoadAtomicAddress(Inst, 1, Size);
+    ASM.Mov(W64, RCX, Mem(RSP));
+    GPR Result = RCX;
+    if (Inst.SubOp <= I64AtomicRmw32SubU) {
+        if (Inst.SubOp >= I32AtomicRmwSub)
+            ASM.Neg(W64, RCX);
+        ASM.Lock();
+        ASM.Xadd(W, Mem(MemBaseReg, RAX, 1), RCX);
+    } else if (Inst.SubOp >= I32AtomicRmwXchg) {
+        ASM.Xchg(W, Mem(MemBaseReg, RAX, 1), RCX);
+    } else {
+        AluOp Alu = Inst.SubOp <= I64AtomicRmw32AndU ? AluAnd
+                  : Inst.SubOp <= I64AtomicRmw32OrU ? AluOr : AluXor;
+        Mem Target(MemBaseReg, RDX, 1);
+        ASM.Mov(W64, RDX, RAX);
+        if (Size < 4)
+            ASM.Movzx(W32, W, RAX, Target);
+        else
+            ASM.Mov(W, RAX, Target);
+        // A failed cmpxchg reloads rax, writing only its low W bytes.
+        auto Retry = ASM.NewLabel();
+        ASM.Bind(Retry);
+        ASM.Mov(W64, R11, RAX);
+        ASM.Alu(Alu, W64, R11, RCX);
+        ASM.Lock();
+        ASM.Cmpxchg(W, Target, R11);
+        ASM.Jcc(CondNE, Retry);
+        Result = RAX;
+    }
+    ZeroExtend(ASM, W, Result);
+    ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+    ASM.Mov(W64, Mem(RSP), Result);
+}
+
+// Calls the bulk entry Entry with the top N operands, the first one
+// deepest, in the argument registers after the instance and Imms. Addresses
+// are as wide as the memory's, everything else is an i32 but for refs.
+// Returns with the operands popped and the result in rax.
+void X86_64TemplateInterpreter::BulkCall(const void *Entry, std::initializer_list<uint32_t> Imms,
+                                         std::initializer_list<Width> Operands) {
+    static const GPR Args[] = {RSI, RDX, RCX, R8, R9};
+    int32_t Arg = 0, N = Operands.size();
+    for (auto Imm : Imms)
+        ASM.Mov(Args[Arg++], uint64_t(Imm));
+    int32_t Depth = N;
+    for (auto W : Operands)
+        ASM.Mov(W, Args[Arg++], Mem(RSP, SlotSize * --Depth));
+    RuntimeCall(Entry);
+    if (N != 0)
+        ASM.Lea(W64, RSP, Mem(RSP, SlotSize * N));
+}
+
+// Bulk memory and table ops go to BulkMemory, which checks all bounds up
+// front; false comes back when nothing was written and the op must trap.
+// table.size is a load from the instance's view of the table. The
+// saturating truncations have no template in this tier yet, like the other
+// conversions.
+void X86_64TemplateInterpreter::EmitMisc(const bytecode::MiscInst &Inst) {
+    using namespace bytecode;
+    namespace bulk = runtime::bulk;
+    Width Addr = Memory64 ? W64 : W32;
+    runtime::trap::TrapKind Trap = runtime::trap::TrapOutOfBounds;
+    switch (Inst.SubOp) {
+        case MemoryInit:
+            BulkCall(reinterpret_cast<const void *>(&bulk::MemoryInit), {Inst.Arg0}, {Addr, W32, W32});
+            break;
+        case DataDrop:
+            BulkCall(reinterpret_cast<const void *>(&bulk::DataDrop), {Inst.Arg0}, {});
+            return;
+        case MemoryCopy:
+            BulkCall(reinterpret_cast<const void *>(&bulk::MemoryCopy), {}, {Addr, Addr, Addr});
+            break;
+        case MemoryFill:
+            BulkCall(reinterpret_cast<const void *>(&bulk::MemoryFill), {}, {Addr, W32, Addr});
+            break;
+        case TableInit:
+            BulkCall(reinterpret_cast<const void *>(&bulk::TableInit), {Inst.Arg1, Inst.Arg0}, {W32, W32, W32});
+            Trap = runtime::trap::TrapTableOutOfBounds;
+            break;
+        case ElemDrop:
+            BulkCall(reinterpret_cast<const void *>(&bulk::ElemDrop), {Inst.Arg0}, {});
+            return;
+        case TableCopy:
+            BulkCall(reinterpret_cast<const void *>(&bulk::TableCopy), {Inst.Arg0, Inst.Arg1}, {W32, W32, W32});
+            Trap = runtime::trap::TrapTableOutOfBounds;
+            break;
+        case TableFill:
+            BulkCall(reinterpret_cast<const void *>(&bulk::TableFill), {Inst.Arg0}, {W32, W64, W32});
+            Trap = runtime::trap::TrapTableOutOfBounds;
+            break;
+        case TableGrow:
+            BulkCall(reinterpret_cast<const void *>(&bulk::TableGrow), {Inst.Arg0}, {W64, W32});
+            ASM.Mov(W32, RAX, RAX);
+            Push(RAX);
+            return;
+        case TableSize:
+            ASM.Mov(W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, Tables)));
+            ASM.Mov(W64, RAX, Mem(RAX, int32_t(Inst.Arg0 * sizeof(runtime::TableView) +
+                                               offsetof(runtime::TableView, Length))));
+            Push(RAX);
+            return;
+        default:
+            return;
+    }
+    ASM.Test(W8, RAX, RAX);
+    EmitTrapUnless(CondNE, Trap);
+}
+
+// table.get and table.set check the index against the length in the
+// instance's view of the table, like call_indirect, and access the element
+// through the view's base with no runtime call.
+void X86_64TemplateInterpreter::EmitTableAccess(const bytecode::WithArgInst &Inst) {
+    int32_t View = int32_t(Inst.Arg * sizeof(runtime::TableView));
+    bool Set = Inst.getOpcode() == bytecode::TableSet;
+    if (Set)
+        Pop(RDX);
+    Pop(RCX);
+    ASM.Mov(W32, RCX, RCX);
+    ASM.Mov(W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, Tables)));
+    ASM.Alu(AluCmp, W64, RCX, Mem(RAX, View + offsetof(runtime::TableView, Length)));
+    EmitTrapUnless(CondB, runtime::trap::TrapTableOutOfBounds);
+    ASM.Mov(W64, RAX, Mem(RAX, View + offsetof(runtime::TableView, Base)));
+    if (Set) {
+        ASM.Mov(W64, Mem(RAX, RCX, sizeof(runtime::Ref)), RDX);
+    } else {
+        ASM.Mov(W64, RAX, Mem(RAX, RCX, sizeof(runtime::Ref)));
+        Push(RAX);
+    }
+}
+
+// SSSE3 is implied by every CPU with SSE4.1.
+static bool hasISA(SimdISA ISA) {
+    auto &Features = support::cpu::getCPUFeatures();
+    switch (ISA) {
+        case ISASSE2:  return true;
+        case ISASSSE3:
+        case ISASSE41: return Features.SSE41;
+        case ISASSE42: return Features.SSE42;
+    }
+    return false;
+}
+
+// Ops with a single-instruction lowering (see SimdLowering.cpp), plus
+// v128.const. A v128 takes one whole slot; binary ops leave their result in
+// the left operand's. The other ops have no template in this tier yet.
+void X86_64TemplateInterpreter::EmitSimd(const bytecode::SimdInst &Inst) {
+    if (Inst.SubOp == bytecode::V128Const) {
+        auto &Bytes = static_cast<const bytecode::SimdBytesInst &>(Inst).Bytes;
+        uint64_t Lo, Hi;
+        memcpy(&Lo, Bytes, 8);
+        memcpy(&Hi, Bytes + 8, 8);
+        ASM.Lea(W64, RSP, Mem(RSP, -SlotSize));
+        ASM.Mov(RAX, Lo);
+        ASM.Mov(W64, Mem(RSP), RAX);
+        ASM.Mov(RAX, Hi);
+        ASM.Mov(W64, Mem(RSP, 8), RAX);
+        return;
+    }
+    auto *L = getSimdLowering(Inst.SubOp);
+    if (L == nullptr)
+        return;
+    if (!hasISA(L->ISA)) {
+        if (!Failed)
+            Failed = result::MakeFailure("X86_64TemplateInterpreter::EmitSimd",
+                                         "SIMD op %u not supported by this CPU", unsigned(Inst.SubOp));
+        return;
+    }
+
+    if (L->Enc.Unary) {
+        ASM.Movdqu(XMM0, Mem(RSP));
+        ASM.Simd(L->Enc, XMM0, XMM0, XMM0, UseAVX);
+        ASM.Movdqu(Mem(RSP), XMM0);
+        return;
+    }
+    // Computing into whichever operand x86 takes first spares the SSE form
+    // a copy.
+    XMM Dst = L->Enc.Swap ? XMM1 : XMM0;
+    ASM.Movdqu(XMM1, Mem(RSP));
+    ASM.Movdqu(XMM0, Mem(RSP, SlotSize));
+    ASM.Simd(L->Enc, Dst, XMM0, XMM1, UseAVX);
+    ASM.Lea(W64, RSP, Mem(RSP, SlotSize));
+    ASM.Movdqu(Mem(RSP), Dst);
+}
+
+// Loads the arguments, the top operands with the last one topmost, where CS
+// puts them. Below the operand stack go the slots of the results that do not
+// fit where the arguments are, then the callee's result area and its stack
+// parameters, so the call leaves rsp 16-byte aligned. Returns how far rsp
+// moved down. Only xmm15 is clobbered besides the argument registers.
+int32_t X86_64TemplateInterpreter::PassArgs(const FuncType &Type, const CallSignature &CS) {
+    auto &Params = Type.ParamTypes;
+    int32_t N = Params.size(), M = Type.ResultTypes.size();
+    int32_t Reserved = std::max(M - N, 0) * SlotSize + CS.StackResultSize + CS.StackParamSize;
+    if (Reserved != 0)
+        ASM.Lea(W64, RSP, Mem(RSP, -Reserved));
+    for (int32_t i = 0; i < N; ++i) {
+        Mem Arg(RSP, Reserved + SlotSize * (N - 1 - i));
+        auto &Loc = CS.Params[i];
+        if (!Loc.InReg) {
+            ASM.Movdqu(XMM15, Arg);
+            if (Params[i] == ValTypeV128)
+                ASM.Movdqu(Mem(RSP, Loc.Offset), XMM15);
+            else
+                ASM.Movsd(Mem(RSP, Loc.Offset), XMM15);
+        } else if (isFloatOrVector(Params[i])) {
+            ASM.Movdqu(XMM(Loc.Reg), Arg);
+        } else {
+            ASM.Mov(W64, GPR(Loc.Reg), Arg);
+        }
+    }
+    return Reserved;
+}
+
+// Once the callee returned and popped its stack parameters, the result area
+// is at rsp. Replaces the arguments with the results, the first one deepest;
+// the slots lie above the result area, so no copy overwrites another's source.
+void X86_64TemplateInterpreter::TakeResults(const FuncType &Type, const CallSignature &CS, int32_t Reserved) {
+    auto &Results = Type.ResultTypes;
+    int32_t N = Type.ParamTypes.size(), M = Results.size();
+    int32_t Top = Reserved - int32_t(CS.StackParamSize) + N * SlotSize;
+    for (int32_t i = 0; i < M; ++i) {
+        Mem Slot(RSP, Top - SlotSize * (i + 1));
+        auto &Loc = CS.Results[i];
+        if (!Loc.InReg) {
+            ASM.Movdqu(XMM15, Mem(RSP, Loc.Offset));
+            ASM.Movdqu(Slot, XMM15);
+        } else if (isFloatOrVector(Results[i])) {
+            ASM.Movdqu(Slot, XMM(Loc.Reg));
+        } else {
+            ASM.Mov(W64, Slot, GPR(Loc.Reg));
+        }
+    }
+    if (Top != M * SlotSize)
+        ASM.Lea(W64, RSP, Mem(RSP, Top - M * SlotSize));
+}
+
+// Calls within the module are direct and patched once the callee has an
+// address; imports go through their FuncEntry.
+void X86_64TemplateInterpreter::EmitCall(const bytecode::WithArgInst &Inst) {
+    auto &Type = Func.Parent.TypeSec[Func.Parent.FuncTypes[Inst.Arg]];
+    auto CS = getCallSignature(Type);
+    int32_t Reserved = PassArgs(Type, CS);
+    if (Inst.Arg >= Func.Parent.NumImportedFuncs) {
+        ASM.CallFunc(Inst.Arg);
+    } else {
+        ASM.Mov(W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, Funcs)));
+        ASM.Lea(W64, RAX, Mem(RAX, Inst.Arg * sizeof(runtime::FuncEntry)));
+        EnterCallee();
+        ASM.Call(Mem(RAX, offsetof(runtime::FuncEntry, Code)));
+        ReturnFromCallee();
+    }
+    TakeResults(Type, CS, Reserved);
+}
+
+// Resolving takes two loads from the table's view in the context (the
+// length for the bounds check and the base) and one from the table, which
+// yields the FuncEntry whose process-wide signature id is compared against an
+// immediate. The resolved entry is then profiled into the site's inline
+// cache, so a later compiler tier can guard on the hot targets; it waits in
+// the index's slot across that call and is left in rax with the index
+// popped. The argument moves leave rax alone.
+void X86_64TemplateInterpreter::ResolveIndirect(const bytecode::CallIndirectInst &Inst) {
+    auto &Type = Func.Parent.TypeSec[Inst.Type];
+    int32_t View = Inst.Table * sizeof(runtime::TableView);
+    ASM.Mov(W32, RCX, Mem(RSP));
+    ASM.Mov(W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, Tables)));
+    ASM.Alu(AluCmp, W64, RCX, Mem(RAX, View + offsetof(runtime::TableView, Length)));
+    EmitTrapUnless(CondB, runtime::trap::TrapUndefinedElement);
+    ASM.Mov(W64, RAX, Mem(RAX, View + offsetof(runtime::TableView, Base)));
+    ASM.Mov(W64, RAX, Mem(RAX, RCX, sizeof(runtime::Ref)));
+    ASM.Test(W64, RAX, RAX);
+    EmitTrapUnless(CondNE, runtime::trap::TrapIndirectCallNull);
+    ASM.Alu(AluCmp, W32, Mem(RAX, offsetof(runtime::FuncEntry, TypeId)), int32_t(runtime::getSignatureId(Type)));
+    EmitTrapUnless(CondE, runtime::trap::TrapSignatureMismatch);
+
+    auto &Cache = Func.getCallSite(Inst.Site);
+    ASM.Mov(W64, Mem(RSP), RAX);
+    ASM.Mov(W64, RSI, RAX);
+    ASM.Mov(W64, RDX, Mem(ContextReg, offsetof(runtime::InstanceContext, Instance)));
+    RuntimeCall(reinterpret_cast<const void *>(&runtime::inline_cache::RecordCallTarget),
+                reinterpret_cast<uintptr_t>(&Cache));
+    Pop(RAX);
+}
+
+void X86_64TemplateInterpreter::EmitCallIndirect(const bytecode::CallIndirectInst &Inst) {
+    auto &Type = Func.Parent.TypeSec[Inst.Type];
+    ResolveIndirect(Inst);
+    auto CS = getCallSignature(Type);
+    int32_t Reserved = PassArgs(Type, CS);
+    EnterCallee();
+    ASM.Call(Mem(RAX, offsetof(runtime::FuncEntry, Code)));
+    ReturnFromCallee();
+    TakeResults(Type, CS, Reserved);
+}
+
+// Moves the arguments of a tail call to Type over the incoming ones, moves
+// the return address down to right below them and pops the frame, see
+// CallingConv.h; the jump is left to the caller. The stack arguments are
+// staged below the operand stack first, since when the callee takes more of
+// them than this function their final place reaches down into the frame.
+// Staging lies below the final place, so copying downwards from the top
+// overwrites nothing still to be read. Leaves rax alone.
+void X86_64TemplateInterpreter::PassTailArgs(const FuncType &Type) {
+    auto CS = getCallSignature(Type);
+    auto &Params = Type.ParamTypes;
+    int32_t N = Params.size();
+    int32_t Staged = CS.StackParamSize;
+    if (Staged != 0)
+        ASM.Lea(W64, RSP, Mem(RSP, -Staged));
+    for (int32_t i = 0; i < N; ++i) {
+        Mem Arg(RSP, Staged + SlotSize * (N - 1 - i));
+        auto &Loc = CS.Params[i];
+        if (!Loc.InReg) {
+            ASM.Movdqu(XMM15, Arg);
+            if (Params[i] == ValTypeV128)
+                ASM.Movdqu(Mem(RSP, Loc.Offset), XMM15);
+            else
+                ASM.Movsd(Mem(RSP, Loc.Offset), XMM15);
+        } else if (isFloatOrVector(Params[i])) {
+            ASM.Movdqu(XMM(Loc.Reg), Arg);
+        } else {
+            ASM.Mov(W64, GPR(Loc.Reg), Arg);
+        }
+    }
+
+    int32_t Shift = getTailCallShift(Sig, CS);
+    if (Staged == 0 && Shift == 0) {
+        ASM.Mov(W64, RSP, RBP);
+        ASM.Pop(RBP);
+        return;
+    }
+    ASM.Mov(W64, R10, Mem(RBP));
+    ASM.Mov(W64, R11, Mem(RBP, 8));
+    for (int32_t Offset = Staged - 8; Offset >= 0; Offset -= 8) {
+        ASM.Movsd(XMM15, Mem(RSP, Offset));
+        ASM.Movsd(Mem(RBP, StackParamBase + Shift + Offset), XMM15);
+    }
+    ASM.Lea(W64, RSP, Mem(RBP, StackParamBase + Shift - 8));
+    ASM.Mov(W64, Mem(RSP), R11);
+    ASM.Mov(W64, RBP, R10);
+}
+
+// A tail call through a FuncEntry (in rax) only jumps when the callee runs
+// in this instance: one in another instance would return to this function's
+// caller with its own context loaded, and callers within the module do not
+// restore theirs after a direct call. Other callees are called, and their
+// results returned, at the cost of this frame.
+void X86_64TemplateInterpreter::EmitTailCallEntry(const FuncType &Type) {
+    auto Foreign = ASM.NewLabel();
+    ASM.Alu(AluCmp, W64, ContextReg, Mem(RAX, offsetof(runtime::FuncEntry, Context)));
+    ASM.Jcc(CondNE, Foreign);
+    PassTailArgs(Type);
+    ASM.Jmp(Mem(RAX, offsetof(runtime::FuncEntry, Code)));
+
+    ASM.Bind(Foreign);
+    auto CS = getCallSignature(Type);
+    int32_t Reserved = PassArgs(Type, CS);
+    EnterCallee();
+    ASM.Call(Mem(RAX, offsetof(runtime::FuncEntry, Code)));
+    ReturnFromCallee();
+    TakeResults(Type, CS, Reserved);
+    EmitReturn();
+}
+
+// Tail calls within the module jump straight to the callee, patched like
+// direct calls; imports go through their FuncEntry.
+void X86_64TemplateInterpreter::EmitReturnCall(const bytecode::WithArgInst &Inst) {
+    auto &Type = Func.Parent.TypeSec[Func.Parent.FuncTypes[Inst.Arg]];
+    if (Inst.Arg >= Func.Parent.NumImportedFuncs) {
+        PassTailArgs(Type);
+        return ASM.JmpFunc(Inst.Arg);
+    }
+    ASM.Mov(W64, RAX, Mem(ContextReg, offsetof(runtime::InstanceContext, Funcs)));
+    ASM.Lea(W64, RAX, Mem(RAX, Inst.Arg * sizeof(runtime::FuncEntry)));
+    EmitTailCallEntry(Type);
+}
+
+void X86_64TemplateInterpreter::EmitReturnCallIndirect(const bytecode::CallIndirectInst &Inst) {
+    ResolveIndirect(Inst);
+    EmitTailCallEntry(Func.Parent.TypeSec[Inst.Type]);
+}
+
+// Frames of a page or more are allocated a page at a time, touching each
+// one at rsp, so that an overflow faults on the guard page rather than past
+// it, and at the stack pointer, where the fault handler looks for it.
+void X86_64TemplateInterpreter::AllocateFrame(int32_t Size) {
+    int32_t Pages = Size / PageSize;
+    if (Pages > 4) {
+        auto Loop = ASM.NewLabel();
+        ASM.Mov(R11, uint64_t(Pages));
+        ASM.Bind(Loop);
+        ASM.Alu(AluSub, W64, RSP, PageSize);
+        ASM.Alu(AluOr, W64, Mem(RSP), 0);
+        ASM.Alu(AluSub, W32, R11, 1);
+        ASM.Jcc(CondNE, Loop);
+    } else {
+        for (int32_t i = 0; i < Pages; ++i) {
+            ASM.Alu(AluSub, W64, RSP, PageSize);
+            ASM.Alu(AluOr, W64, Mem(RSP), 0);
+        }
+    }
+    if (Size % PageSize != 0)
+        ASM.Alu(AluSub, W64, RSP, Size % PageSize);
+}
+
+// Spills the parameters to their slots and zeroes the declared locals.
+void X86_64TemplateInterpreter::EmitPrologue() {
+    auto &Params = Func.Type.ParamTypes;
+    uint32_t FrameSlots = NumLocals + SavesContext;
+    ASM.Push(RBP);
+    ASM.Mov(W64, RBP, RSP);
+    AllocateFrame(int32_t(FrameSlots * SlotSize));
+    if (SavesContext)
+        ASM.Mov(W64, SavedContext(), ContextReg);
+    for (uint32_t i = 0; i < Params.size(); ++i) {
+        auto &Loc = Sig.Params[i];
+        if (!Loc.InReg) {
+            // Copied whole, v128 included; scalars only use the low word.
+            ASM.Movdqu(XMM15, Mem(RBP, StackParamBase + Loc.Offset));
+            ASM.Movdqu(Local(i), XMM15);
+        } else if (isFloatOrVector(Params[i])) {
+            ASM.Movdqu(Local(i), XMM(Loc.Reg));
+        } else {
+            ASM.Mov(W64, Local(i), GPR(Loc.Reg));
+        }
+    }
+    if (NumLocals == Params.size())
+        return;
+    ASM.Sse(Prefix66, Map0F, 0xEF, XMM15, XMM15);    // pxor
+    for (uint32_t i = Params.size(); i < NumLocals; ++i)
+        ASM.Movdqu(Local(i), XMM15);
+}
+
+// The results are the top values of the operand stack, the last one topmost;
+// whatever lies below them is discarded with the frame.
+void X86_64TemplateInterpreter::EmitReturn() {
+    auto &Results = Func.Type.ResultTypes;
+    int32_t ResultBase = StackParamBase + Sig.StackParamSize;
+    for (size_t i = Results.size(); i-- > 0;) {
+        auto &Loc = Sig.Results[i];
+        if (!Loc.InReg) {
+            // xmm15 carries no result.
+            PopXmm(XMM15);
+            if (Results[i] == ValTypeV128)
+                ASM.Movdqu(Mem(RBP, ResultBase + Loc.Offset), XMM15);
+            else
+                ASM.Movsd(Mem(RBP, ResultBase + Loc.Offset), XMM15);
+        } else if (isFloatOrVector(Results[i])) {
+            PopXmm(XMM(Loc.Reg));
+        } else {
+            Pop(GPR(Loc.Reg));
+        }
+    }
+    ASM.Mov(W64, RSP, RBP);
+    ASM.Pop(RBP);
+    ASM.Ret(Sig.StackParamSize);
 }
 
 code_buffer::CodeBlob
 X86_64TemplateInterpreter::CodeGen() {
     int InstIdx = 0;
+    EmitPrologue();
+    if (Func.EpochChecks)
+        EmitEpochCheck();
     for (auto &Inst : Func) {
+        if (Func.Fuel != nullptr) {
+            if (auto *C = Func.Fuel->lookup(Inst.get()))
+                EmitFuelCharge(*C);
+        }
+        // Compares address + offset + size against MemBoundReg, retrying once
+        // through RefreshMemoryBound before trapping. This tier does not
+        // version loops, so accesses under a loop guard keep their check.
+        if (Func.Bounds != nullptr && runtime::bounds::getAccessSize(Inst->getOpcode()) != 0 &&
+            Func.Bounds->lookup(Inst.get()) != runtime::bounds::CheckElided)
+            EmitBoundsCheck(static_cast<const bytecode::MemoryInst &>(*Inst));
         switch (Inst.getOpcode()) {
-            case Unreachable : RuntimeCall(); break;// unreachable
+            case Unreachable : ASM.Ud2(); break;// unreachable, trapped by the SIGILL handler
             case Nop         : break;// nop
             case Block       : break;// block rt in* end
-            case Loop        : break;// loop rt in* end
+            case Loop        : ASM.Align(LoopAlign); if (Func.EpochChecks) EmitEpochCheck(); break;// loop rt in* end
             case If          : break;// if rt in* else in* end
             case Else_       : break;// else
             case End_        : break;// end
             case Br          : break;// br l
             case BrIf        : break;// br_if l
             case BrTable     : break;// br_table l* lN
-            case Return      : break;// return
-            case Call        : break;// call x
-            case CallIndirect: break;// call_indirect x
+            case Return      : EmitReturn(); break;// return
+            case Call        : EmitCall(static_cast<const bytecode::WithArgInst &>(*Inst)); break;// call x
+            case CallIndirect: EmitCallIndirect(static_cast<const bytecode::CallIndirectInst &>(*Inst)); break;// call_indirect x
+            case ReturnCall  : EmitReturnCall(static_cast<const bytecode::WithArgInst &>(*Inst)); break;// return_call x
+            case ReturnCallIndirect: EmitReturnCallIndirect(static_cast<const bytecode::CallIndirectInst &>(*Inst)); break;// return_call_indirect x
             case Drop        : break;// drop
             case Select      : break;// select
+            case SelectT     : break;// select t
             case LocalGet    : break;// local.get x
             case LocalSet    : break;// local.set x
             case LocalTee    : break;// local.tee x
             case GlobalGet   : break;// global.get x
             case GlobalSet   : break;// global.set x
+            case TableGet    : EmitTableAccess(static_cast<const bytecode::WithArgInst &>(*Inst)); break;// table.get x
+            case TableSet    : EmitTableAccess(static_cast<const bytecode::WithArgInst &>(*Inst)); break;// table.set x
             case I32Load     : break;// i32.load m
             case I64Load     : break;// i64.load m
             case F32Load     : break;// f32.load m
@@ -72,7 +902,7 @@ X86_64TemplateInterpreter::CodeGen() {
             case I64Store16  : break;// i64.store16 m
             case I64Store32  : break;// i64.store32 m
             case MemorySize  : break;// memory.size
-            case MemoryGrow  : break;// memory.grow
+            case MemoryGrow  : EmitMemoryGrow(); break;// memory.grow
             case I32Const    : break;// i32.const n
             case I64Const    : break;// i64.const n
             case F32Const    : break;// f32.const z
@@ -205,13 +1035,32 @@ X86_64TemplateInterpreter::CodeGen() {
             case I64Extend8S      : break;// i64.extend8_s
             case I64Extend16S     : break;// i64.extend16_s
             case I64Extend32S     : break;// i64.extend32_s
-            case TruncSat         : break;// <i32|64>.trunc_sat_<f32|64>_<s|u>
+            case RefNull          : break;// ref.null t
+            case RefIsNull        : break;// ref.is_null
+            case RefFunc          : break;// ref.func x
+            case TruncSat         : EmitMisc(static_cast<const bytecode::MiscInst &>(*Inst)); break;// <i32|64>.trunc_sat_<f32|64>_<s|u>, bulk ops
+            case Simd             : EmitSimd(static_cast<const bytecode::SimdInst &>(*Inst)); break;// <simd op>
+            case Atomic           : EmitAtomic(static_cast<const bytecode::AtomicInst &>(*Inst)); break;// <atomic op> m
             default:
                 output::Error("X86_64TemplateInterpreter::CodeGen", "Bad Opcode: %d\n", Inst.getopcode());
         }
         ++InstIdx;
     }
-    return ASM.Blob;
+    EmitReturn(); // falling off the end returns as well
+    if (Failed)
+        return {};
+    return ASM.Finalize();
+}
+
+result::Result<code_buffer::CodeBlob> CompileFunction(runtime::Function &Func, Assembler &ASM) {
+    ASM.Reset();
+    X86_64TemplateInterpreter TI(Func, ASM);
+    auto Blob = TI.CodeGen();
+    if (TI.Failed)
+        return result::Failure(*TI.Failed);
+    if (Blob.Address == nullptr)
+        return result::MakeFailure("CompileFunction", "out of code memory");
+    return std::move(Blob);
 }
 
 } // namespace x86_64
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "ADT/CodeBuffer.h"
+#include "Runtime/Function.h"
+#include "Support/Result.h"
+
+#include "Assembler.h"
+
+using namespace wasmrt;
+using namespace wasmrt::adt;
+
+namespace wasmrt {
+namespace target {
+namespace x86_64 {
+
+// Emits Func with ASM, which is reset first, and returns its blob. Direct
+// calls to other functions of the module are left in ASM.getRelocs() for
+// the caller to patch. Fails when Func uses SIMD ops the CPU lacks or the
+// code space is used up.
+support::result::Result<code_buffer::CodeBlob> CompileFunction(runtime::Function &Func, Assembler &ASM);
+
+} // namespace x86_64
+} // namespace target
+} // namespace wasmrt
@@ -0,0 +1,92 @@
+#include "Runtime/BulkMemory.h"
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace wasmrt;
+using namespace wasmrt::runtime;
+
+namespace {
+
+constexpr size_t BufSize = 3 * bulk::RepThreshold + 4096;
+constexpr int Cases = 200000;
+constexpr size_t Margin = 64;
+
+std::mt19937_64 Rng(0x5eed);
+
+// Sizes cluster around the kernel boundaries: the register moves up to 32
+// bytes, the vector loops up to RepThreshold, rep movsb/stosb beyond.
+size_t RandomSize() {
+    switch (Rng() % 4) {
+        case 0:  return Rng() % 33;
+        case 1:  return 33 + Rng() % 64;
+        case 2:  return bulk::RepThreshold - 64 + Rng() % 128;
+        default: return Rng() % (2 * bulk::RepThreshold);
+    }
+}
+
+// Both buffers got the same operation, so only the bytes it may have touched
+// and a margin around them need comparing; a mismatch anywhere else would
+// have shown up in an earlier case's window.
+bool Check(const std::vector<uint8_t> &Got, const std::vector<uint8_t> &Want, size_t Begin, size_t End,
+           const char *What, size_t Dst, size_t Src, size_t N) {
+    Begin = Begin < Margin ? 0 : Begin - Margin;
+    End = std::min(End + Margin, BufSize);
+    if (memcmp(Got.data() + Begin, Want.data() + Begin, End - Begin) == 0)
+        return true;
+    printf("FAIL: %s dst %zu src %zu n %zu\n", What, Dst, Src, N);
+    return false;
+}
+
+} // namespace
+
+// Copy and Fill against memmove and memset, on random, mostly overlapping
+// ranges at random alignments.
+int main() {
+    std::vector<uint8_t> Got(BufSize), Want(BufSize);
+    for (size_t i = 0; i < BufSize; ++i)
+        Got[i] = Want[i] = uint8_t(Rng());
+
+    int Failures = 0;
+    for (int i = 0; i < Cases && Failures < 10; ++i) {
+        size_t N = RandomSize();
+        size_t Dst = Rng() % (BufSize - N + 1);
+        // Usually close enough to overlap, in either direction.
+        size_t Src = Dst;
+        if (Rng() % 4 != 0) {
+            int64_t Shift = int64_t(Rng() % (2 * N + 2)) - int64_t(N + 1);
+            Src = std::min<int64_t>(std::max<int64_t>(int64_t(Dst) + Shift, 0), BufSize - N);
+        } else {
+            Src = Rng() % (BufSize - N + 1);
+        }
+
+        bulk::Copy(Got.data() + Dst, Got.data() + Src, N);
+        memmove(Want.data() + Dst, Want.data() + Src, N);
+        Failures += !Check(Got, Want, Dst, Dst + N, "Copy", Dst, Src, N);
+
+        uint8_t Val = uint8_t(Rng());
+        N = RandomSize();
+        Dst = Rng() % (BufSize - N + 1);
+        bulk::Fill(Got.data() + Dst, Val, N);
+        memset(Want.data() + Dst, Val, N);
+        Failures += !Check(Got, Want, Dst, Dst + N, "Fill", Dst, 0, N);
+
+        // Keep the contents varied, so that copies do not just move bytes
+        // that a fill made equal.
+        size_t At = Rng() % (BufSize - 8);
+        uint64_t Noise = Rng();
+        memcpy(Got.data() + At, &Noise, 8);
+        memcpy(Want.data() + At, &Noise, 8);
+    }
+    if (memcmp(Got.data(), Want.data(), BufSize) != 0) {
+        printf("FAIL: buffers differ outside the checked windows\n");
+        ++Failures;
+    }
+    if (Failures != 0) {
+        printf("%d failures\n", Failures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+#include "Target/X86_64/Assembler.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using namespace wasmrt;
+using namespace wasmrt::target::x86_64;
+
+namespace {
+
+code_buffer::CodeBuffer CB;
+int Failures = 0;
+
+// Single instructions against the bytes GNU as produces for the same Intel
+// syntax, which also picks the shortest encoding.
+struct Case {
+    const char  *Text;
+    void        (*Emit)(Assembler &);
+    const char  *Bytes;
+};
+
+const Case Cases[] = {
+    // Moves, with the addressing forms that need special encodings: rsp and
+    // r12 bases take a SIB byte, rbp and r13 bases a displacement.
+    {"mov rax, rbx", [](Assembler &A) { A.Mov(W64, RAX, RBX); }, "48 89 d8"},
+    {"mov r8d, eax", [](Assembler &A) { A.Mov(W32, R8, RAX); }, "41 89 c0"},
+    {"mov si, r15w", [](Assembler &A) { A.Mov(W16, RSI, R15); }, "66 44 89 fe"},
+    {"mov sil, dil", [](Assembler &A) { A.Mov(W8, RSI, RDI); }, "40 88 fe"},
+    {"mov al, bl", [](Assembler &A) { A.Mov(W8, RAX, RBX); }, "88 d8"},
+    {"mov rax, [rsp]", [](Assembler &A) { A.Mov(W64, RAX, Mem(RSP)); }, "48 8b 04 24"},
+    {"mov rax, [r12]", [](Assembler &A) { A.Mov(W64, RAX, Mem(R12)); }, "49 8b 04 24"},
+    {"mov rax, [rbp]", [](Assembler &A) { A.Mov(W64, RAX, Mem(RBP)); }, "48 8b 45 00"},
+    {"mov rax, [r13]", [](Assembler &A) { A.Mov(W64, RAX, Mem(R13)); }, "49 8b 45 00"},
+    {"mov r9, [r12+0x10]", [](Assembler &A) { A.Mov(W64, R9, Mem(R12, 0x10)); }, "4d 8b 4c 24 10"},
+    {"mov eax, [r13-0x1000]", [](Assembler &A) { A.Mov(W32, RAX, Mem(R13, -0x1000)); }, "41 8b 85 00 f0 ff ff"},
+    {"mov eax, [rax+r12*4]", [](Assembler &A) { A.Mov(W32, RAX, Mem(RAX, R12, 4)); }, "42 8b 04 a0"},
+    {"mov eax, [r13+rbx*8]", [](Assembler &A) { A.Mov(W32, RAX, Mem(R13, RBX, 8)); }, "41 8b 44 dd 00"},
+    {"mov eax, [rbp+r13*2+0x7f]", [](Assembler &A) { A.Mov(W32, RAX, Mem(RBP, R13, 2, 0x7f)); }, "42 8b 44 6d 7f"},
+    {"mov r15, [r12+r13*1-0x80]", [](Assembler &A) { A.Mov(W64, R15, Mem(R12, R13, 1, -0x80)); }, "4f 8b 7c 2c 80"},
+    {"mov eax, [rsp+rsi*2+0x80]", [](Assembler &A) { A.Mov(W32, RAX, Mem(RSP, RSI, 2, 0x80)); }, "8b 84 74 80 00 00 00"},
+    {"mov [r14+rax*1], cl", [](Assembler &A) { A.Mov(W8, Mem(R14, RAX, 1), RCX); }, "41 88 0c 06"},
+    {"mov [rsp+8], sil", [](Assembler &A) { A.Mov(W8, Mem(RSP, 8), RSI); }, "40 88 74 24 08"},
+    {"mov [r13], r8w", [](Assembler &A) { A.Mov(W16, Mem(R13), R8); }, "66 45 89 45 00"},
+    {"mov qword ptr [rsp], -1", [](Assembler &A) { A.Mov(W64, Mem(RSP), -1); }, "48 c7 04 24 ff ff ff ff"},
+    {"mov dword ptr [r12+4], 0x12345678", [](Assembler &A) { A.Mov(W32, Mem(R12, 4), 0x12345678); }, "41 c7 44 24 04 78 56 34 12"},
+    {"mov word ptr [rax], 0x1234", [](Assembler &A) { A.Mov(W16, Mem(RAX), 0x1234); }, "66 c7 00 34 12"},
+    {"mov byte ptr [r13], 0x7f", [](Assembler &A) { A.Mov(W8, Mem(R13), 0x7f); }, "41 c6 45 00 7f"},
+    {"mov eax, 0x1", [](Assembler &A) { A.Mov(RAX, 1); }, "b8 01 00 00 00"},
+    {"mov r10d, 0xffffffff", [](Assembler &A) { A.Mov(R10, 0xffffffffull); }, "41 ba ff ff ff ff"},
+    {"mov rcx, -2", [](Assembler &A) { A.Mov(RCX, uint64_t(-2)); }, "48 c7 c1 fe ff ff ff"},
+    {"movabs r11, 0x123456789a", [](Assembler &A) { A.Mov(R11, 0x123456789aull); }, "49 bb 9a 78 56 34 12 00 00 00"},
+    {"movzx eax, sil", [](Assembler &A) { A.Movzx(W32, W8, RAX, RSI); }, "40 0f b6 c6"},
+    {"movzx r8d, r9w", [](Assembler &A) { A.Movzx(W32, W16, R8, R9); }, "45 0f b7 c1"},
+    {"movzx rax, byte ptr [r12]", [](Assembler &A) { A.Movzx(W64, W8, RAX, Mem(R12)); }, "49 0f b6 04 24"},
+    {"movzx eax, word ptr [r13+rax*2]", [](Assembler &A) { A.Movzx(W32, W16, RAX, Mem(R13, RAX, 2)); }, "41 0f b7 44 45 00"},
+    {"mov ecx, edx", [](Assembler &A) { A.Movzx(W64, W32, RCX, RDX); }, "89 d1"},
+    {"movsx eax, bl", [](Assembler &A) { A.Movsx(W32, W8, RAX, RBX); }, "0f be c3"},
+    {"movsx rax, di", [](Assembler &A) { A.Movsx(W64, W16, RAX, RDI); }, "48 0f bf c7"},
+    {"movsxd rax, r11d", [](Assembler &A) { A.Movsx(W64, W32, RAX, R11); }, "49 63 c3"},
+    {"movsx eax, byte ptr [rsp+1]", [](Assembler &A) { A.Movsx(W32, W8, RAX, Mem(RSP, 1)); }, "0f be 44 24 01"},
+    {"movsxd r12, dword ptr [r13]", [](Assembler &A) { A.Movsx(W64, W32, R12, Mem(R13)); }, "4d 63 65 00"},
+    {"lea rsp, [rsp-0x10]", [](Assembler &A) { A.Lea(W64, RSP, Mem(RSP, -0x10)); }, "48 8d 64 24 f0"},
+    {"lea r11, [r12+r12*8]", [](Assembler &A) { A.Lea(W64, R11, Mem(R12, R12, 8)); }, "4f 8d 1c e4"},
+    {"xchg rcx, rax", [](Assembler &A) { A.Xchg(W64, RAX, RCX); }, "48 91"},
+    {"xchg r9d, eax", [](Assembler &A) { A.Xchg(W32, R9, RAX); }, "41 91"},
+    {"xchg si, ax", [](Assembler &A) { A.Xchg(W16, RAX, RSI); }, "66 96"},
+    {"xchg eax, eax", [](Assembler &A) { A.Xchg(W32, RAX, RAX); }, "87 c0"},
+    {"xchg bl, cl", [](Assembler &A) { A.Xchg(W8, RBX, RCX); }, "86 cb"},
+    {"cmovl rax, r8", [](Assembler &A) { A.Cmov(W64, CondL, RAX, R8); }, "49 0f 4c c0"},
+    {"cmove ecx, edx", [](Assembler &A) { A.Cmov(W32, CondE, RCX, RDX); }, "0f 44 ca"},
+    {"setne al", [](Assembler &A) { A.Setcc(CondNE, RAX); }, "0f 95 c0"},
+    {"seta dil", [](Assembler &A) { A.Setcc(CondA, RDI); }, "40 0f 97 c7"},
+    {"setb r12b", [](Assembler &A) { A.Setcc(CondB, R12); }, "41 0f 92 c4"},
+    {"xor r13d, r13d", [](Assembler &A) { A.Zero(R13); }, "45 31 ed"},
+
+    // Integer arithmetic.
+    {"add rax, rbx", [](Assembler &A) { A.Alu(AluAdd, W64, RAX, RBX); }, "48 01 d8"},
+    {"sub r12d, r13d", [](Assembler &A) { A.Alu(AluSub, W32, R12, R13); }, "45 29 ec"},
+    {"xor sil, al", [](Assembler &A) { A.Alu(AluXor, W8, RSI, RAX); }, "40 30 c6"},
+    {"cmp rax, [r15+0x20]", [](Assembler &A) { A.Alu(AluCmp, W64, RAX, Mem(R15, 0x20)); }, "49 3b 47 20"},
+    {"or [rsp], r8d", [](Assembler &A) { A.Alu(AluOr, W32, Mem(RSP), R8); }, "44 09 04 24"},
+    {"add rax, 0x10", [](Assembler &A) { A.Alu(AluAdd, W64, RAX, 0x10); }, "48 83 c0 10"},
+    {"add rax, 0x1000", [](Assembler &A) { A.Alu(AluAdd, W64, RAX, 0x1000); }, "48 05 00 10 00 00"},
+    {"and eax, 0x1000", [](Assembler &A) { A.Alu(AluAnd, W32, RAX, 0x1000); }, "25 00 10 00 00"},
+    {"cmp ax, 0x1000", [](Assembler &A) { A.Alu(AluCmp, W16, RAX, 0x1000); }, "66 3d 00 10"},
+    {"cmp al, 0x80", [](Assembler &A) { A.Alu(AluCmp, W8, RAX, 0x80); }, "3c 80"},
+    {"sub r11, 0x1000", [](Assembler &A) { A.Alu(AluSub, W64, R11, 0x1000); }, "49 81 eb 00 10 00 00"},
+    {"and dil, 0x7f", [](Assembler &A) { A.Alu(AluAnd, W8, RDI, 0x7f); }, "40 80 e7 7f"},
+    {"sub qword ptr [r15+0x18], 0x3", [](Assembler &A) { A.Alu(AluSub, W64, Mem(R15, 0x18), 3); }, "49 83 6f 18 03"},
+    {"add dword ptr [r13], 0x100", [](Assembler &A) { A.Alu(AluAdd, W32, Mem(R13), 0x100); }, "41 81 45 00 00 01 00 00"},
+    {"cmp byte ptr [r12], 0x1", [](Assembler &A) { A.Alu(AluCmp, W8, Mem(R12), 1); }, "41 80 3c 24 01"},
+    {"test rax, r9", [](Assembler &A) { A.Test(W64, RAX, R9); }, "4c 85 c8"},
+    {"test al, 0x7", [](Assembler &A) { A.Test(W8, RAX, 7); }, "a8 07"},
+    {"test eax, 0x3", [](Assembler &A) { A.Test(W32, RAX, 3); }, "a9 03 00 00 00"},
+    {"test r10d, 0x1", [](Assembler &A) { A.Test(W32, R10, 1); }, "41 f7 c2 01 00 00 00"},
+    {"test sil, 0x1", [](Assembler &A) { A.Test(W8, RSI, 1); }, "40 f6 c6 01"},
+    {"shl rax, 1", [](Assembler &A) { A.Shift(ShiftShl, W64, RAX, 1); }, "48 d1 e0"},
+    {"sar r9d, 0x1f", [](Assembler &A) { A.Shift(ShiftSar, W32, R9, 31); }, "41 c1 f9 1f"},
+    {"rol spl, 0x3", [](Assembler &A) { A.Shift(ShiftRol, W8, RSP, 3); }, "40 c0 c4 03"},
+    {"shr rdx, cl", [](Assembler &A) { A.ShiftCL(ShiftShr, W64, RDX); }, "48 d3 ea"},
+    {"imul rax, r13", [](Assembler &A) { A.Imul(W64, RAX, R13); }, "49 0f af c5"},
+    {"imul ecx, edx, 0xa", [](Assembler &A) { A.Imul(W32, RCX, RDX, 10); }, "6b ca 0a"},
+    {"imul r8, r12, 0x1000", [](Assembler &A) { A.Imul(W64, R8, R12, 0x1000); }, "4d 69 c4 00 10 00 00"},
+    {"imul ax, bx, 0x1000", [](Assembler &A) { A.Imul(W16, RAX, RBX, 0x1000); }, "66 69 c3 00 10"},
+    {"not r14", [](Assembler &A) { A.Not(W64, R14); }, "49 f7 d6"},
+    {"neg bpl", [](Assembler &A) { A.Neg(W8, RBP); }, "40 f6 dd"},
+    {"div r11d", [](Assembler &A) { A.Div(W32, R11); }, "41 f7 f3"},
+    {"idiv rcx", [](Assembler &A) { A.Idiv(W64, RCX); }, "48 f7 f9"},
+    {"cdq", [](Assembler &A) { A.Cdq(W32); }, "99"},
+    {"cqo", [](Assembler &A) { A.Cdq(W64); }, "48 99"},
+    {"lzcnt rax, r12", [](Assembler &A) { A.Lzcnt(W64, RAX, R12); }, "f3 49 0f bd c4"},
+    {"tzcnt r9d, eax", [](Assembler &A) { A.Tzcnt(W32, R9, RAX); }, "f3 44 0f bc c8"},
+    {"popcnt rcx, rdx", [](Assembler &A) { A.Popcnt(W64, RCX, RDX); }, "f3 48 0f b8 ca"},
+
+    // Atomics. Lock goes out before a 66 prefix, where GNU as puts it after;
+    // the order of legacy prefixes does not matter.
+    {"lock xadd [r14+rax*1], rcx", [](Assembler &A) { A.Lock(); A.Xadd(W64, Mem(R14, RAX, 1), RCX); }, "f0 49 0f c1 0c 06"},
+    {"lock xadd [r14+rax*1], sil", [](Assembler &A) { A.Lock(); A.Xadd(W8, Mem(R14, RAX, 1), RSI); }, "f0 41 0f c0 34 06"},
+    {"lock xadd [r13], r8w", [](Assembler &A) { A.Lock(); A.Xadd(W16, Mem(R13), R8); }, "f0 66 45 0f c1 45 00"},
+    {"lock cmpxchg [r14+rdx*1], r11d", [](Assembler &A) { A.Lock(); A.Cmpxchg(W32, Mem(R14, RDX, 1), R11); }, "f0 45 0f b1 1c 16"},
+    {"lock cmpxchg [r12], dil", [](Assembler &A) { A.Lock(); A.Cmpxchg(W8, Mem(R12), RDI); }, "f0 41 0f b0 3c 24"},
+    {"xchg [r14+rax*1], rcx", [](Assembler &A) { A.Xchg(W64, Mem(R14, RAX, 1), RCX); }, "49 87 0c 06"},
+    {"xchg [rax], cl", [](Assembler &A) { A.Xchg(W8, Mem(RAX), RCX); }, "86 08"},
+    {"mfence", [](Assembler &A) { A.Mfence(); }, "0f ae f0"},
+
+    // Control flow and stack.
+    {"push rbp", [](Assembler &A) { A.Push(RBP); }, "55"},
+    {"push r12", [](Assembler &A) { A.Push(R12); }, "41 54"},
+    {"pop r15", [](Assembler &A) { A.Pop(R15); }, "41 5f"},
+    {"push 0x7f", [](Assembler &A) { A.Push(0x7f); }, "6a 7f"},
+    {"push 0x1000", [](Assembler &A) { A.Push(0x1000); }, "68 00 10 00 00"},
+    {"call rax", [](Assembler &A) { A.Call(RAX); }, "ff d0"},
+    {"call r11", [](Assembler &A) { A.Call(R11); }, "41 ff d3"},
+    {"call qword ptr [r15+0x8]", [](Assembler &A) { A.Call(Mem(R15, 8)); }, "41 ff 57 08"},
+    {"jmp r13", [](Assembler &A) { A.Jmp(R13); }, "41 ff e5"},
+    {"jmp qword ptr [rax+rcx*8]", [](Assembler &A) { A.Jmp(Mem(RAX, RCX, 8)); }, "ff 24 c8"},
+    {"ret", [](Assembler &A) { A.Ret(); }, "c3"},
+    {"ret 0x10", [](Assembler &A) { A.Ret(16); }, "c2 10 00"},
+    {"ud2", [](Assembler &A) { A.Ud2(); }, "0f 0b"},
+
+    // SSE. Extended registers need a REX between the mandatory prefix and
+    // the escape bytes.
+    {"paddd xmm0, xmm1", [](Assembler &A) { A.Sse(Prefix66, Map0F, 0xFE, XMM0, XMM1); }, "66 0f fe c1"},
+    {"paddd xmm8, xmm15", [](Assembler &A) { A.Sse(Prefix66, Map0F, 0xFE, XMM8, XMM15); }, "66 45 0f fe c7"},
+    {"pmulld xmm1, xmm9", [](Assembler &A) { A.Sse(Prefix66, Map0F38, 0x40, XMM1, XMM9); }, "66 41 0f 38 40 c9"},
+    {"roundps xmm2, xmm3, 0xa", [](Assembler &A) { A.Sse(Prefix66, Map0F3A, 0x08, XMM2, XMM3, 0xA); }, "66 0f 3a 08 d3 0a"},
+    {"cmpps xmm0, [r12+0x10], 0x1", [](Assembler &A) { A.Sse(PrefixNone, Map0F, 0xC2, XMM0, Mem(R12, 0x10), 1); }, "41 0f c2 44 24 10 01"},
+    {"addsd xmm10, [r13+rax*8]", [](Assembler &A) { A.Sse(PrefixF2, Map0F, 0x58, XMM10, Mem(R13, RAX, 8)); }, "f2 45 0f 58 54 c5 00"},
+    {"cvtsi2sd xmm0, rax", [](Assembler &A) { A.SseReg(PrefixF2, Map0F, 0x2A, XMM0, RAX, -1, true); }, "f2 48 0f 2a c0"},
+    {"pextrd r9d, xmm2, 0x3", [](Assembler &A) { A.SseReg(Prefix66, Map0F3A, 0x16, XMM2, R9, 3); }, "66 41 0f 3a 16 d1 03"},
+    {"movd xmm3, eax", [](Assembler &A) { A.Movd(XMM3, RAX); }, "66 0f 6e d8"},
+    {"movd r12d, xmm9", [](Assembler &A) { A.Movd(R12, XMM9); }, "66 45 0f 7e cc"},
+    {"movq xmm0, r11", [](Assembler &A) { A.Movq(XMM0, R11); }, "66 49 0f 6e c3"},
+    {"movq rax, xmm15", [](Assembler &A) { A.Movq(RAX, XMM15); }, "66 4c 0f 7e f8"},
+    {"movss xmm1, [rsp]", [](Assembler &A) { A.Movss(XMM1, Mem(RSP)); }, "f3 0f 10 0c 24"},
+    {"movss [rbp-0x10], xmm8", [](Assembler &A) { A.Movss(Mem(RBP, -0x10), XMM8); }, "f3 44 0f 11 45 f0"},
+    {"movsd xmm15, [rbp-0x20]", [](Assembler &A) { A.Movsd(XMM15, Mem(RBP, -0x20)); }, "f2 44 0f 10 7d e0"},
+    {"movsd [r12], xmm0", [](Assembler &A) { A.Movsd(Mem(R12), XMM0); }, "f2 41 0f 11 04 24"},
+    {"movaps xmm9, xmm1", [](Assembler &A) { A.Movaps(XMM9, XMM1); }, "44 0f 28 c9"},
+    {"movdqu xmm0, [rsp+0x10]", [](Assembler &A) { A.Movdqu(XMM0, Mem(RSP, 0x10)); }, "f3 0f 6f 44 24 10"},
+    {"movdqu [r13], xmm11", [](Assembler &A) { A.Movdqu(Mem(R13), XMM11); }, "f3 45 0f 7f 5d 00"},
+
+    // AVX. The 2-byte VEX form only covers the 0F map without W, X or B.
+    {"vpaddd xmm0, xmm1, xmm2", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, XMM2); }, "c5 f1 fe c2"},
+    {"vpaddd xmm8, xmm9, xmm2", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM8, XMM9, XMM2); }, "c5 31 fe c2"},
+    {"vpaddd xmm0, xmm1, xmm10", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, XMM10); }, "c4 c1 71 fe c2"},
+    {"vpmulld xmm3, xmm4, xmm5", [](Assembler &A) { A.Vex(Prefix66, Map0F38, 0x40, XMM3, XMM4, XMM5); }, "c4 e2 59 40 dd"},
+    {"vroundpd xmm1, xmm15, 0x9", [](Assembler &A) { A.Vex(Prefix66, Map0F3A, 0x09, XMM1, XMM0, XMM15, 9); }, "c4 c3 79 09 cf 09"},
+    {"vpaddd ymm0, ymm1, ymm2", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, XMM2, -1, false, true); }, "c5 f5 fe c2"},
+    {"vpinsrq xmm0, xmm0, rax, 0x1", [](Assembler &A) { A.Vex(Prefix66, Map0F3A, 0x22, XMM0, XMM0, XMM(RAX), 1, true); }, "c4 e3 f9 22 c0 01"},
+    {"vsqrtps xmm2, xmm3", [](Assembler &A) { A.Vex(PrefixNone, Map0F, 0x51, XMM2, XMM0, XMM3); }, "c5 f8 51 d3"},
+    {"vpaddd xmm0, xmm1, [rsp+0x10]", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, Mem(RSP, 0x10)); }, "c5 f1 fe 44 24 10"},
+    {"vpaddd xmm0, xmm1, [r12]", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, Mem(R12)); }, "c4 c1 71 fe 04 24"},
+    {"vpaddd xmm0, xmm1, [rax+r13*4]", [](Assembler &A) { A.Vex(Prefix66, Map0F, 0xFE, XMM0, XMM1, Mem(RAX, R13, 4)); }, "c4 a1 71 fe 04 a8"},
+    {"vcmpps xmm1, xmm2, [r13], 0x2", [](Assembler &A) { A.Vex(PrefixNone, Map0F, 0xC2, XMM1, XMM2, Mem(R13), 2); }, "c4 c1 68 c2 4d 00 02"},
+
+    // SIMD ops as the lowering table describes them, in both encodings:
+    // i32x4.add, i32x4.lt_s, f64x2.sqrt, f32x4.ceil and f32x4.ne. With SSE
+    // the first x86 source is copied to the destination unless it already
+    // is the destination.
+    {"movaps xmm0, xmm1; paddd xmm0, xmm2",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F, 0xFE, -1, false, false}, XMM0, XMM1, XMM2, false); }, "0f 28 c1 66 0f fe c2"},
+    {"paddd xmm0, xmm2",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F, 0xFE, -1, false, false}, XMM0, XMM0, XMM2, false); }, "66 0f fe c2"},
+    {"pcmpgtd xmm1, xmm0",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F, 0x66, -1, false, true}, XMM1, XMM0, XMM1, false); }, "66 0f 66 c8"},
+    {"vpcmpgtd xmm2, xmm1, xmm0",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F, 0x66, -1, false, true}, XMM2, XMM0, XMM1, true); }, "c5 f1 66 d0"},
+    {"sqrtpd xmm0, xmm9",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F, 0x51, -1, true, false}, XMM0, XMM9, XMM0, false); }, "66 41 0f 51 c1"},
+    {"vroundps xmm8, xmm1, 0xa",
+     [](Assembler &A) { A.Simd({Prefix66, Map0F3A, 0x08, 0xA, true, false}, XMM8, XMM1, XMM0, true); }, "c4 63 79 08 c1 0a"},
+    {"vcmpps xmm0, xmm1, xmm2, 0x4",
+     [](Assembler &A) { A.Simd({PrefixNone, Map0F, 0xC2, 4, false, false}, XMM0, XMM1, XMM2, true); }, "c5 f0 c2 c2 04"},
+};
+
+std::string Hex(const uint8_t *Bytes, size_t Size) {
+    std::string Out;
+    char Buf[4];
+    for (size_t i = 0; i < Size; ++i) {
+        snprintf(Buf, sizeof(Buf), i == 0 ? "%02x" : " %02x", Bytes[i]);
+        Out += Buf;
+    }
+    return Out;
+}
+
+void Expect(bool Ok, const char *What) {
+    if (!Ok) {
+        printf("FAIL: %s\n", What);
+        ++Failures;
+    }
+}
+
+void TestEncodings() {
+    Assembler A(CB, 64);
+    for (auto &C : Cases) {
+        A.Reset();
+        C.Emit(A);
+        auto Blob = A.Finalize();
+        auto Got = Hex(Blob.Address, A.getSize());
+        if (Got != C.Bytes) {
+            printf("FAIL: %s: got %s, expected %s\n", C.Text, Got.c_str(), C.Bytes);
+            ++Failures;
+        }
+        Blob.Free();
+    }
+}
+
+// Jumps start short and only grow. Padding depends on where the jumps before
+// it ended up, so a jump can be pushed out of rel8 range by the growth of
+// the alignment it jumps over, or by another jump growing.
+void TestRelaxation() {
+    Assembler A(CB, 512);
+
+    // 2 + 126 bytes reach the boundary exactly: short, no padding.
+    auto L = A.NewLabel();
+    A.Jmp(L);
+    A.Nop(126);
+    A.Align(16);
+    A.Bind(L);
+    A.Ud2();
+    auto Blob = A.Finalize();
+    Expect(Hex(Blob.Address, 2) == "eb 7e", "short jmp to an aligned label");
+    Expect(Hex(Blob.Address + 128, 2) == "0f 0b", "no padding after a short jmp");
+    Blob.Free();
+
+    // One more byte and the short jump would need 15 bytes of padding,
+    // putting the label out of range; the long one needs 12.
+    A.Reset();
+    L = A.NewLabel();
+    A.Jmp(L);
+    A.Nop(127);
+    A.Align(16);
+    A.Bind(L);
+    A.Ud2();
+    Blob = A.Finalize();
+    Expect(Hex(Blob.Address, 5) == "e9 8b 00 00 00", "jmp grown by the padding");
+    Expect(Hex(Blob.Address + 132, 12) == "66 0f 1f 84 00 00 00 00 00 0f 1f 00", "12 bytes of padding");
+    Expect(Hex(Blob.Address + 144, 2) == "0f 0b", "label after the padding");
+    Blob.Free();
+
+    // A backward jcc over an aligned loop head: the head moves when the
+    // forward jmp in front of it grows.
+    A.Reset();
+    auto Exit = A.NewLabel(), Head = A.NewLabel();
+    A.Jmp(Exit);
+    A.Align(16);
+    A.Bind(Head);
+    A.Nop(130);
+    A.Jcc(CondNE, Head);
+    A.Bind(Exit);
+    A.Ret();
+    Blob = A.Finalize();
+    // jmp: 5 bytes, padding 11, head at 16, jcc at 146 long (6 bytes).
+    Expect(Hex(Blob.Address, 5) == "e9 93 00 00 00", "forward jmp over the loop");
+    Expect(Hex(Blob.Address + 5, 11) == "66 0f 1f 84 00 00 00 00 00 66 90", "padding to the loop head");
+    Expect(Hex(Blob.Address + 146, 6) == "0f 85 78 ff ff ff", "backward jne to the loop head");
+    Expect(Blob.Address[152] == 0xc3, "exit after the loop");
+    Blob.Free();
+
+    // Calls to other functions are always rel32, left zero and recorded.
+    A.Reset();
+    A.Align(8);
+    A.CallFunc(7);
+    A.Nop(1);
+    A.JmpFunc(9);
+    Blob = A.Finalize();
+    Expect(Hex(Blob.Address, 11) == "e8 00 00 00 00 90 e9 00 00 00 00", "direct call and tail jump");
+    auto &Relocs = A.getRelocs();
+    Expect(Relocs.size() == 2 && Relocs[0].Offset == 1 && Relocs[0].Callee == 7 &&
+           Relocs[1].Offset == 7 && Relocs[1].Callee == 9, "call relocations");
+    Blob.Free();
+}
+
+} // namespace
+
+int main() {
+    TestEncodings();
+    TestRelaxation();
+    if (Failures != 0) {
+        printf("%d failures\n", Failures);
+        return 1;
+    }
+    return 0;
+}